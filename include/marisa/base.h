@@ -79,6 +79,47 @@ enum marisa_error_code {
 enum marisa_map_flags {
   // MARISA_MAP_POPULATE specifies MAP_POPULATE.
   MARISA_MAP_POPULATE = 1 << 0,
+
+  // The following flags apply to sections of a dictionary. Index sections
+  // (LOUDS, flags, bases, extras, cache and the key filter) are visited by
+  // every search, while data sections (tail, values and postings) are
+  // visited only at the end of a search. They are shorthands for a
+  // MapPolicy, see marisa/map-policy.h, which gives advice for each type of
+  // section.
+
+  // MARISA_MAP_LOCK_INDEX locks index sections in memory with mlock(), which
+  // also populates them. An error is thrown if mlock() fails.
+  MARISA_MAP_LOCK_INDEX = 1 << 1,
+
+  // MARISA_MAP_WILLNEED_INDEX prefetches index sections with MADV_WILLNEED.
+  MARISA_MAP_WILLNEED_INDEX = 1 << 2,
+
+  // MARISA_MAP_RANDOM_DATA disables readahead for data sections with
+  // MADV_RANDOM.
+  MARISA_MAP_RANDOM_DATA = 1 << 3,
+
+  // MARISA_MAP_HUGEPAGE specifies MADV_HUGEPAGE for sections of 2MB or more.
+  MARISA_MAP_HUGEPAGE = 1 << 4,
+
+  // MARISA_MAP_BULK_LOAD reads the whole file into anonymous memory instead
+  // of mapping the file. The memory is aligned to 2MB and backed by huge
+  // pages if available, and a large file is read by parallel pread() calls.
+  // This flag is ignored on Windows.
+  MARISA_MAP_BULK_LOAD = 1 << 5,
+
+  // MARISA_MAP_VERIFY verifies the checksums of a dictionary in the version
+  // 2 format before Trie::mmap() returns, and an error is thrown if they do
+  // not match. Trie::verify_async() verifies them without blocking.
+  MARISA_MAP_VERIFY = 1 << 6,
+};
+
+// Flags for saving a dictionary are defined as members of marisa_save_flags.
+// Trie::save() and Trie::write() accept a combination of these flags.
+enum marisa_save_flags {
+  // MARISA_SAVE_V2 writes the version 2 format, in which each vector is
+  // aligned to 64 bytes and sections are listed in a table of contents at the
+  // end. Readers of the version 2 format also read the version 1 format.
+  MARISA_SAVE_V2 = 1 << 0,
 };
 
 // Min/max values, flags and masks for dictionary settings are defined below.
@@ -0,0 +1,35 @@
+#ifndef MARISA_BUILD_PROFILE_H_
+#define MARISA_BUILD_PROFILE_H_
+
+#include <cstddef>
+#include <functional>
+
+namespace marisa {
+
+// BuildEvent reports a phase of Trie::build(). A build is a sequence of
+// phases, and a phase may occur more than once at a level.
+//  - "keys": copying keys for a level
+//  - "sort": sorting keys
+//  - "trie": arranging the nodes of a level
+//  - "bit_vector": building bit vectors and their rank/select indexes
+//  - "terminals": marking terminal nodes
+//  - "key_ids": assigning key IDs to the given keys
+//  - "tail": building the tail of the last level
+//  - "links": attaching links and caches to nodes
+struct BuildEvent {
+  const char *phase = "";
+  // `level' is 0 for the top-level trie.
+  std::size_t level = 0;
+  // `elapsed' is the wall-clock time of the phase in seconds.
+  double elapsed = 0.0;
+  // `peak_vector_size' is the peak number of bytes held by vectors of the
+  // build during the phase. It is not the peak heap usage: the keyset and
+  // scratch space such as queues and temporary arrays are not counted.
+  std::size_t peak_vector_size = 0;
+};
+
+using BuildCallback = std::function<void(const BuildEvent &)>;
+
+}  // namespace marisa
+
+#endif  // MARISA_BUILD_PROFILE_H_
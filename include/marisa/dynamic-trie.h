@@ -0,0 +1,90 @@
+#ifndef MARISA_DYNAMIC_TRIE_H_
+#define MARISA_DYNAMIC_TRIE_H_
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "marisa/trie.h"
+
+namespace marisa {
+
+// DynamicTrie layers updates on top of an immutable base Trie. Inserted keys
+// and tombstones for erased keys are kept in an in-memory delta, which is
+// merged into the results of lookups and searches. compact() rebuilds the
+// base trie with the delta applied, and compact_async() does the same in a
+// background thread while the trie keeps serving lookups and updates.
+//
+// All the member functions are thread-safe. Callbacks of searches are called
+// while a shared lock is held, so they must not update the trie.
+class DynamicTrie {
+ public:
+  // A search callback receives each key and returns false to stop the search.
+  using Callback = std::function<bool(std::string_view)>;
+
+  // `config_flags' is used to build base tries in compaction.
+  explicit DynamicTrie(int config_flags = 0);
+  explicit DynamicTrie(Trie &&base, int config_flags = 0);
+  ~DynamicTrie();
+
+  DynamicTrie(const DynamicTrie &) = delete;
+  DynamicTrie &operator=(const DynamicTrie &) = delete;
+
+  void insert(std::string_view key);
+  void erase(std::string_view key);
+
+  bool lookup(std::string_view key) const;
+  // common_prefix_search() reports keys in ascending order of length.
+  void common_prefix_search(std::string_view query,
+                            const Callback &callback) const;
+  // predictive_search() reports keys in no particular order. Keys of the
+  // base trie and keys inserted since the last compaction are not merged.
+  void predictive_search(std::string_view query,
+                         const Callback &callback) const;
+
+  // compact() returns after the new base trie has been swapped in.
+  void compact();
+  // compact_async() returns immediately if a compaction is running, or if
+  // wait() has not yet reported the error of the last one.
+  void compact_async();
+  // wait() waits for a background compaction and rethrows its exception.
+  void wait();
+
+  std::size_t num_keys() const;
+  std::size_t delta_size() const;
+  bool compacting() const;
+
+ private:
+  // A delta maps a key to true if it is inserted or false if it is erased.
+  using Delta = std::map<std::string, bool, std::less<>>;
+
+  mutable std::shared_mutex mutex_;
+  std::shared_ptr<const Trie> base_;
+  Delta delta_;
+  std::size_t num_keys_ = 0;
+  int config_flags_;
+
+  // `compaction_mutex_' serializes compactions, and `thread_mutex_' guards
+  // the background thread and its exception.
+  std::mutex compaction_mutex_;
+  std::mutex thread_mutex_;
+  std::thread compaction_thread_;
+  std::exception_ptr compaction_error_;
+  std::atomic<bool> compacting_{false};
+
+  void update(std::string_view key, bool is_inserted);
+  void compact_();
+
+  static bool base_lookup(const Trie *base, std::string_view key);
+};
+
+}  // namespace marisa
+
+#endif  // MARISA_DYNAMIC_TRIE_H_
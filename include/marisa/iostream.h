@@ -9,6 +9,8 @@ class Trie;
 
 std::istream &read(std::istream &stream, Trie *trie);
 std::ostream &write(std::ostream &stream, const Trie &trie);
+// `flags' is a combination of marisa_save_flags.
+std::ostream &write(std::ostream &stream, const Trie &trie, int flags);
 
 std::istream &operator>>(std::istream &stream, Trie &trie);
 std::ostream &operator<<(std::ostream &stream, const Trie &trie);
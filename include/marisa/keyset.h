@@ -19,6 +19,11 @@ class Keyset {
 
   Keyset();
 
+  // Creates a keyset which refers to keys in the "offsets + data" layout of
+  // Arrow string arrays. See push_back_refs() for details.
+  Keyset(const char *data, const uint32_t *offsets, std::size_t num_keys);
+  Keyset(const char *data, const uint64_t *offsets, std::size_t num_keys);
+
   Keyset(const Keyset &) = delete;
   Keyset &operator=(const Keyset &) = delete;
 
@@ -31,6 +36,23 @@ class Keyset {
   void push_back(const char *str);
   void push_back(const char *ptr, std::size_t length, float weight = 1.0);
 
+  // push_back_ref() appends a key without copying its bytes. Only a pointer,
+  // a length and a weight are stored, so the caller must keep the memory
+  // alive and unchanged, e.g. a memory-mapped file, while the keyset is used.
+  void push_back_ref(std::string_view str, float weight = 1.0) {
+    push_back_ref(str.data(), str.length(), weight);
+  }
+  void push_back_ref(const char *ptr, std::size_t length, float weight = 1.0);
+
+  // push_back_refs() appends `num_keys' keys stored in the "offsets + data"
+  // layout of Arrow string arrays: the i-th key is [data + offsets[i],
+  // data + offsets[i + 1]), so `offsets' has (num_keys + 1) elements. Keys
+  // are not copied as with push_back_ref().
+  void push_back_refs(const char *data, const uint32_t *offsets,
+                      std::size_t num_keys);
+  void push_back_refs(const char *data, const uint64_t *offsets,
+                      std::size_t num_keys);
+
   const Key &operator[](std::size_t i) const {
     assert(i < size_);
     return key_blocks_[i / KEY_BLOCK_SIZE][i % KEY_BLOCK_SIZE];
@@ -76,6 +98,10 @@ class Keyset {
 
   char *reserve(std::size_t size);
 
+  template <typename T>
+  void push_back_refs_(const char *data, const T *offsets,
+                       std::size_t num_keys);
+
   void append_base_block();
   void append_extra_block(std::size_t size);
   void append_key_block();
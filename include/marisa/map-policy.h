@@ -0,0 +1,79 @@
+#ifndef MARISA_MAP_POLICY_H_
+#define MARISA_MAP_POLICY_H_
+
+#include "marisa/base.h"
+
+// Sections of a dictionary are defined as members of marisa_section_type.
+// They are the types listed in the table of contents of the version 2
+// format. The version 1 format has the same sections without the table.
+// Each trie of a dictionary has its own index, tail and cache sections.
+enum marisa_section_type {
+  // MARISA_INDEX_SECTION has LOUDS, terminal flags, link flags, bases and
+  // extras of a trie, and is visited by every search.
+  MARISA_INDEX_SECTION = 1,
+
+  // MARISA_TAIL_SECTION has the suffixes of keys, and is visited at the end
+  // of a search.
+  MARISA_TAIL_SECTION = 2,
+
+  // MARISA_CACHE_SECTION has the cache of a trie, and is visited by every
+  // search.
+  MARISA_CACHE_SECTION = 3,
+
+  // MARISA_VALUE_SECTION, MARISA_POSTING_SECTION and
+  // MARISA_KEY_FILTER_SECTION have values, postings and the key filter.
+  MARISA_VALUE_SECTION = 4,
+  MARISA_POSTING_SECTION = 5,
+  MARISA_KEY_FILTER_SECTION = 6,
+
+  MARISA_NUM_SECTION_TYPES = 7,
+};
+
+// Advice for a section is a combination of marisa_map_advice.
+enum marisa_map_advice {
+  // MARISA_ADVICE_LOCK locks a section in memory with mlock(), which also
+  // populates it. An error is thrown if mlock() fails.
+  MARISA_ADVICE_LOCK = 1 << 0,
+
+  // MARISA_ADVICE_WILLNEED prefetches a section with MADV_WILLNEED.
+  MARISA_ADVICE_WILLNEED = 1 << 1,
+
+  // MARISA_ADVICE_RANDOM disables readahead for a section with MADV_RANDOM.
+  // It is ignored on Windows.
+  MARISA_ADVICE_RANDOM = 1 << 2,
+
+  // MARISA_ADVICE_HUGEPAGE specifies MADV_HUGEPAGE for a section of 2MB or
+  // more. It is ignored on Windows.
+  MARISA_ADVICE_HUGEPAGE = 1 << 3,
+
+  MARISA_ADVICE_MASK = (1 << 4) - 1,
+};
+
+namespace marisa {
+
+// MapPolicy is a table of advice keyed by section type, which is applied to
+// each section when a dictionary is mapped. The section flags of
+// marisa_map_flags are shorthands for common policies, and MapPolicy(flags)
+// gives the policy they mean. For example, a policy that locks only the top
+// of every trie and leaves values to the page cache is:
+//
+//   marisa::MapPolicy policy;
+//   policy.set(MARISA_INDEX_SECTION, MARISA_ADVICE_LOCK);
+//   policy.set(MARISA_CACHE_SECTION, MARISA_ADVICE_LOCK);
+//   policy.set(MARISA_VALUE_SECTION, MARISA_ADVICE_RANDOM);
+class MapPolicy {
+ public:
+  MapPolicy() = default;
+  explicit MapPolicy(int map_flags);
+
+  // set() throws std::invalid_argument if `type' or `advice' is invalid.
+  void set(marisa_section_type type, int advice);
+  int get(marisa_section_type type) const;
+
+ private:
+  int advice_[MARISA_NUM_SECTION_TYPES] = {};
+};
+
+}  // namespace marisa
+
+#endif  // MARISA_MAP_POLICY_H_
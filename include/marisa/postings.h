@@ -0,0 +1,103 @@
+#ifndef MARISA_POSTINGS_H_
+#define MARISA_POSTINGS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "marisa/base.h"
+
+namespace marisa {
+
+// PostingList is a read-only view of an ascending list of IDs attached to a
+// key. The IDs are stored as gaps in groups of 4, and each group is decoded
+// at once when an iterator reaches it.
+class PostingList {
+ public:
+  class Iterator {
+    friend class PostingList;
+
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = uint32_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const uint32_t *;
+    using reference = const uint32_t &;
+
+    Iterator() = default;
+
+    const uint32_t &operator*() const {
+      return buf_[pos_ % 4];
+    }
+
+    Iterator &operator++() {
+      ++pos_;
+      if (((pos_ % 4) == 0) && (pos_ < size_)) {
+        fill();
+      }
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator temp = *this;
+      ++*this;
+      return temp;
+    }
+
+    // Iterators are compared only by position, so they must belong to the
+    // same list.
+    bool operator==(const Iterator &rhs) const {
+      return pos_ == rhs.pos_;
+    }
+    bool operator!=(const Iterator &rhs) const {
+      return pos_ != rhs.pos_;
+    }
+
+   private:
+    const uint8_t *ctrl_ = nullptr;
+    const uint8_t *data_ = nullptr;
+    std::size_t pos_ = 0;
+    std::size_t size_ = 0;
+    uint32_t buf_[4] = {};
+
+    Iterator(const uint8_t *ptr, std::size_t pos, std::size_t size);
+
+    void fill();
+  };
+
+  PostingList() = default;
+  PostingList(const uint8_t *ptr, std::size_t size) : ptr_(ptr), size_(size) {}
+
+  Iterator begin() const {
+    return Iterator(ptr_, 0, size_);
+  }
+  Iterator end() const {
+    return Iterator(ptr_, size_, size_);
+  }
+
+  // decode() writes all the IDs to `ids', which must have room for size()
+  // IDs. It is faster than iteration.
+  void decode(uint32_t *ids) const;
+
+  bool empty() const {
+    return size_ == 0;
+  }
+  std::size_t size() const {
+    return size_;
+  }
+
+ private:
+  const uint8_t *ptr_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+// intersect() replaces the contents of `result' with the IDs that appear in
+// all the given lists. Lists are processed from the shortest one.
+void intersect(const PostingList &lhs, const PostingList &rhs,
+               std::vector<uint32_t> *result);
+void intersect(const PostingList *lists, std::size_t num_lists,
+               std::vector<uint32_t> *result);
+
+}  // namespace marisa
+
+#endif  // MARISA_POSTINGS_H_
@@ -0,0 +1,49 @@
+#ifndef MARISA_REPLICATED_TRIE_H_
+#define MARISA_REPLICATED_TRIE_H_
+
+#include <memory>
+
+#include "marisa/trie.h"
+
+namespace marisa {
+
+// ReplicatedTrie keeps a copy of a trie on each NUMA node, and local()
+// returns the copy on the node of the calling thread. So, threads on every
+// socket read local memory. The whole trie is replicated because every
+// search visits most of its sections. NUMA nodes are supported only on
+// Linux, and elsewhere there is only one copy.
+class ReplicatedTrie {
+ public:
+  ReplicatedTrie();
+  ~ReplicatedTrie();
+
+  ReplicatedTrie(const ReplicatedTrie &) = delete;
+  ReplicatedTrie &operator=(const ReplicatedTrie &) = delete;
+
+  ReplicatedTrie(ReplicatedTrie &&) noexcept;
+  ReplicatedTrie &operator=(ReplicatedTrie &&) noexcept;
+
+  // load() reads a dictionary file into a copy per node. `flags' accepts
+  // MARISA_MAP_HUGEPAGE and MARISA_MAP_VERIFY, which is applied to the
+  // first copy.
+  void load(const char *filename, int flags = 0);
+
+  // local() is cheap enough to be called per query, and should not be
+  // cached for long because threads may migrate across nodes.
+  const Trie &local() const;
+  // replica() returns the i-th copy. Copies are ordered by node ID.
+  const Trie &replica(std::size_t i) const;
+  std::size_t num_replicas() const;
+
+  void clear() noexcept;
+  void swap(ReplicatedTrie &rhs) noexcept;
+
+ private:
+  struct Impl;
+
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace marisa
+
+#endif  // MARISA_REPLICATED_TRIE_H_
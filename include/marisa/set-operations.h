@@ -0,0 +1,41 @@
+#ifndef MARISA_SET_OPERATIONS_H_
+#define MARISA_SET_OPERATIONS_H_
+
+#include <functional>
+#include <string_view>
+
+#include "marisa/trie.h"
+
+namespace marisa {
+
+// The following functions traverse two tries together in ascending
+// lexicographic order. Keys of a trie in MARISA_LABEL_ORDER are streamed by
+// predictive search in O(1) extra memory. Predictive search of a trie in
+// MARISA_WEIGHT_ORDER does not follow lexicographic order, so all the keys
+// of such a trie are copied into a std::vector<std::string> and sorted
+// before the traversal starts. This costs memory proportional to the total
+// length of its keys, plus the overhead of a std::string per key, and
+// O(n log n) time. So, MARISA_LABEL_ORDER is recommended for tries that are
+// merged or compared; check Trie::node_order() to see which applies.
+
+// set_union(), set_intersection() and set_difference() build `result' from
+// the keys in `lhs' or `rhs', in both, and in `lhs' but not in `rhs'
+// respectively. `config_flags' is passed to Trie::build().
+void set_union(const Trie &lhs, const Trie &rhs, Trie *result,
+               int config_flags = 0);
+void set_intersection(const Trie &lhs, const Trie &rhs, Trie *result,
+                      int config_flags = 0);
+void set_difference(const Trie &lhs, const Trie &rhs, Trie *result,
+                    int config_flags = 0);
+
+// A diff callback receives a key which exists only in `rhs' (is_added ==
+// true) or only in `lhs' (is_added == false), and returns false to stop.
+using DiffCallback = std::function<bool(std::string_view key, bool is_added)>;
+
+// diff() calls `callback' with the keys that differ between `lhs' and `rhs'
+// in ascending lexicographic order.
+void diff(const Trie &lhs, const Trie &rhs, const DiffCallback &callback);
+
+}  // namespace marisa
+
+#endif  // MARISA_SET_OPERATIONS_H_
@@ -0,0 +1,83 @@
+#ifndef MARISA_SIZE_REPORT_H_
+#define MARISA_SIZE_REPORT_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "marisa/base.h"
+
+namespace marisa {
+
+// ComponentSize is the size of a component in memory. `index_size' is the
+// part of `size' used by rank/select indexes, and is 0 for components
+// without indexes.
+struct ComponentSize {
+  std::size_t size = 0;
+  std::size_t index_size = 0;
+};
+
+// LevelSizeReport describes a level of a trie. Level 0 is the top-level
+// trie, and level i + 1 stores the reversed suffixes of links at level i.
+struct LevelSizeReport {
+  std::size_t num_nodes = 0;
+  // `num_terminals' is the number of keys, and is 0 except at level 0
+  // because the other levels map their terminals to links.
+  std::size_t num_terminals = 0;
+  // `num_links' is the number of nodes whose labels continue at the next
+  // level or in the tail.
+  std::size_t num_links = 0;
+  std::size_t num_cache_entries = 0;
+
+  ComponentSize louds;
+  ComponentSize terminal_flags;
+  ComponentSize link_flags;
+  ComponentSize bases;
+  ComponentSize extras;
+  ComponentSize cache;
+
+  std::size_t total_size() const {
+    return louds.size + terminal_flags.size + link_flags.size + bases.size +
+           extras.size + cache.size;
+  }
+};
+
+// TailSizeReport describes the tail, which stores the suffixes of links at
+// the last level. Suffixes share their bytes when one ends with another.
+struct TailSizeReport {
+  TailMode mode = MARISA_TEXT_TAIL;
+  std::size_t num_suffixes = 0;
+  // `unshared_size' is the size of `buf' if suffixes did not share bytes.
+  std::size_t unshared_size = 0;
+
+  ComponentSize buf;
+  ComponentSize end_flags;
+
+  std::size_t total_size() const {
+    return buf.size + end_flags.size;
+  }
+  // sharing_ratio() returns the ratio of bytes saved by sharing.
+  double sharing_ratio() const {
+    if (unshared_size == 0) {
+      return 0.0;
+    }
+    return 1.0 - (static_cast<double>(buf.size) /
+                  static_cast<double>(unshared_size));
+  }
+};
+
+// SizeReport breaks down Trie::total_size(), which is the sum of the sizes
+// of levels, the tail, values, postings and the key filter.
+struct SizeReport {
+  std::vector<LevelSizeReport> levels;
+  TailSizeReport tail;
+  std::size_t values_size = 0;
+  std::size_t postings_size = 0;
+  std::size_t filter_size = 0;
+
+  std::size_t total_size = 0;
+  std::size_t io_size = 0;
+};
+
+}  // namespace marisa
+
+#endif  // MARISA_SIZE_REPORT_H_
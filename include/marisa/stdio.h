@@ -9,6 +9,8 @@ class Trie;
 
 void fread(std::FILE *file, Trie *trie);
 void fwrite(std::FILE *file, const Trie &trie);
+// `flags' is a combination of marisa_save_flags.
+void fwrite(std::FILE *file, const Trie &trie, int flags);
 
 }  // namespace marisa
 
@@ -0,0 +1,92 @@
+#ifndef MARISA_TRIE_BUNDLE_H_
+#define MARISA_TRIE_BUNDLE_H_
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "marisa/trie.h"
+
+namespace marisa {
+
+// A bundle stores named tries in one file. It starts with a 16-byte magic
+// string, the size of the directory and the directory, which is a trie of
+// names in MARISA_LABEL_ORDER with the offset and the size of each trie as
+// its values. Tries follow the directory at offsets aligned to 64 bytes.
+//
+// TrieBundle maps a bundle with one mapping, and each trie is mapped in
+// place on first access. Section flags such as MARISA_MAP_LOCK_INDEX are
+// not applied to tries in a bundle.
+class TrieBundle {
+ public:
+  TrieBundle();
+  ~TrieBundle();
+
+  TrieBundle(const TrieBundle &) = delete;
+  TrieBundle &operator=(const TrieBundle &) = delete;
+
+  TrieBundle(TrieBundle &&) noexcept;
+  TrieBundle &operator=(TrieBundle &&) noexcept;
+
+  // If `flags' has MARISA_MAP_VERIFY, each trie is verified when it is
+  // mapped.
+  void mmap(const char *filename, int flags = 0);
+  void map(const void *ptr, std::size_t size);
+
+  // find() returns nullptr if there is no trie named `name'. find() and
+  // trie() are thread-safe.
+  const Trie *find(std::string_view name) const;
+
+  // Tries are numbered in lexicographic order of their names.
+  const Trie &trie(std::size_t i) const;
+  std::string name(std::size_t i) const;
+  // offset() and io_size() return the range of the i-th trie in the bundle.
+  std::size_t offset(std::size_t i) const;
+  std::size_t io_size(std::size_t i) const;
+
+  bool empty() const;
+  std::size_t size() const;
+
+  void clear() noexcept;
+  void swap(TrieBundle &rhs) noexcept;
+
+ private:
+  struct Impl;
+
+  std::unique_ptr<Impl> impl_;
+};
+
+// TrieBundleBuilder writes a bundle of tries.
+class TrieBundleBuilder {
+ public:
+  TrieBundleBuilder();
+  ~TrieBundleBuilder();
+
+  TrieBundleBuilder(const TrieBundleBuilder &) = delete;
+  TrieBundleBuilder &operator=(const TrieBundleBuilder &) = delete;
+
+  // add() does not copy `trie', so it must be alive until the bundle is
+  // written. Names must be unique.
+  void add(std::string_view name, const Trie &trie);
+
+  // `flags' is a combination of marisa_save_flags, which is applied to each
+  // trie. MARISA_SAVE_V2 keeps vectors of tries aligned in memory.
+  void save(const char *filename, int flags = 0) const;
+  void write(std::ostream &stream, int flags = 0) const;
+
+  std::size_t size() const {
+    return entries_.size();
+  }
+
+  void clear() noexcept;
+
+ private:
+  std::vector<std::pair<std::string, const Trie *>> entries_;
+};
+
+}  // namespace marisa
+
+#endif  // MARISA_TRIE_BUNDLE_H_
@@ -0,0 +1,64 @@
+#ifndef MARISA_TRIE_HANDLE_H_
+#define MARISA_TRIE_HANDLE_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "marisa/trie.h"
+
+namespace marisa {
+
+// TrieHandle publishes a Trie to readers for hot reloading. Readers take a
+// snapshot without locking and keep using it even after a new trie has been
+// published. A replaced trie is retired, and it is destroyed, and so its
+// file is unmapped, by reclaim() in the publishing thread once no reader
+// holds a snapshot of it. So, readers never pay for unmapping.
+//
+// snapshot() is thread-safe. Publishing functions are serialized by a mutex.
+class TrieHandle {
+ public:
+  using Snapshot = std::shared_ptr<const Trie>;
+
+  TrieHandle();
+  explicit TrieHandle(Trie &&trie);
+  ~TrieHandle();
+
+  TrieHandle(const TrieHandle &) = delete;
+  TrieHandle &operator=(const TrieHandle &) = delete;
+
+  // snapshot() returns nullptr if no trie has been published.
+  Snapshot snapshot() const;
+
+  // publish() replaces the current trie, and then calls reclaim().
+  void publish(Trie &&trie);
+  // mmap() and load() open a new trie and publish it. If opening fails, the
+  // current trie is kept.
+  void mmap(const char *filename, int flags = 0);
+  void load(const char *filename);
+
+  // reclaim() destroys retired tries which are no longer in use, and returns
+  // the number of retired tries still in use.
+  std::size_t reclaim();
+
+  // generation() is incremented for each publication.
+  std::size_t generation() const;
+
+ private:
+#ifdef __cpp_lib_atomic_shared_ptr
+  std::atomic<Snapshot> current_;
+#else   // __cpp_lib_atomic_shared_ptr
+  Snapshot current_;
+#endif  // __cpp_lib_atomic_shared_ptr
+  std::atomic<std::size_t> generation_{0};
+
+  std::mutex mutex_;
+  std::vector<Snapshot> retired_;
+
+  std::size_t reclaim_();
+};
+
+}  // namespace marisa
+
+#endif  // MARISA_TRIE_HANDLE_H_
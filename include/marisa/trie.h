@@ -1,10 +1,17 @@
 #ifndef MARISA_TRIE_H_
 #define MARISA_TRIE_H_
 
+#include <future>
 #include <memory>
+#include <optional>
+#include <string_view>
 
-#include "marisa/agent.h"   // IWYU pragma: export
-#include "marisa/keyset.h"  // IWYU pragma: export
+#include "marisa/agent.h"          // IWYU pragma: export
+#include "marisa/build-profile.h"  // IWYU pragma: export
+#include "marisa/keyset.h"         // IWYU pragma: export
+#include "marisa/map-policy.h"     // IWYU pragma: export
+#include "marisa/postings.h"       // IWYU pragma: export
+#include "marisa/size-report.h"    // IWYU pragma: export
 
 namespace marisa {
 namespace grimoire::trie {
@@ -27,21 +34,126 @@ class Trie {
   Trie &operator=(Trie &&) noexcept;
 
   void build(Keyset &keyset, int config_flags = 0);
+  // build() with `callback' reports the time and the peak size of vectors
+  // of each phase of the build. `callback' is called in the calling thread
+  // at the end of each phase, so it can also report progress.
+  void build(Keyset &keyset, int config_flags, const BuildCallback &callback);
 
   void mmap(const char *filename, int flags = 0);
+  // mmap() with `offset' maps a trie embedded in a larger file, such as a
+  // bundle of tries. If `size' is 0, the trie extends to the end of the
+  // file. `offset' need not be aligned to pages, but it should be a multiple
+  // of 64 for the version 2 format to keep vectors aligned in memory.
+  void mmap(const char *filename, std::size_t offset, std::size_t size,
+            int flags = 0);
+  // map_fd() maps `size' bytes at `offset' of the file referred to by `fd',
+  // e.g. a descriptor given by create_memfd() in another process. If `size'
+  // is 0, the trie extends to the end of the file. The caller may close `fd'
+  // after map_fd() returns.
+  void map_fd(int fd, std::size_t offset = 0, std::size_t size = 0,
+              int flags = 0);
+  // mmap() and map_fd() with `policy' advise each section by `policy' instead
+  // of the section flags in `flags', such as MARISA_MAP_LOCK_INDEX.
+  void mmap(const char *filename, int flags, const MapPolicy &policy);
+  void mmap(const char *filename, std::size_t offset, std::size_t size,
+            int flags, const MapPolicy &policy);
+  void map_fd(int fd, std::size_t offset, std::size_t size, int flags,
+              const MapPolicy &policy);
   void map(const void *ptr, std::size_t size);
 
   void load(const char *filename);
+  // load() and read() with `flags' accept only MARISA_MAP_VERIFY, which
+  // rejects a corrupted file in the version 2 format as mmap() does.
+  void load(const char *filename, int flags);
   void read(int fd);
+  void read(int fd, int flags);
 
   void save(const char *filename) const;
+  // `flags' is a combination of marisa_save_flags.
+  void save(const char *filename, int flags) const;
   void write(int fd) const;
+  // write() with `flags' writes the trie at the current position of `fd',
+  // and returns the number of bytes written, which is equal to
+  // io_size(flags). The position and the size are what mmap() and map_fd()
+  // take to map the trie.
+  std::size_t write(int fd, int flags) const;
+  // create_memfd() writes the trie into a sealed memory file, and returns
+  // its descriptor, which the caller must close. The descriptor can be
+  // passed to other processes, e.g. via fork() or SCM_RIGHTS, and they share
+  // the pages of the trie by map_fd(). `name' is only for debugging. This is
+  // supported only on Linux and FreeBSD. Elsewhere, or if the file cannot be
+  // sealed, it throws std::system_error instead of returning a writable
+  // descriptor.
+  int create_memfd(const char *name, int flags = 0) const;
+
+  // verify() returns false if the trie was loaded or mapped from a corrupted
+  // file in the version 2 format. It scans the whole file, so it may be
+  // called by verify_async() in a background thread. It returns true for the
+  // version 1 format because it has no checksums. set_values() and the like
+  // do not affect the result because the loaded image is not modified.
+  bool verify() const;
+  // verify_async() keeps the loaded image alive until the result is ready,
+  // so the trie may be cleared, replaced or destroyed in the meantime.
+  std::future<bool> verify_async() const;
 
   bool lookup(Agent &agent) const;
+  // lookup() and contains() without an agent need no state, so they
+  // allocate no memory and may be called concurrently from any thread.
+  // lookup() returns the key ID of `key', or std::nullopt if `key' is not
+  // found.
+  std::optional<std::size_t> lookup(std::string_view key) const;
+  bool contains(std::string_view key) const {
+    return lookup(key).has_value();
+  }
   void reverse_lookup(Agent &agent) const;
   bool common_prefix_search(Agent &agent) const;
   bool predictive_search(Agent &agent) const;
 
+  // Values are attached to keys by key ID, and saved, loaded and mapped
+  // together with the trie. `num_values' must be equal to num_keys(), and the
+  // i-th value belongs to the key whose ID is i. set_values() with
+  // `value_size' stores fixed-width values, and set_values() with views
+  // stores variable-width values. Both copy the given values.
+  void set_values(const void *values, std::size_t value_size,
+                  std::size_t num_values);
+  void set_values(const std::string_view *values, std::size_t num_values);
+  void clear_values();
+
+  bool has_values() const;
+  // value_size() returns 0 if values are variable-width.
+  std::size_t value_size() const;
+  // A returned view is valid while the trie is alive and not modified.
+  std::string_view value(std::size_t key_id) const;
+
+  // lookup_value() does lookup() and then gets the value of the found key.
+  bool lookup_value(Agent &agent, std::string_view *value) const;
+
+  // Postings are ascending lists of IDs attached to keys by key ID, and
+  // saved, loaded and mapped together with the trie. The list of the key
+  // whose ID is i consists of ids[offsets[i]], ..., ids[offsets[i + 1] - 1],
+  // so `offsets' has num_keys() + 1 elements.
+  void set_postings(const uint32_t *ids, const uint64_t *offsets,
+                    std::size_t num_lists);
+  void clear_postings();
+
+  bool has_postings() const;
+  // A returned list is valid while the trie is alive and not modified.
+  PostingList postings(std::size_t key_id) const;
+
+  // lookup_postings() does lookup() and then gets the list of the found key.
+  bool lookup_postings(Agent &agent, PostingList *postings) const;
+
+  // A key filter is a Bloom filter of keys, which is saved, loaded and
+  // mapped together with the trie. lookup() and the functions based on it
+  // check the filter first, so most misses cost one cache line instead of a
+  // walk down the trie. The false positive rate is about 1% with 10 bits per
+  // key, and halves with every 1.44 more bits. Search functions do not use
+  // the filter.
+  void set_filter(std::size_t bits_per_key = 10);
+  void clear_filter();
+
+  bool has_filter() const;
+
   std::size_t num_tries() const;
   std::size_t num_keys() const;
   std::size_t num_nodes() const;
@@ -53,12 +165,18 @@ class Trie {
   std::size_t size() const;
   std::size_t total_size() const;
   std::size_t io_size() const;
+  // io_size() with `flags' returns the size of the format specified by
+  // `flags'.
+  std::size_t io_size(int flags) const;
+  // size_report() breaks down total_size() into the components of each
+  // level, the tail, values and postings.
+  SizeReport size_report() const;
 
   void clear() noexcept;
   void swap(Trie &rhs) noexcept;
 
  private:
-  std::unique_ptr<grimoire::trie::LoudsTrie> trie_;
+  std::shared_ptr<grimoire::trie::LoudsTrie> trie_;
 };
 
 }  // namespace marisa
@@ -0,0 +1,267 @@
+#include "marisa/dynamic-trie.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace marisa {
+
+DynamicTrie::DynamicTrie(int config_flags) : config_flags_(config_flags) {}
+
+DynamicTrie::DynamicTrie(Trie &&base, int config_flags)
+    : base_(std::make_shared<Trie>(std::move(base))),
+      num_keys_(base_->num_keys()),
+      config_flags_(config_flags) {}
+
+DynamicTrie::~DynamicTrie() {
+  std::lock_guard<std::mutex> lock(thread_mutex_);
+  if (compaction_thread_.joinable()) {
+    compaction_thread_.join();
+  }
+}
+
+void DynamicTrie::insert(std::string_view key) {
+  update(key, true);
+}
+
+void DynamicTrie::erase(std::string_view key) {
+  update(key, false);
+}
+
+bool DynamicTrie::lookup(std::string_view key) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const Delta::const_iterator it = delta_.find(key);
+  if (it != delta_.end()) {
+    return it->second;
+  }
+  return base_lookup(base_.get(), key);
+}
+
+void DynamicTrie::common_prefix_search(std::string_view query,
+                                       const Callback &callback) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+
+  // Prefixes in the delta are merged into the results of the base trie in
+  // ascending order of length. `delta_pos' is the minimum length of the next
+  // prefix in the delta. Prefixes of the query are sorted by length, so the
+  // first entry not less than the prefix of `delta_pos' bytes is either the
+  // next prefix or tells where the next one may be, and the delta is walked
+  // by lower_bound() without a lookup per length.
+  std::size_t delta_pos = 0;
+  const auto search_delta = [&](std::size_t end) {
+    while (delta_pos < end) {
+      const Delta::const_iterator it =
+          delta_.lower_bound(query.substr(0, delta_pos));
+      if (it == delta_.end()) {
+        delta_pos = SIZE_MAX;
+        break;
+      }
+      const std::string_view key = it->first;
+      const std::size_t length = static_cast<std::size_t>(
+          std::mismatch(key.begin(), key.end(), query.begin(), query.end())
+              .first -
+          key.begin());
+      if (length == key.length()) {
+        // `key' is a prefix of the query.
+        if (length >= end) {
+          delta_pos = length;
+          break;
+        }
+        if (it->second && !callback(key)) {
+          return false;
+        }
+        delta_pos = length + 1;
+      } else if ((length < query.length()) &&
+                 (static_cast<unsigned char>(key[length]) <
+                  static_cast<unsigned char>(query[length]))) {
+        delta_pos = length + 1;
+      } else {
+        // `key' is greater than the prefixes longer than `delta_pos'.
+        delta_pos = SIZE_MAX;
+      }
+    }
+    return true;
+  };
+
+  if (base_ != nullptr) {
+    Agent agent;
+    agent.set_query(query);
+    while (base_->common_prefix_search(agent)) {
+      const std::string_view key = agent.key().str();
+      if (!search_delta(key.length())) {
+        return;
+      }
+      // A key with an entry in the delta is left to search_delta().
+      if (delta_.find(key) == delta_.end()) {
+        if (!callback(key)) {
+          return;
+        }
+        delta_pos = std::max(delta_pos, key.length() + 1);
+      }
+    }
+  }
+  search_delta(query.length() + 1);
+}
+
+// Keys of the base trie come first in the order of Trie::predictive_search(),
+// and then keys inserted in the delta in lexicographic order.
+
+void DynamicTrie::predictive_search(std::string_view query,
+                                    const Callback &callback) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+
+  if (base_ != nullptr) {
+    Agent agent;
+    agent.set_query(query);
+    while (base_->predictive_search(agent)) {
+      // A key with an entry in the delta is left to the loop below.
+      const std::string_view key = agent.key().str();
+      if ((delta_.find(key) == delta_.end()) && !callback(key)) {
+        return;
+      }
+    }
+  }
+
+  for (Delta::const_iterator it = delta_.lower_bound(query);
+       (it != delta_.end()) &&
+       (it->first.compare(0, query.length(), query) == 0);
+       ++it) {
+    if (it->second && !callback(it->first)) {
+      return;
+    }
+  }
+}
+
+void DynamicTrie::compact() {
+  compact_();
+}
+
+void DynamicTrie::compact_async() {
+  std::lock_guard<std::mutex> lock(thread_mutex_);
+  if (compacting_) {
+    return;
+  }
+  if (compaction_thread_.joinable()) {
+    compaction_thread_.join();
+  }
+  // The error of the last compaction is kept until wait() reports it.
+  if (compaction_error_ != nullptr) {
+    return;
+  }
+  compacting_ = true;
+  compaction_thread_ = std::thread([this] {
+    try {
+      compact_();
+    } catch (...) {
+      // The exception is rethrown by wait() after join().
+      compaction_error_ = std::current_exception();
+    }
+    compacting_ = false;
+  });
+}
+
+void DynamicTrie::wait() {
+  std::lock_guard<std::mutex> lock(thread_mutex_);
+  if (compaction_thread_.joinable()) {
+    compaction_thread_.join();
+  }
+  if (compaction_error_ != nullptr) {
+    std::exception_ptr error;
+    std::swap(error, compaction_error_);
+    std::rethrow_exception(error);
+  }
+}
+
+std::size_t DynamicTrie::num_keys() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return num_keys_;
+}
+
+std::size_t DynamicTrie::delta_size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return delta_.size();
+}
+
+bool DynamicTrie::compacting() const {
+  return compacting_;
+}
+
+void DynamicTrie::update(std::string_view key, bool is_inserted) {
+  MARISA_THROW_IF(key.length() > UINT32_MAX, std::invalid_argument);
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  bool was_inserted;
+  const Delta::iterator it = delta_.find(key);
+  if (it != delta_.end()) {
+    // An existing entry is kept even if the base trie agrees with it, because
+    // the entry may be in a compaction that is running.
+    was_inserted = it->second;
+    it->second = is_inserted;
+  } else {
+    was_inserted = base_lookup(base_.get(), key);
+    if (was_inserted != is_inserted) {
+      delta_.emplace(key, is_inserted);
+    }
+  }
+  if (is_inserted && !was_inserted) {
+    ++num_keys_;
+  } else if (!is_inserted && was_inserted) {
+    --num_keys_;
+  }
+}
+
+void DynamicTrie::compact_() {
+  std::lock_guard<std::mutex> compaction_lock(compaction_mutex_);
+
+  // The base trie and a copy of the delta are taken as a snapshot, and the
+  // new base trie is built without blocking lookups and updates.
+  std::shared_ptr<const Trie> base;
+  Delta pending;
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    base = base_;
+    pending = delta_;
+  }
+
+  Keyset keyset;
+  if (base != nullptr) {
+    Agent agent;
+    agent.set_query("");
+    while (base->predictive_search(agent)) {
+      if (pending.find(agent.key().str()) == pending.end()) {
+        keyset.push_back(agent.key().str());
+      }
+    }
+  }
+  for (const auto &[key, is_inserted] : pending) {
+    if (is_inserted) {
+      keyset.push_back_ref(key);
+    }
+  }
+
+  std::shared_ptr<Trie> new_base = std::make_shared<Trie>();
+  new_base->build(keyset, config_flags_);
+
+  // Entries applied to the new base trie are removed from the delta unless
+  // they have been updated since the snapshot.
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  for (const auto &[key, is_inserted] : pending) {
+    const Delta::iterator it = delta_.find(key);
+    if ((it != delta_.end()) && (it->second == is_inserted)) {
+      delta_.erase(it);
+    }
+  }
+  base_ = std::move(new_base);
+}
+
+bool DynamicTrie::base_lookup(const Trie *base, std::string_view key) {
+  if (base == nullptr) {
+    return false;
+  }
+  Agent agent;
+  agent.set_query(key);
+  return base->lookup(agent);
+}
+
+}  // namespace marisa
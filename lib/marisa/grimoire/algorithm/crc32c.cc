@@ -0,0 +1,143 @@
+#include "marisa/grimoire/algorithm/crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#include "marisa/grimoire/intrin.h"
+
+// Without MARISA_USE_SSE4_2, SSE4.2 instructions are still used on x86 if
+// the CPU supports them at run time.
+#if !defined(MARISA_USE_SSE4_2) && \
+    (defined(MARISA_X64) || defined(MARISA_X86)) && \
+    (defined(__GNUC__) || defined(_MSC_VER))
+ #define MARISA_CRC32C_DISPATCH
+#endif  // !defined(MARISA_USE_SSE4_2) && ...
+
+#if defined(MARISA_USE_SSE4_2) || defined(MARISA_CRC32C_DISPATCH)
+ #ifdef _MSC_VER
+  #include <intrin.h>
+ #else  // _MSC_VER
+  #include <nmmintrin.h>
+ #endif  // _MSC_VER
+#endif   // defined(MARISA_USE_SSE4_2) || defined(MARISA_CRC32C_DISPATCH)
+
+#if defined(MARISA_CRC32C_DISPATCH) && defined(__GNUC__)
+ #define MARISA_CRC32C_TARGET_SSE4_2 __attribute__((target("sse4.2")))
+#else  // defined(MARISA_CRC32C_DISPATCH) && defined(__GNUC__)
+ #define MARISA_CRC32C_TARGET_SSE4_2
+#endif  // defined(MARISA_CRC32C_DISPATCH) && defined(__GNUC__)
+
+namespace marisa::grimoire::algorithm {
+namespace {
+
+#if defined(MARISA_USE_SSE4_2) || defined(MARISA_CRC32C_DISPATCH)
+
+MARISA_CRC32C_TARGET_SSE4_2 uint32_t update_sse4_2(uint32_t crc,
+                                                   const uint8_t *ptr,
+                                                   std::size_t size) {
+  for (; (size != 0) && ((reinterpret_cast<uintptr_t>(ptr) % 8) != 0);
+       --size) {
+    crc = _mm_crc32_u8(crc, *ptr++);
+  }
+ #ifdef MARISA_X64
+  uint64_t crc64 = crc;
+  for (; size >= 8; size -= 8) {
+    uint64_t unit;
+    std::memcpy(&unit, ptr, sizeof(unit));
+    crc64 = _mm_crc32_u64(crc64, unit);
+    ptr += 8;
+  }
+  crc = static_cast<uint32_t>(crc64);
+ #else   // MARISA_X64
+  for (; size >= 4; size -= 4) {
+    uint32_t unit;
+    std::memcpy(&unit, ptr, sizeof(unit));
+    crc = _mm_crc32_u32(crc, unit);
+    ptr += 4;
+  }
+ #endif  // MARISA_X64
+  for (; size != 0; --size) {
+    crc = _mm_crc32_u8(crc, *ptr++);
+  }
+  return crc;
+}
+
+#endif  // defined(MARISA_USE_SSE4_2) || defined(MARISA_CRC32C_DISPATCH)
+
+#ifndef MARISA_USE_SSE4_2
+
+// TABLES[k][i] is the CRC of byte i followed by k zero bytes, which allows
+// 8 bytes to be processed at once (slicing-by-8).
+constexpr std::array<std::array<uint32_t, 256>, 8> make_tables() {
+  constexpr uint32_t POLY = 0x82F63B78U;  // Reversed 0x1EDC6F41.
+  std::array<std::array<uint32_t, 256>, 8> tables = {};
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int j = 0; j < 8; ++j) {
+      crc = (crc >> 1) ^ ((crc & 1) ? POLY : 0);
+    }
+    tables[0][i] = crc;
+  }
+  for (uint32_t i = 0; i < 256; ++i) {
+    for (std::size_t k = 1; k < 8; ++k) {
+      const uint32_t prev = tables[k - 1][i];
+      tables[k][i] = (prev >> 8) ^ tables[0][prev & 0xFF];
+    }
+  }
+  return tables;
+}
+
+constexpr std::array<std::array<uint32_t, 256>, 8> TABLES = make_tables();
+
+uint32_t update_table(uint32_t crc, const uint8_t *ptr, std::size_t size) {
+  for (; size >= 8; size -= 8) {
+    const uint32_t lo = crc ^ (uint32_t{ptr[0]} | (uint32_t{ptr[1]} << 8) |
+                               (uint32_t{ptr[2]} << 16) |
+                               (uint32_t{ptr[3]} << 24));
+    crc = TABLES[7][lo & 0xFF] ^ TABLES[6][(lo >> 8) & 0xFF] ^
+          TABLES[5][(lo >> 16) & 0xFF] ^ TABLES[4][lo >> 24] ^
+          TABLES[3][ptr[4]] ^ TABLES[2][ptr[5]] ^ TABLES[1][ptr[6]] ^
+          TABLES[0][ptr[7]];
+    ptr += 8;
+  }
+  for (; size != 0; --size) {
+    crc = (crc >> 8) ^ TABLES[0][(crc ^ *ptr++) & 0xFF];
+  }
+  return crc;
+}
+
+#endif  // MARISA_USE_SSE4_2
+
+#ifdef MARISA_CRC32C_DISPATCH
+
+bool has_sse4_2() {
+ #ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 20)) != 0;
+ #else   // _MSC_VER
+  return __builtin_cpu_supports("sse4.2");
+ #endif  // _MSC_VER
+}
+
+#endif  // MARISA_CRC32C_DISPATCH
+
+uint32_t update(uint32_t crc, const uint8_t *ptr, std::size_t size) {
+#if defined(MARISA_USE_SSE4_2)
+  return update_sse4_2(crc, ptr, size);
+#elif defined(MARISA_CRC32C_DISPATCH)
+  static const bool use_sse4_2 = has_sse4_2();
+  return use_sse4_2 ? update_sse4_2(crc, ptr, size)
+                    : update_table(crc, ptr, size);
+#else   // defined(MARISA_USE_SSE4_2)
+  return update_table(crc, ptr, size);
+#endif  // defined(MARISA_USE_SSE4_2)
+}
+
+}  // namespace
+
+uint32_t crc32c(const void *data, std::size_t size, uint32_t crc) {
+  return ~update(~crc, static_cast<const uint8_t *>(data), size);
+}
+
+}  // namespace marisa::grimoire::algorithm
@@ -0,0 +1,16 @@
+#ifndef MARISA_GRIMOIRE_ALGORITHM_CRC32C_H_
+#define MARISA_GRIMOIRE_ALGORITHM_CRC32C_H_
+
+#include "marisa/base.h"
+
+namespace marisa::grimoire::algorithm {
+
+// crc32c() returns the CRC-32C (Castagnoli) of `data'. The checksum of
+// concatenated data is computed by passing the checksum of the preceding
+// data as `crc'. SSE4.2 instructions are used if MARISA_USE_SSE4_2 is
+// defined, or on x86 if the CPU supports them.
+uint32_t crc32c(const void *data, std::size_t size, uint32_t crc = 0);
+
+}  // namespace marisa::grimoire::algorithm
+
+#endif  // MARISA_GRIMOIRE_ALGORITHM_CRC32C_H_
@@ -1,4 +1,5 @@
 #if (defined _WIN32) || (defined _WIN64)
+ #include <io.h>
  #include <sys/stat.h>
  #include <sys/types.h>
  #include <windows.h>
@@ -10,12 +11,59 @@
  #include <unistd.h>
 #endif  // (defined _WIN32) || (defined _WIN64)
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <cerrno>
+#include <exception>
+#include <new>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 #include "marisa/grimoire/io/mapper.h"
+#include "marisa/grimoire/io/reader.h"
 
 namespace marisa::grimoire::io {
+namespace {
+
+// `num_readers_override' is set by Mapper::set_num_readers().
+std::atomic<std::size_t> num_readers_override{0};
+
+constexpr std::align_val_t BUFFER_ALIGNMENT{64};
+
+}  // namespace
+
+#if !(defined _WIN32) && !(defined _WIN64)
+namespace {
+
+constexpr std::size_t HUGE_PAGE_SIZE = std::size_t{1} << 21;
+
+// A file of PARALLEL_READ_SIZE or more is read by up to MAX_NUM_READERS
+// threads in MARISA_MAP_BULK_LOAD mode.
+constexpr std::size_t PARALLEL_READ_SIZE = std::size_t{1} << 28;
+constexpr std::size_t MAX_NUM_READERS = 4;
+
+void pread_all(int fd, char *buf, std::size_t size, std::size_t offset) {
+  while (size != 0) {
+    // A single read() is limited to about 2GB on Linux.
+    const std::size_t count = std::min(size, std::size_t{1} << 30);
+    const ssize_t result =
+        ::pread(fd, buf, count, static_cast<off_t>(offset));
+    if ((result == -1) && (errno == EINTR)) {
+      continue;
+    }
+    MARISA_THROW_SYSTEM_ERROR_IF(result == -1, errno, std::generic_category(),
+                                 "pread");
+    MARISA_THROW_IF(result == 0, std::runtime_error);
+    buf += result;
+    size -= static_cast<std::size_t>(result);
+    offset += static_cast<std::size_t>(result);
+  }
+}
+
+}  // namespace
+#endif  // !(defined _WIN32) && !(defined _WIN64)
 
 #if (defined _WIN32) || (defined _WIN64)
 Mapper::Mapper() = default;
@@ -54,7 +102,24 @@ void Mapper::open(const char *filename, int flags) {
   MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
 
   Mapper temp;
-  temp.open_(filename, flags);
+  temp.open_(filename, 0, 0, flags);
+  swap(temp);
+}
+
+void Mapper::open(const char *filename, std::size_t offset, std::size_t size,
+                  int flags) {
+  MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
+
+  Mapper temp;
+  temp.open_(filename, offset, size, flags);
+  swap(temp);
+}
+
+void Mapper::open(int fd, std::size_t offset, std::size_t size, int flags) {
+  MARISA_THROW_IF(fd == -1, std::invalid_argument);
+
+  Mapper temp;
+  temp.open_(fd, offset, size, flags);
   swap(temp);
 }
 
@@ -66,6 +131,19 @@ void Mapper::open(const void *ptr, std::size_t size) {
   swap(temp);
 }
 
+void Mapper::load(Reader &reader, std::size_t size) {
+  MARISA_THROW_IF(!reader.is_open(), std::invalid_argument);
+
+  Mapper temp;
+  temp.buf_.reset(
+      static_cast<char *>(::operator new[](size, BUFFER_ALIGNMENT)));
+  temp.offset_ = reader.offset();
+  reader.read(temp.buf_.get(), size);
+  temp.ptr_ = temp.buf_.get();
+  temp.avail_ = size;
+  swap(temp);
+}
+
 void Mapper::seek(std::size_t size) {
   MARISA_THROW_IF(!is_open(), std::logic_error);
   MARISA_THROW_IF(size > avail_, std::runtime_error);
@@ -73,6 +151,94 @@ void Mapper::seek(std::size_t size) {
   map_data(size);
 }
 
+void Mapper::limit(std::size_t size) {
+  MARISA_THROW_IF(!is_open(), std::logic_error);
+  MARISA_THROW_IF(size > avail_, std::runtime_error);
+
+  hidden_ += avail_ - size;
+  avail_ = size;
+}
+
+void Mapper::BufferDeleter::operator()(char *buf) const noexcept {
+  ::operator delete[](buf, BUFFER_ALIGNMENT);
+}
+
+void Mapper::set_num_readers(std::size_t num_readers) {
+  num_readers_override.store(num_readers, std::memory_order_relaxed);
+}
+
+void Mapper::set_alignment(std::size_t alignment) {
+  MARISA_THROW_IF((alignment == 0) || ((alignment & (alignment - 1)) != 0),
+                  std::invalid_argument);
+  alignment_ = alignment;
+}
+
+#if (defined _WIN32) || (defined _WIN64)
+void Mapper::advise(const void *begin, const void *end,
+                    marisa_section_type type) {
+  assert(begin <= end);
+  const int advice = policy_.get(type);
+  if ((origin_ == nullptr) || (begin == end) || (advice == 0)) {
+    return;
+  }
+
+  // MARISA_ADVICE_RANDOM and MARISA_ADVICE_HUGEPAGE are ignored because
+  // Windows has no counterparts of them for file mappings.
+  void *const addr = const_cast<void *>(begin);
+  const std::size_t size = static_cast<std::size_t>(
+      static_cast<const char *>(end) - static_cast<const char *>(begin));
+  if (advice & MARISA_ADVICE_LOCK) {
+    MARISA_THROW_SYSTEM_ERROR_IF(!::VirtualLock(addr, size), ::GetLastError(),
+                                 std::system_category(), "VirtualLock");
+  }
+  if (advice & MARISA_ADVICE_WILLNEED) {
+    WIN32_MEMORY_RANGE_ENTRY range_entry;
+    range_entry.VirtualAddress = addr;
+    range_entry.NumberOfBytes = size;
+    ::PrefetchVirtualMemory(GetCurrentProcess(), 1, &range_entry, 0);
+  }
+}
+#else   // (defined _WIN32) || (defined _WIN64)
+void Mapper::advise(const void *begin, const void *end,
+                    marisa_section_type type) {
+  assert(begin <= end);
+  const int advice = policy_.get(type);
+  if ((origin_ == MAP_FAILED) || (begin == end) || (advice == 0)) {
+    return;
+  }
+
+  const std::size_t page_size =
+      static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  const uintptr_t first =
+      reinterpret_cast<uintptr_t>(begin) & ~uintptr_t{page_size - 1};
+  void *const addr = reinterpret_cast<void *>(first);
+  const std::size_t size =
+      static_cast<std::size_t>(reinterpret_cast<uintptr_t>(end) - first);
+
+  // Failures of madvise() are ignored because advice is only a hint.
+  if (advice & MARISA_ADVICE_LOCK) {
+    MARISA_THROW_SYSTEM_ERROR_IF(::mlock(addr, size) != 0, errno,
+                                 std::generic_category(), "mlock");
+  }
+ #if defined(MADV_WILLNEED)
+  if (advice & MARISA_ADVICE_WILLNEED) {
+    ::madvise(addr, size, MADV_WILLNEED);
+  }
+ #endif  // defined(MADV_WILLNEED)
+ #if defined(MADV_RANDOM)
+  if (advice & MARISA_ADVICE_RANDOM) {
+    ::madvise(addr, size, MADV_RANDOM);
+  }
+ #endif  // defined(MADV_RANDOM)
+ #if defined(MADV_HUGEPAGE)
+  // `MADV_HUGEPAGE` is Linux-specific.
+  if ((advice & MARISA_ADVICE_HUGEPAGE) && (size >= (std::size_t{1} << 21))) {
+    ::madvise(addr, size, MADV_HUGEPAGE);
+  }
+ #endif  // defined(MADV_HUGEPAGE)
+}
+#endif  // (defined _WIN32) || (defined _WIN64)
+
 bool Mapper::is_open() const {
   return ptr_ != nullptr;
 }
@@ -84,8 +250,13 @@ void Mapper::clear() noexcept {
 void Mapper::swap(Mapper &rhs) noexcept {
   std::swap(ptr_, rhs.ptr_);
   std::swap(avail_, rhs.avail_);
+  std::swap(hidden_, rhs.hidden_);
+  buf_.swap(rhs.buf_);
   std::swap(origin_, rhs.origin_);
   std::swap(size_, rhs.size_);
+  std::swap(policy_, rhs.policy_);
+  std::swap(offset_, rhs.offset_);
+  std::swap(alignment_, rhs.alignment_);
 #if (defined _WIN32) || (defined _WIN64)
   std::swap(file_, rhs.file_);
   std::swap(map_, rhs.map_);
@@ -101,6 +272,7 @@ const void *Mapper::map_data(std::size_t size) {
   const char *const data = static_cast<const char *>(ptr_);
   ptr_ = data + size;
   avail_ -= size;
+  offset_ += size;
   return data;
 }
 
@@ -110,23 +282,55 @@ const void *Mapper::map_data(std::size_t size) {
    #define MARISA_HAS_STAT64
   #endif  // __MSVCRT_VERSION__ >= 0x0601
  #endif   // __MSVCRT_VERSION__
-void Mapper::open_(const char *filename, int flags) {
+void Mapper::open_(const char *filename, std::size_t offset,
+                   std::size_t size, int flags) {
   file_ = ::CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr,
                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
   MARISA_THROW_SYSTEM_ERROR_IF(file_ == INVALID_HANDLE_VALUE, ::GetLastError(),
                                std::system_category(), "CreateFileA");
 
+  map_file_(offset, size, flags);
+}
+
+void Mapper::open_(int fd, std::size_t offset, std::size_t size, int flags) {
+  const intptr_t handle = ::_get_osfhandle(fd);
+  MARISA_THROW_IF(handle == -1, std::invalid_argument);
+  MARISA_THROW_SYSTEM_ERROR_IF(
+      !::DuplicateHandle(::GetCurrentProcess(),
+                         reinterpret_cast<HANDLE>(handle),
+                         ::GetCurrentProcess(), &file_, 0, FALSE,
+                         DUPLICATE_SAME_ACCESS),
+      ::GetLastError(), std::system_category(), "DuplicateHandle");
+
+  map_file_(offset, size, flags);
+}
+
+// A view must start at a multiple of the allocation granularity, so the
+// view may start before `offset'.
+void Mapper::map_file_(std::size_t offset, std::size_t size, int flags) {
   DWORD size_high, size_low;
   size_low = ::GetFileSize(file_, &size_high);
   MARISA_THROW_SYSTEM_ERROR_IF(size_low == INVALID_FILE_SIZE, ::GetLastError(),
                                std::system_category(), "GetFileSize");
-  size_ = (std::size_t{size_high} << 32) | size_low;
+  const std::size_t file_size = (std::size_t{size_high} << 32) | size_low;
+  MARISA_THROW_IF(offset > file_size, std::runtime_error);
+  if (size == 0) {
+    size = file_size - offset;
+  }
+  MARISA_THROW_IF(size > (file_size - offset), std::runtime_error);
 
   map_ = ::CreateFileMapping(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
   MARISA_THROW_SYSTEM_ERROR_IF(map_ == nullptr, ::GetLastError(),
                                std::system_category(), "CreateFileMapping");
 
-  origin_ = ::MapViewOfFile(map_, FILE_MAP_READ, 0, 0, 0);
+  SYSTEM_INFO system_info;
+  ::GetSystemInfo(&system_info);
+  const std::size_t head = offset % system_info.dwAllocationGranularity;
+  const uint64_t view_offset = offset - head;
+  size_ = head + size;
+  origin_ = ::MapViewOfFile(map_, FILE_MAP_READ,
+                            static_cast<DWORD>(view_offset >> 32),
+                            static_cast<DWORD>(view_offset), size_);
   MARISA_THROW_SYSTEM_ERROR_IF(origin_ == nullptr, ::GetLastError(),
                                std::system_category(), "MapViewOfFile");
 
@@ -137,21 +341,47 @@ void Mapper::open_(const char *filename, int flags) {
     ::PrefetchVirtualMemory(GetCurrentProcess(), 1, &range_entry, 0);
   }
 
-  ptr_ = static_cast<const char *>(origin_);
-  avail_ = size_;
+  ptr_ = static_cast<const char *>(origin_) + head;
+  avail_ = size;
+  policy_ = MapPolicy(flags);
 }
 #else  // (defined _WIN32) || (defined _WIN64)
-void Mapper::open_(const char *filename, int flags) {
+void Mapper::open_(const char *filename, std::size_t offset,
+                   std::size_t size, int flags) {
   fd_ = ::open(filename, O_RDONLY);
   MARISA_THROW_SYSTEM_ERROR_IF(fd_ == -1, errno, std::generic_category(),
                                "open");
 
+  map_file_(offset, size, flags);
+}
+
+void Mapper::open_(int fd, std::size_t offset, std::size_t size, int flags) {
+  fd_ = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  MARISA_THROW_SYSTEM_ERROR_IF(fd_ == -1, errno, std::generic_category(),
+                               "fcntl");
+
+  map_file_(offset, size, flags);
+}
+
+// mmap() requires a page-aligned file offset, so the mapping may start
+// before `offset'.
+void Mapper::map_file_(std::size_t offset, std::size_t size, int flags) {
   struct stat st;
   MARISA_THROW_SYSTEM_ERROR_IF(::fstat(fd_, &st) != 0, errno,
                                std::generic_category(), "fstat");
   MARISA_THROW_IF(static_cast<uint64_t>(st.st_size) > SIZE_MAX,
                   std::runtime_error);
-  size_ = static_cast<std::size_t>(st.st_size);
+  const std::size_t file_size = static_cast<std::size_t>(st.st_size);
+  MARISA_THROW_IF(offset > file_size, std::runtime_error);
+  if (size == 0) {
+    size = file_size - offset;
+  }
+  MARISA_THROW_IF(size > (file_size - offset), std::runtime_error);
+
+  if (flags & MARISA_MAP_BULK_LOAD) {
+    load_(offset, size, flags);
+    return;
+  }
 
   int map_flags = MAP_SHARED;
   if (flags & MARISA_MAP_POPULATE) {
@@ -164,12 +394,107 @@ void Mapper::open_(const char *filename, int flags) {
  #endif
   }
 
-  origin_ = ::mmap(nullptr, size_, PROT_READ, map_flags, fd_, 0);
+  const std::size_t page_size =
+      static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  const std::size_t head = offset % page_size;
+  size_ = head + size;
+  origin_ = ::mmap(nullptr, size_, PROT_READ, map_flags, fd_,
+                   static_cast<off_t>(offset - head));
   MARISA_THROW_SYSTEM_ERROR_IF(origin_ == MAP_FAILED, errno,
                                std::generic_category(), "mmap");
 
+  ptr_ = static_cast<const char *>(origin_) + head;
+  avail_ = size;
+  policy_ = MapPolicy(flags);
+}
+
+// load_() reads `size' bytes at `offset' of the file into anonymous memory
+// instead of mapping them. `size_' is the size of the memory for munmap().
+void Mapper::load_(std::size_t offset, std::size_t size, int flags) {
+  MARISA_THROW_IF(size > (SIZE_MAX - (HUGE_PAGE_SIZE * 2)),
+                  std::runtime_error);
+  const std::size_t map_size =
+      std::max((size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1),
+               HUGE_PAGE_SIZE);
+
+ #if defined(MAP_HUGETLB)
+  // `MAP_HUGETLB` is Linux-specific and fails unless huge pages are reserved.
+  origin_ = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+ #endif  // defined(MAP_HUGETLB)
+  if (origin_ == MAP_FAILED) {
+    // Transparent huge pages need 2MB-aligned memory, so an extra huge page
+    // is allocated and the unaligned ends are released.
+    char *const base = static_cast<char *>(
+        ::mmap(nullptr, map_size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    MARISA_THROW_SYSTEM_ERROR_IF(base == MAP_FAILED, errno,
+                                 std::generic_category(), "mmap");
+    const std::size_t head =
+        ((HUGE_PAGE_SIZE - (reinterpret_cast<uintptr_t>(base) %
+                            HUGE_PAGE_SIZE)) %
+         HUGE_PAGE_SIZE);
+    if (head != 0) {
+      ::munmap(base, head);
+    }
+    ::munmap(base + head + map_size, HUGE_PAGE_SIZE - head);
+    origin_ = base + head;
+ #if defined(MADV_HUGEPAGE)
+    ::madvise(origin_, map_size, MADV_HUGEPAGE);
+ #endif  // defined(MADV_HUGEPAGE)
+  }
+  size_ = map_size;
+
+  char *const buf = static_cast<char *>(origin_);
+  std::size_t num_readers =
+      num_readers_override.load(std::memory_order_relaxed);
+  if (num_readers == 0) {
+    num_readers = 1;
+    if (size >= PARALLEL_READ_SIZE) {
+      num_readers = std::clamp<std::size_t>(
+          std::thread::hardware_concurrency(), 1, MAX_NUM_READERS);
+    }
+  }
+  if (num_readers == 1) {
+    pread_all(fd_, buf, size, offset);
+  } else {
+    // Each reader reads a range aligned to huge pages. The ranges must cover
+    // `size', so the quotient is rounded up before the alignment.
+    const std::size_t range_size =
+        (((size + num_readers - 1) / num_readers) + HUGE_PAGE_SIZE - 1) &
+        ~(HUGE_PAGE_SIZE - 1);
+    std::vector<std::thread> readers;
+    std::vector<std::exception_ptr> errors(num_readers);
+    for (std::size_t i = 0; i < num_readers; ++i) {
+      const std::size_t begin = std::min(range_size * i, size);
+      const std::size_t end = std::min(begin + range_size, size);
+      readers.emplace_back([this, buf, offset, begin, end,
+                            &error = errors[i]] {
+        try {
+          pread_all(fd_, buf + begin, end - begin, offset + begin);
+        } catch (...) {
+          error = std::current_exception();
+        }
+      });
+    }
+    for (std::thread &reader : readers) {
+      reader.join();
+    }
+    for (const std::exception_ptr &error : errors) {
+      if (error != nullptr) {
+        std::rethrow_exception(error);
+      }
+    }
+  }
+
+  MARISA_THROW_SYSTEM_ERROR_IF(::mprotect(origin_, size_, PROT_READ) != 0,
+                               errno, std::generic_category(), "mprotect");
+  ::close(fd_);
+  fd_ = -1;
+
   ptr_ = static_cast<const char *>(origin_);
-  avail_ = size_;
+  avail_ = size;
+  policy_ = MapPolicy(flags);
 }
 #endif  // (defined _WIN32) || (defined _WIN64)
 
@@ -2,12 +2,16 @@
 #define MARISA_GRIMOIRE_IO_MAPPER_H_
 
 #include <cstdio>
+#include <memory>
 #include <stdexcept>
 
 #include "marisa/base.h"
+#include "marisa/map-policy.h"
 
 namespace marisa::grimoire::io {
 
+class Reader;
+
 class Mapper {
  public:
   Mapper();
@@ -17,7 +21,18 @@ class Mapper {
   Mapper &operator=(const Mapper &) = delete;
 
   void open(const char *filename, int flags = 0);
+  // open() with `offset' maps `size' bytes at `offset' of the file. If
+  // `size' is 0, the mapping extends to the end of the file. `offset' need
+  // not be aligned to pages. `fd' is duplicated, and so the caller may close
+  // it.
+  void open(const char *filename, std::size_t offset, std::size_t size,
+            int flags = 0);
+  void open(int fd, std::size_t offset, std::size_t size, int flags = 0);
   void open(const void *ptr, std::size_t size);
+  // load() reads `size' bytes from `reader' into memory which is owned by
+  // the mapper and aligned to 64 bytes. offset() starts from the offset of
+  // `reader', so data is aligned as it is in the input.
+  void load(Reader &reader, std::size_t size);
 
   template <typename T>
   void map(T *obj) {
@@ -35,16 +50,68 @@ class Mapper {
 
   void seek(std::size_t size);
 
+  // limit() makes only the next `size' bytes available, and unlimit() makes
+  // the rest available again.
+  void limit(std::size_t size);
+  void unlimit() {
+    avail_ += hidden_;
+    hidden_ = 0;
+  }
+
+  // offset() returns the number of bytes mapped since open(). align() skips
+  // memory to a multiple of the alignment, which is 1 by default.
+  std::size_t offset() const {
+    return offset_;
+  }
+  void set_alignment(std::size_t alignment);
+  void align() {
+    seek((alignment_ - (offset_ % alignment_)) % alignment_);
+  }
+
+  // set_num_readers() fixes the number of threads which read a file in
+  // MARISA_MAP_BULK_LOAD mode. By default, or if `num_readers' is 0, only
+  // large files are read in parallel.
+  static void set_num_readers(std::size_t num_readers);
+
+  // open() sets the policy that the section flags given to it mean, and
+  // set_policy() replaces it.
+  void set_policy(const MapPolicy &policy) {
+    policy_ = policy;
+  }
+
+  // advise() applies the advice of the policy for `type' to the section
+  // [begin, end), which is extended to page boundaries. It does nothing for
+  // memory given by open(ptr, size).
+  void advise(const void *begin, const void *end, marisa_section_type type);
+
+  const void *ptr() const {
+    return ptr_;
+  }
+  // avail() returns the number of bytes which remain after ptr().
+  std::size_t avail() const {
+    return avail_;
+  }
+
   bool is_open() const;
 
   void clear() noexcept;
   void swap(Mapper &rhs) noexcept;
 
  private:
+  // BufferDeleter frees memory given by load().
+  struct BufferDeleter {
+    void operator()(char *buf) const noexcept;
+  };
+
   const void *ptr_ = nullptr;
   void *origin_ = nullptr;
   std::size_t avail_ = 0;
+  std::size_t hidden_ = 0;
+  std::unique_ptr<char[], BufferDeleter> buf_;
   std::size_t size_ = 0;
+  MapPolicy policy_;
+  std::size_t offset_ = 0;
+  std::size_t alignment_ = 1;
 #if (defined _WIN32) || (defined _WIN64)
   void *file_ = nullptr;
   void *map_ = nullptr;
@@ -52,8 +119,14 @@ class Mapper {
   int fd_ = -1;
 #endif  // (defined _WIN32) || (defined _WIN64)
 
-  void open_(const char *filename, int flags);
+  void open_(const char *filename, std::size_t offset, std::size_t size,
+             int flags);
+  void open_(int fd, std::size_t offset, std::size_t size, int flags);
   void open_(const void *ptr, std::size_t size);
+  void map_file_(std::size_t offset, std::size_t size, int flags);
+#if !(defined _WIN32) && !(defined _WIN64)
+  void load_(std::size_t offset, std::size_t size, int flags);
+#endif  // !(defined _WIN32) && !(defined _WIN64)
 
   const void *map_data(std::size_t size);
 };
@@ -0,0 +1,191 @@
+#ifdef __linux__
+ #include <sched.h>
+ #include <sys/mman.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif  // __linux__
+
+#include <cerrno>
+#include <climits>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "marisa/grimoire/io/numa.h"
+
+namespace marisa::grimoire::io {
+namespace {
+
+#ifdef __linux__
+
+// `MPOL_PREFERRED' of <numaif.h>, which is not used to avoid depending on
+// libnuma. The kernel falls back to other nodes if the node is full.
+constexpr int MPOL_PREFERRED_MODE = 1;
+
+// parse_id_list() parses a list of IDs, such as "0-3,8", in sysfs.
+std::vector<std::size_t> parse_id_list(const std::string &path) {
+  std::vector<std::size_t> ids;
+  std::ifstream file(path);
+  std::string line;
+  if (!std::getline(file, line)) {
+    return ids;
+  }
+  std::size_t pos = 0;
+  while (pos < line.length()) {
+    std::size_t end = line.find(',', pos);
+    if (end == std::string::npos) {
+      end = line.length();
+    }
+    const std::string range = line.substr(pos, end - pos);
+    const std::size_t delim_pos = range.find('-');
+    try {
+      const std::size_t first = std::stoul(range.substr(0, delim_pos));
+      const std::size_t last = (delim_pos == std::string::npos)
+                                   ? first
+                                   : std::stoul(range.substr(delim_pos + 1));
+      for (std::size_t id = first; id <= last; ++id) {
+        ids.push_back(id);
+      }
+    } catch (const std::exception &) {
+      return {};
+    }
+    pos = end + 1;
+  }
+  return ids;
+}
+
+// get_cpu_nodes() returns a table from CPU IDs to NUMA node IDs.
+std::vector<std::size_t> get_cpu_nodes() {
+  std::vector<std::size_t> cpu_nodes;
+  for (const std::size_t node : numa_nodes()) {
+    const std::vector<std::size_t> cpus = parse_id_list(
+        "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    for (const std::size_t cpu : cpus) {
+      if (cpu >= cpu_nodes.size()) {
+        cpu_nodes.resize(cpu + 1, 0);
+      }
+      cpu_nodes[cpu] = node;
+    }
+  }
+  return cpu_nodes;
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+NumaMemory::NumaMemory() = default;
+
+NumaMemory::~NumaMemory() {
+  clear();
+}
+
+#ifdef __linux__
+
+void NumaMemory::allocate(std::size_t size, std::size_t node, bool hugepage) {
+  NumaMemory temp;
+  if (size != 0) {
+    void *const ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    MARISA_THROW_SYSTEM_ERROR_IF(ptr == MAP_FAILED, errno,
+                                 std::generic_category(), "mmap");
+    temp.ptr_ = ptr;
+    temp.size_ = size;
+
+ #if defined(MADV_HUGEPAGE)
+    if (hugepage) {
+      ::madvise(ptr, size, MADV_HUGEPAGE);
+    }
+ #endif  // defined(MADV_HUGEPAGE)
+
+    // A failure of mbind(), e.g. in a sandbox, leaves the default policy.
+    constexpr std::size_t BITS_PER_WORD = sizeof(unsigned long) * CHAR_BIT;
+    std::vector<unsigned long> mask((node / BITS_PER_WORD) + 1, 0);
+    mask[node / BITS_PER_WORD] |= 1UL << (node % BITS_PER_WORD);
+    ::syscall(SYS_mbind, ptr, size, MPOL_PREFERRED_MODE, mask.data(),
+              (mask.size() * BITS_PER_WORD) + 1, 0);
+  }
+  swap(temp);
+}
+
+void NumaMemory::protect() {
+  if (ptr_ != nullptr) {
+    MARISA_THROW_SYSTEM_ERROR_IF(::mprotect(ptr_, size_, PROT_READ) != 0,
+                                 errno, std::generic_category(), "mprotect");
+  }
+}
+
+void NumaMemory::clear() noexcept {
+  if (ptr_ != nullptr) {
+    ::munmap(ptr_, size_);
+    ptr_ = nullptr;
+    size_ = 0;
+  }
+}
+
+const std::vector<std::size_t> &numa_nodes() {
+  static const std::vector<std::size_t> nodes = [] {
+    std::vector<std::size_t> ids =
+        parse_id_list("/sys/devices/system/node/online");
+    if (ids.empty()) {
+      ids.push_back(0);
+    }
+    return ids;
+  }();
+  return nodes;
+}
+
+std::size_t current_numa_node() {
+  static const std::vector<std::size_t> cpu_nodes = get_cpu_nodes();
+  if (numa_nodes().size() == 1) {
+    return numa_nodes().front();
+  }
+  // sched_getcpu() is served by vDSO, and so it is much cheaper than a
+  // system call.
+  const int cpu = ::sched_getcpu();
+  if ((cpu < 0) || (static_cast<std::size_t>(cpu) >= cpu_nodes.size())) {
+    return 0;
+  }
+  return cpu_nodes[static_cast<std::size_t>(cpu)];
+}
+
+#else  // __linux__
+
+void NumaMemory::allocate(std::size_t size, std::size_t, bool) {
+  NumaMemory temp;
+  if (size != 0) {
+    temp.ptr_ = ::operator new(size, std::align_val_t{64});
+    temp.size_ = size;
+  }
+  swap(temp);
+}
+
+void NumaMemory::protect() {}
+
+void NumaMemory::clear() noexcept {
+  if (ptr_ != nullptr) {
+    ::operator delete(ptr_, std::align_val_t{64});
+    ptr_ = nullptr;
+    size_ = 0;
+  }
+}
+
+const std::vector<std::size_t> &numa_nodes() {
+  static const std::vector<std::size_t> nodes(1, 0);
+  return nodes;
+}
+
+std::size_t current_numa_node() {
+  return 0;
+}
+
+#endif  // __linux__
+
+void NumaMemory::swap(NumaMemory &rhs) noexcept {
+  std::swap(ptr_, rhs.ptr_);
+  std::swap(size_, rhs.size_);
+}
+
+}  // namespace marisa::grimoire::io
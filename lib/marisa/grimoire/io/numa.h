@@ -0,0 +1,55 @@
+#ifndef MARISA_GRIMOIRE_IO_NUMA_H_
+#define MARISA_GRIMOIRE_IO_NUMA_H_
+
+#include <vector>
+
+#include "marisa/base.h"
+
+namespace marisa::grimoire::io {
+
+// NumaMemory is memory whose pages are preferably allocated on a NUMA node.
+// Pages are allocated on first touch, so the memory should be filled by a
+// single writer after allocate(). NUMA nodes are supported only on Linux,
+// and elsewhere `node' is ignored.
+class NumaMemory {
+ public:
+  NumaMemory();
+  ~NumaMemory();
+
+  NumaMemory(const NumaMemory &) = delete;
+  NumaMemory &operator=(const NumaMemory &) = delete;
+
+  // If `hugepage' is true, transparent huge pages are requested.
+  void allocate(std::size_t size, std::size_t node, bool hugepage = false);
+  // protect() makes the memory read-only.
+  void protect();
+
+  void *data() {
+    return ptr_;
+  }
+  const void *data() const {
+    return ptr_;
+  }
+  std::size_t size() const {
+    return size_;
+  }
+
+  void clear() noexcept;
+  void swap(NumaMemory &rhs) noexcept;
+
+ private:
+  void *ptr_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+// numa_nodes() returns the IDs of online NUMA nodes in ascending order. It
+// returns {0} if NUMA nodes are not available.
+const std::vector<std::size_t> &numa_nodes();
+
+// current_numa_node() returns the NUMA node of the CPU which runs the calling
+// thread, or 0 if it is unknown.
+std::size_t current_numa_node();
+
+}  // namespace marisa::grimoire::io
+
+#endif  // MARISA_GRIMOIRE_IO_NUMA_H_
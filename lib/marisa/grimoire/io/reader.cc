@@ -10,6 +10,8 @@
 
 #include "marisa/grimoire/io/reader.h"
 
+#include "marisa/grimoire/algorithm/crc32c.h"
+
 namespace marisa::grimoire::io {
 
 Reader::Reader() = default;
@@ -58,6 +60,10 @@ void Reader::swap(Reader &rhs) noexcept {
   std::swap(file_, rhs.file_);
   std::swap(fd_, rhs.fd_);
   std::swap(stream_, rhs.stream_);
+  std::swap(offset_, rhs.offset_);
+  std::swap(alignment_, rhs.alignment_);
+  std::swap(checksum_enabled_, rhs.checksum_enabled_);
+  std::swap(checksum_, rhs.checksum_);
   std::swap(needs_fclose_, rhs.needs_fclose_);
 }
 
@@ -79,6 +85,12 @@ void Reader::seek(std::size_t size) {
   }
 }
 
+void Reader::set_alignment(std::size_t alignment) {
+  MARISA_THROW_IF((alignment == 0) || ((alignment & (alignment - 1)) != 0),
+                  std::invalid_argument);
+  alignment_ = alignment;
+}
+
 bool Reader::is_open() const {
   return (file_ != nullptr) || (fd_ != -1) || (stream_ != nullptr);
 }
@@ -115,6 +127,8 @@ void Reader::read_data(void *buf, std::size_t size) {
   if (size == 0) {
     return;
   }
+  void *const begin = buf;
+  const std::size_t total_size = size;
   if (fd_ != -1) {
     while (size != 0) {
 #ifdef _WIN32
@@ -141,6 +155,10 @@ void Reader::read_data(void *buf, std::size_t size) {
                                    static_cast<std::streamsize>(size)),
                     std::runtime_error);
   }
+  if (checksum_enabled_) {
+    checksum_ = algorithm::crc32c(begin, total_size, checksum_);
+  }
+  offset_ += total_size;
 }
 
 }  // namespace marisa::grimoire::io
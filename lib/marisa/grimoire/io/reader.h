@@ -38,6 +38,28 @@ class Reader {
 
   void seek(std::size_t size);
 
+  // offset() returns the number of bytes read since open(). align() skips
+  // input to a multiple of the alignment, which is 1 by default.
+  std::size_t offset() const {
+    return offset_;
+  }
+  void set_alignment(std::size_t alignment);
+  void align() {
+    seek((alignment_ - (offset_ % alignment_)) % alignment_);
+  }
+
+  // When enabled, a CRC-32C checksum is computed over bytes read after the
+  // last reset_checksum().
+  void enable_checksum() {
+    checksum_enabled_ = true;
+  }
+  void reset_checksum() {
+    checksum_ = 0;
+  }
+  uint32_t checksum() const {
+    return checksum_;
+  }
+
   bool is_open() const;
 
   void clear() noexcept;
@@ -48,6 +70,10 @@ class Reader {
   int fd_ = -1;
   std::istream *stream_ = nullptr;
   bool needs_fclose_ = false;
+  std::size_t offset_ = 0;
+  std::size_t alignment_ = 1;
+  bool checksum_enabled_ = false;
+  uint32_t checksum_ = 0;
 
   void open_(const char *filename);
   void open_(std::FILE *file);
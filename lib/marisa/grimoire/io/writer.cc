@@ -1,6 +1,8 @@
 #ifdef _WIN32
  #include <io.h>
 #else  // _WIN32
+ #include <fcntl.h>
+ #include <sys/mman.h>
  #include <unistd.h>
 #endif  // _WIN32
 
@@ -10,6 +12,8 @@
 
 #include "marisa/grimoire/io/writer.h"
 
+#include "marisa/grimoire/algorithm/crc32c.h"
+
 namespace marisa::grimoire::io {
 
 Writer::Writer() = default;
@@ -18,6 +22,13 @@ Writer::~Writer() {
   if (needs_fclose_) {
     std::fclose(file_);
   }
+  if (needs_close_) {
+#ifdef _WIN32
+    ::_close(fd_);
+#else   // _WIN32
+    ::close(fd_);
+#endif  // _WIN32
+  }
 }
 
 void Writer::open(const char *filename) {
@@ -50,6 +61,33 @@ void Writer::open(std::ostream &stream) {
   swap(temp);
 }
 
+void Writer::open_memfd(const char *name) {
+  MARISA_THROW_IF(name == nullptr, std::invalid_argument);
+
+  Writer temp;
+  temp.open_memfd_(name);
+  swap(temp);
+}
+
+int Writer::seal() {
+  MARISA_THROW_IF(!needs_close_, std::logic_error);
+#if defined(F_ADD_SEALS)
+  MARISA_THROW_SYSTEM_ERROR_IF(
+      ::fcntl(fd_, F_ADD_SEALS,
+              F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0,
+      errno, std::generic_category(), "fcntl");
+#else   // defined(F_ADD_SEALS)
+  // A writable descriptor must not be handed out as a sealed one. The
+  // writer keeps the file and closes it.
+  MARISA_THROW_SYSTEM_ERROR_IF(true, ENOSYS, std::generic_category(),
+                               "fcntl");
+#endif  // defined(F_ADD_SEALS)
+  const int fd = fd_;
+  needs_close_ = false;
+  clear();
+  return fd;
+}
+
 void Writer::clear() noexcept {
   Writer().swap(*this);
 }
@@ -58,7 +96,12 @@ void Writer::swap(Writer &rhs) noexcept {
   std::swap(file_, rhs.file_);
   std::swap(fd_, rhs.fd_);
   std::swap(stream_, rhs.stream_);
+  std::swap(offset_, rhs.offset_);
+  std::swap(alignment_, rhs.alignment_);
+  std::swap(checksum_enabled_, rhs.checksum_enabled_);
+  std::swap(checksum_, rhs.checksum_);
   std::swap(needs_fclose_, rhs.needs_fclose_);
+  std::swap(needs_close_, rhs.needs_close_);
 }
 
 void Writer::seek(std::size_t size) {
@@ -79,6 +122,12 @@ void Writer::seek(std::size_t size) {
   }
 }
 
+void Writer::set_alignment(std::size_t alignment) {
+  MARISA_THROW_IF((alignment == 0) || ((alignment & (alignment - 1)) != 0),
+                  std::invalid_argument);
+  alignment_ = alignment;
+}
+
 bool Writer::is_open() const {
   return (file_ != nullptr) || (fd_ != -1) || (stream_ != nullptr);
 }
@@ -110,11 +159,28 @@ void Writer::open_(std::ostream &stream) {
   stream_ = &stream;
 }
 
+void Writer::open_memfd_(const char *name) {
+#if defined(MFD_ALLOW_SEALING)
+  fd_ = ::memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  MARISA_THROW_SYSTEM_ERROR_IF(fd_ == -1, errno, std::generic_category(),
+                               "memfd_create");
+  needs_close_ = true;
+#else   // defined(MFD_ALLOW_SEALING)
+  (void)name;
+  MARISA_THROW_SYSTEM_ERROR_IF(true, ENOSYS, std::generic_category(),
+                               "memfd_create");
+#endif  // defined(MFD_ALLOW_SEALING)
+}
+
 void Writer::write_data(const void *data, std::size_t size) {
   MARISA_THROW_IF(!is_open(), std::logic_error);
   if (size == 0) {
     return;
   }
+  if (checksum_enabled_) {
+    checksum_ = algorithm::crc32c(data, size, checksum_);
+  }
+  offset_ += size;
   if (fd_ != -1) {
     while (size != 0) {
 #ifdef _WIN32
@@ -22,6 +22,14 @@ class Writer {
   void open(int fd);
   void open(std::ostream &stream);
 
+  // open_memfd() creates an anonymous memory file, which is owned by the
+  // writer until seal() is called. seal() forbids further modification of
+  // the file, and returns its descriptor to the caller. Only Linux and
+  // FreeBSD support memory files, and seal() throws std::system_error with
+  // ENOSYS where sealing is not available.
+  void open_memfd(const char *name);
+  int seal();
+
   template <typename T>
   void write(const T &obj) {
     write_data(&obj, sizeof(T));
@@ -37,6 +45,28 @@ class Writer {
 
   void seek(std::size_t size);
 
+  // offset() returns the number of bytes written since open(). align() pads
+  // the output to a multiple of the alignment, which is 1 by default.
+  std::size_t offset() const {
+    return offset_;
+  }
+  void set_alignment(std::size_t alignment);
+  void align() {
+    seek((alignment_ - (offset_ % alignment_)) % alignment_);
+  }
+
+  // When enabled, a CRC-32C checksum is computed over bytes written after the
+  // last reset_checksum().
+  void enable_checksum() {
+    checksum_enabled_ = true;
+  }
+  void reset_checksum() {
+    checksum_ = 0;
+  }
+  uint32_t checksum() const {
+    return checksum_;
+  }
+
   bool is_open() const;
 
   void clear() noexcept;
@@ -47,11 +77,17 @@ class Writer {
   int fd_ = -1;
   std::ostream *stream_ = nullptr;
   bool needs_fclose_ = false;
+  bool needs_close_ = false;
+  std::size_t offset_ = 0;
+  std::size_t alignment_ = 1;
+  bool checksum_enabled_ = false;
+  uint32_t checksum_ = 0;
 
   void open_(const char *filename);
   void open_(std::FILE *file);
   void open_(int fd);
   void open_(std::ostream &stream);
+  void open_memfd_(const char *name);
 
   void write_data(const void *data, std::size_t size);
 };
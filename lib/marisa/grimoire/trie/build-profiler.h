@@ -0,0 +1,51 @@
+#ifndef MARISA_GRIMOIRE_TRIE_BUILD_PROFILER_H_
+#define MARISA_GRIMOIRE_TRIE_BUILD_PROFILER_H_
+
+#include <chrono>
+
+#include "marisa/build-profile.h"
+#include "marisa/grimoire/vector/vector-usage.h"
+
+namespace marisa::grimoire::trie {
+
+// BuildProfiler splits a build into consecutive phases, and reports the time
+// and the peak size of vectors of each phase to a callback. The size is
+// counted from the start of the build.
+class BuildProfiler {
+ public:
+  explicit BuildProfiler(const BuildCallback &callback)
+      : callback_(callback),
+        base_vector_size_(vector::VectorUsage::current()),
+        last_(std::chrono::steady_clock::now()) {
+    vector::VectorUsage::reset_peak();
+  }
+
+  BuildProfiler(const BuildProfiler &) = delete;
+  BuildProfiler &operator=(const BuildProfiler &) = delete;
+
+  // lap() ends a phase, which began at the end of the previous phase.
+  void lap(const char *phase, std::size_t level) {
+    const auto now = std::chrono::steady_clock::now();
+    const std::size_t peak = vector::VectorUsage::peak();
+
+    BuildEvent event;
+    event.phase = phase;
+    event.level = level;
+    event.elapsed = std::chrono::duration<double>(now - last_).count();
+    event.peak_vector_size =
+        (peak > base_vector_size_) ? (peak - base_vector_size_) : 0;
+    callback_(event);
+
+    vector::VectorUsage::reset_peak();
+    last_ = std::chrono::steady_clock::now();
+  }
+
+ private:
+  const BuildCallback &callback_;
+  std::size_t base_vector_size_;
+  std::chrono::steady_clock::time_point last_;
+};
+
+}  // namespace marisa::grimoire::trie
+
+#endif  // MARISA_GRIMOIRE_TRIE_BUILD_PROFILER_H_
@@ -7,13 +7,21 @@
 
 namespace marisa::grimoire::trie {
 
+// A header starts with a 16-byte magic string. The version 2 header is
+// followed by its version number, a reserved field and the size of the whole
+// file, and padded to V2_HEADER_SIZE bytes. Then, each vector is aligned to
+// V2_ALIGNMENT bytes.
 class Header {
  public:
   enum {
-    HEADER_SIZE = 16
+    HEADER_SIZE = 16,
+    V2_HEADER_SIZE = 64,
+    V2_ALIGNMENT = 64,
   };
 
   Header() = default;
+  Header(int version, std::size_t file_size)
+      : version_(version), file_size_(file_size) {}
 
   Header(const Header &) = delete;
   Header &operator=(const Header &) = delete;
@@ -21,35 +29,95 @@ class Header {
   void map(Mapper &mapper) {
     const char *ptr;
     mapper.map(&ptr, HEADER_SIZE);
-    MARISA_THROW_IF(!test_header(ptr), std::runtime_error);
+    if (test_header(ptr, get_v2_header())) {
+      uint32_t version;
+      mapper.map(&version);
+      MARISA_THROW_IF(version != 2, std::runtime_error);
+      mapper.seek(sizeof(uint32_t));
+      uint64_t file_size;
+      mapper.map(&file_size);
+      MARISA_THROW_IF(file_size > SIZE_MAX, std::runtime_error);
+      file_size_ = static_cast<std::size_t>(file_size);
+      mapper.seek(V2_HEADER_SIZE - V2_FIELDS_SIZE);
+      mapper.set_alignment(V2_ALIGNMENT);
+      version_ = 2;
+      return;
+    }
+    MARISA_THROW_IF(!test_header(ptr, get_header()), std::runtime_error);
+    version_ = 1;
   }
   void read(Reader &reader) {
     char buf[HEADER_SIZE];
     reader.read(buf, HEADER_SIZE);
-    MARISA_THROW_IF(!test_header(buf), std::runtime_error);
+    if (test_header(buf, get_v2_header())) {
+      uint32_t version;
+      reader.read(&version);
+      MARISA_THROW_IF(version != 2, std::runtime_error);
+      reader.seek(sizeof(uint32_t));
+      uint64_t file_size;
+      reader.read(&file_size);
+      MARISA_THROW_IF(file_size > SIZE_MAX, std::runtime_error);
+      file_size_ = static_cast<std::size_t>(file_size);
+      reader.seek(V2_HEADER_SIZE - V2_FIELDS_SIZE);
+      reader.set_alignment(V2_ALIGNMENT);
+      version_ = 2;
+      return;
+    }
+    MARISA_THROW_IF(!test_header(buf, get_header()), std::runtime_error);
+    version_ = 1;
   }
   void write(Writer &writer) const {
+    if (version_ == 2) {
+      writer.write(get_v2_header(), HEADER_SIZE);
+      writer.write(static_cast<uint32_t>(2));
+      writer.seek(sizeof(uint32_t));
+      writer.write(static_cast<uint64_t>(file_size_));
+      writer.seek(V2_HEADER_SIZE - V2_FIELDS_SIZE);
+      writer.set_alignment(V2_ALIGNMENT);
+      return;
+    }
     writer.write(get_header(), HEADER_SIZE);
   }
 
+  int version() const {
+    return version_;
+  }
+  // file_size() returns the size of a file in the version 2 format, which
+  // ends with the table of contents, or 0 for the version 1 format.
+  std::size_t file_size() const {
+    return file_size_;
+  }
+
   std::size_t io_size() const {
-    return HEADER_SIZE;
+    return (version_ == 2) ? V2_HEADER_SIZE : HEADER_SIZE;
   }
 
- private:
-  static const char *get_header() {
-    static const char buf[HEADER_SIZE] = "We love Marisa.";
+  // The magic string of the version 2 header also ends a file.
+  static const char *get_v2_header() {
+    static const char buf[HEADER_SIZE] = "We love Marisa2";
     return buf;
   }
 
-  static bool test_header(const char *ptr) {
+  static bool test_header(const char *ptr, const char *header) {
     for (std::size_t i = 0; i < HEADER_SIZE; ++i) {
-      if (ptr[i] != get_header()[i]) {
+      if (ptr[i] != header[i]) {
         return false;
       }
     }
     return true;
   }
+
+ private:
+  // The magic string, the version, the reserved field and the file size.
+  static constexpr std::size_t V2_FIELDS_SIZE = HEADER_SIZE + 16;
+
+  int version_ = 1;
+  std::size_t file_size_ = 0;
+
+  static const char *get_header() {
+    static const char buf[HEADER_SIZE] = "We love Marisa.";
+    return buf;
+  }
 };
 
 }  // namespace marisa::grimoire::trie
@@ -0,0 +1,106 @@
+#include "marisa/grimoire/trie/key-filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace marisa::grimoire::trie {
+
+KeyFilter::KeyFilter() = default;
+
+void KeyFilter::build(std::size_t num_keys, std::size_t bits_per_key) {
+  MARISA_THROW_IF((bits_per_key == 0) || (bits_per_key > MAX_BITS_PER_KEY),
+                  std::invalid_argument);
+  MARISA_THROW_IF(num_keys > (SIZE_MAX / bits_per_key), std::length_error);
+
+  const std::size_t num_bits = num_keys * bits_per_key;
+  const std::size_t block_bits = BLOCK_SIZE * 64;
+  const std::size_t num_blocks =
+      (num_bits != 0) ? (((num_bits - 1) / block_bits) + 1) : 1;
+  // get_block_id() maps 32-bit hashes to blocks.
+  MARISA_THROW_IF(num_blocks > UINT32_MAX, std::length_error);
+
+  // The optimal number of hashes is ln(2) bits per key.
+  std::size_t num_hashes = static_cast<std::size_t>(
+      std::lround(static_cast<double>(bits_per_key) * 0.693));
+  num_hashes = std::max<std::size_t>(1, num_hashes);
+  num_hashes = std::min(num_hashes, MAX_NUM_HASHES);
+
+  KeyFilter temp;
+  temp.blocks_.resize(num_blocks * BLOCK_SIZE, 0);
+  temp.num_hashes_ = num_hashes;
+  swap(temp);
+}
+
+void KeyFilter::insert(std::string_view key) {
+  assert(!blocks_.empty());
+  const uint64_t h = hash(key);
+  uint64_t *const block = &blocks_[get_block_id(h) * BLOCK_SIZE];
+  uint32_t pos = static_cast<uint32_t>(h);
+  const uint32_t delta = static_cast<uint32_t>(h >> 32) | 1;
+  for (std::size_t i = 0; i < num_hashes_; ++i) {
+    block[(pos >> 6) & 7] |= 1ULL << (pos & 63);
+    pos += delta;
+  }
+}
+
+void KeyFilter::map(Mapper &mapper) {
+  KeyFilter temp;
+  temp.map_(mapper);
+  swap(temp);
+}
+
+void KeyFilter::read(Reader &reader) {
+  KeyFilter temp;
+  temp.read_(reader);
+  swap(temp);
+}
+
+void KeyFilter::write(Writer &writer) const {
+  write_(writer);
+}
+
+void KeyFilter::clear() noexcept {
+  KeyFilter().swap(*this);
+}
+
+void KeyFilter::swap(KeyFilter &rhs) noexcept {
+  blocks_.swap(rhs.blocks_);
+  std::swap(num_hashes_, rhs.num_hashes_);
+}
+
+void KeyFilter::map_(Mapper &mapper) {
+  blocks_.map(mapper);
+  {
+    uint64_t temp_num_hashes;
+    mapper.map(&temp_num_hashes);
+    MARISA_THROW_IF(temp_num_hashes > MAX_NUM_HASHES, std::runtime_error);
+    num_hashes_ = static_cast<std::size_t>(temp_num_hashes);
+  }
+  validate();
+}
+
+void KeyFilter::read_(Reader &reader) {
+  blocks_.read(reader);
+  {
+    uint64_t temp_num_hashes;
+    reader.read(&temp_num_hashes);
+    MARISA_THROW_IF(temp_num_hashes > MAX_NUM_HASHES, std::runtime_error);
+    num_hashes_ = static_cast<std::size_t>(temp_num_hashes);
+  }
+  validate();
+}
+
+void KeyFilter::write_(Writer &writer) const {
+  blocks_.write(writer);
+  writer.write(static_cast<uint64_t>(num_hashes_));
+}
+
+void KeyFilter::validate() const {
+  MARISA_THROW_IF(blocks_.empty(), std::runtime_error);
+  MARISA_THROW_IF((blocks_.size() % BLOCK_SIZE) != 0, std::runtime_error);
+  MARISA_THROW_IF(size() > UINT32_MAX, std::runtime_error);
+  MARISA_THROW_IF(num_hashes_ == 0, std::runtime_error);
+}
+
+}  // namespace marisa::grimoire::trie
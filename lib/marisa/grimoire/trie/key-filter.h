@@ -0,0 +1,127 @@
+#ifndef MARISA_GRIMOIRE_TRIE_KEY_FILTER_H_
+#define MARISA_GRIMOIRE_TRIE_KEY_FILTER_H_
+
+#include <cassert>
+#include <string_view>
+
+#include "marisa/grimoire/vector.h"
+
+namespace marisa::grimoire::trie {
+
+// KeyFilter is a blocked Bloom filter of whole keys. A key is hashed to a
+// block of 512 bits, i.e. a cache line, and sets `num_hashes' bits in the
+// block, so a query reads only one block. The hash does not depend on the
+// byte order, so a filter is portable as well as the trie.
+class KeyFilter {
+ public:
+  static constexpr std::size_t BLOCK_SIZE = 8;
+  static constexpr std::size_t MAX_BITS_PER_KEY = 64;
+  static constexpr std::size_t MAX_NUM_HASHES = 16;
+
+  KeyFilter();
+
+  KeyFilter(const KeyFilter &) = delete;
+  KeyFilter &operator=(const KeyFilter &) = delete;
+
+  // build() makes an empty filter for `num_keys' keys. The false positive
+  // rate is about 1% with 10 bits per key, and halves with every 1.44 more
+  // bits until blocks get crowded.
+  void build(std::size_t num_keys, std::size_t bits_per_key);
+  void insert(std::string_view key);
+
+  void map(Mapper &mapper);
+  void read(Reader &reader);
+  void write(Writer &writer) const;
+
+  // contains() returns false only if `key' has not been inserted.
+  bool contains(std::string_view key) const {
+    assert(!blocks_.empty());
+    const uint64_t h = hash(key);
+    const uint64_t *const block = &blocks_[get_block_id(h) * BLOCK_SIZE];
+    uint32_t pos = static_cast<uint32_t>(h);
+    const uint32_t delta = static_cast<uint32_t>(h >> 32) | 1;
+    for (std::size_t i = 0; i < num_hashes_; ++i) {
+      if ((block[(pos >> 6) & 7] & (1ULL << (pos & 63))) == 0) {
+        return false;
+      }
+      pos += delta;
+    }
+    return true;
+  }
+
+  std::size_t num_hashes() const {
+    return num_hashes_;
+  }
+
+  bool empty() const {
+    return blocks_.empty();
+  }
+  std::size_t size() const {
+    return blocks_.size() / BLOCK_SIZE;
+  }
+  std::size_t total_size() const {
+    return blocks_.total_size();
+  }
+  std::size_t io_size() const {
+    return blocks_.io_size() + sizeof(uint64_t);
+  }
+  std::size_t io_size(std::size_t offset, std::size_t alignment) const {
+    return blocks_.io_size(offset, alignment) + sizeof(uint64_t);
+  }
+
+  void clear() noexcept;
+  void swap(KeyFilter &rhs) noexcept;
+
+  static uint64_t hash(std::string_view key) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ key.length();
+    std::size_t i = 0;
+    for (; (i + 8) <= key.length(); i += 8) {
+      h = mix(h ^ load(key.data() + i, 8));
+    }
+    if (i < key.length()) {
+      h = mix(h ^ load(key.data() + i, key.length() - i));
+    }
+    return finalize(h);
+  }
+
+ private:
+  Vector<uint64_t> blocks_;
+  std::size_t num_hashes_ = 0;
+
+  void map_(Mapper &mapper);
+  void read_(Reader &reader);
+  void write_(Writer &writer) const;
+
+  void validate() const;
+
+  // get_block_id() maps the upper bits of `h' to [0, size()) without a
+  // division. Positions in the block depend mostly on the other bits.
+  std::size_t get_block_id(uint64_t h) const {
+    return static_cast<std::size_t>(
+        ((h >> 32) * static_cast<uint64_t>(size())) >> 32);
+  }
+
+  // load() reads `length' (1-8) bytes in little-endian order.
+  static uint64_t load(const char *ptr, std::size_t length) {
+    uint64_t word = 0;
+    for (std::size_t i = 0; i < length; ++i) {
+      word |= static_cast<uint64_t>(static_cast<uint8_t>(ptr[i])) << (i * 8);
+    }
+    return word;
+  }
+  static uint64_t mix(uint64_t h) {
+    h *= 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 29);
+  }
+  static uint64_t finalize(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    return h ^ (h >> 33);
+  }
+};
+
+}  // namespace marisa::grimoire::trie
+
+#endif  // MARISA_GRIMOIRE_TRIE_KEY_FILTER_H_
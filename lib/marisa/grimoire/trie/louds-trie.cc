@@ -6,7 +6,9 @@
 #include <queue>
 #include <stdexcept>
 
+#include "marisa/grimoire/algorithm/crc32c.h"
 #include "marisa/grimoire/algorithm/sort.h"
+#include "marisa/grimoire/trie/build-profiler.h"
 #include "marisa/grimoire/trie/header.h"
 #include "marisa/grimoire/trie/range.h"
 #include "marisa/grimoire/trie/state.h"
@@ -17,36 +19,130 @@ LoudsTrie::LoudsTrie() = default;
 
 LoudsTrie::~LoudsTrie() = default;
 
-void LoudsTrie::build(Keyset &keyset, int flags) {
+void LoudsTrie::build(Keyset &keyset, int flags,
+                      const BuildCallback *callback) {
   Config config;
   config.parse(flags);
 
+  std::unique_ptr<BuildProfiler> profiler;
+  if (callback != nullptr) {
+    profiler.reset(new BuildProfiler(*callback));
+  }
+
   LoudsTrie temp;
+  temp.profiler_ = profiler.get();
   temp.build_(keyset, config);
+  temp.profiler_ = nullptr;
   swap(temp);
 }
 
 void LoudsTrie::map(Mapper &mapper) {
-  Header().map(mapper);
+  Header header;
+  header.map(mapper);
 
   LoudsTrie temp;
-  temp.map_(mapper);
+  if (header.version() == 2) {
+    temp.map_sections(mapper, header.file_size());
+  } else {
+    temp.map_(mapper, nullptr, 1, nullptr);
+  }
   temp.mapper_.swap(mapper);
   swap(temp);
 }
 
+// The version 2 format is loaded into memory and mapped, so that the table
+// of contents is validated before sections are read.
 void LoudsTrie::read(Reader &reader) {
-  Header().read(reader);
+  Header header;
+  header.read(reader);
 
   LoudsTrie temp;
-  temp.read_(reader);
+  if (header.version() == 2) {
+    MARISA_THROW_IF(header.file_size() < reader.offset(), std::runtime_error);
+    Mapper mapper;
+    mapper.load(reader, header.file_size() - reader.offset());
+    mapper.set_alignment(Header::V2_ALIGNMENT);
+    temp.map_sections(mapper, header.file_size());
+    temp.mapper_.swap(mapper);
+  } else {
+    temp.read_(reader);
+  }
   swap(temp);
 }
 
-void LoudsTrie::write(Writer &writer) const {
-  Header().write(writer);
+void LoudsTrie::write(Writer &writer, int flags) const {
+  MARISA_THROW_IF((flags & ~MARISA_SAVE_V2) != 0, std::invalid_argument);
 
-  write_(writer);
+  if ((flags & MARISA_SAVE_V2) == 0) {
+    Header().write(writer);
+    write_(writer, nullptr, 1);
+    return;
+  }
+
+  writer.enable_checksum();
+  Header(2, io_size(MARISA_SAVE_V2)).write(writer);
+  SectionTable sections;
+  write_(writer, &sections, 1);
+  sections.write(writer);
+}
+
+// verify() computes the checksum of each section over the mapped bytes,
+// padding included, at the range given by the table. It reads only the
+// image, which set_values() and the like do not modify.
+bool LoudsTrie::verify() const {
+  for (std::size_t i = 0; i < sections_.size(); ++i) {
+    const Section &section = sections_[i];
+    const char *const ptr =
+        image_ + static_cast<std::size_t>(section.offset - image_offset_);
+    if (algorithm::crc32c(ptr, static_cast<std::size_t>(section.size)) !=
+        section.checksum) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void LoudsTrie::set_values(const void *values, std::size_t value_size,
+                           std::size_t num_values) {
+  MARISA_THROW_IF(num_values != num_keys(), std::invalid_argument);
+
+  std::unique_ptr<ValueStore> temp(new ValueStore);
+  temp->build(values, value_size, num_values);
+  values_.swap(temp);
+}
+
+void LoudsTrie::set_values(const std::string_view *values,
+                           std::size_t num_values) {
+  MARISA_THROW_IF(num_values != num_keys(), std::invalid_argument);
+
+  std::unique_ptr<ValueStore> temp(new ValueStore);
+  temp->build(values, num_values);
+  values_.swap(temp);
+}
+
+void LoudsTrie::set_postings(const uint32_t *ids, const uint64_t *offsets,
+                             std::size_t num_lists) {
+  MARISA_THROW_IF(num_lists != num_keys(), std::invalid_argument);
+
+  std::unique_ptr<PostingStore> temp(new PostingStore);
+  temp->build(ids, offsets, num_lists);
+  postings_.swap(temp);
+}
+
+// set_filter() restores keys one by one, so it needs no more memory than
+// the filter itself.
+void LoudsTrie::set_filter(std::size_t bits_per_key) {
+  std::unique_ptr<KeyFilter> temp(new KeyFilter);
+  temp->build(num_keys(), bits_per_key);
+
+  Agent agent;
+  agent.init_state();
+  for (std::size_t i = 0; i < num_keys(); ++i) {
+    agent.set_query(i);
+    reverse_lookup(agent);
+    temp->insert(agent.key().str());
+  }
+  filter_.swap(temp);
 }
 
 bool LoudsTrie::lookup(Agent &agent) const {
@@ -54,6 +150,9 @@ bool LoudsTrie::lookup(Agent &agent) const {
 
   State &state = agent.state();
   state.lookup_init();
+  if ((filter_ != nullptr) && !filter_->contains(agent.query().str())) {
+    return false;
+  }
   while (state.query_pos() < agent.query().length()) {
     if (!find_child(agent)) {
       return false;
@@ -67,6 +166,24 @@ bool LoudsTrie::lookup(Agent &agent) const {
   return true;
 }
 
+bool LoudsTrie::lookup(std::string_view query, std::size_t *key_id) const {
+  if ((filter_ != nullptr) && !filter_->contains(query)) {
+    return false;
+  }
+  std::size_t node_id = 0;
+  std::size_t query_pos = 0;
+  while (query_pos < query.length()) {
+    if (!find_child(query, node_id, query_pos)) {
+      return false;
+    }
+  }
+  if (!terminal_flags_[node_id]) {
+    return false;
+  }
+  *key_id = terminal_flags_.rank1(node_id);
+  return true;
+}
+
 void LoudsTrie::reverse_lookup(Agent &agent) const {
   assert(agent.has_state());
   MARISA_THROW_IF(agent.query().id() >= size(), std::out_of_range);
@@ -213,7 +330,60 @@ std::size_t LoudsTrie::total_size() const {
          link_flags_.total_size() + bases_.total_size() + extras_.total_size() +
          tail_.total_size() +
          ((next_trie_ != nullptr) ? next_trie_->total_size() : 0) +
-         cache_.total_size();
+         cache_.total_size() +
+         ((values_ != nullptr) ? values_->total_size() : 0) +
+         ((postings_ != nullptr) ? postings_->total_size() : 0) +
+         ((filter_ != nullptr) ? filter_->total_size() : 0);
+}
+
+void LoudsTrie::report_size(SizeReport *report) const {
+  *report = SizeReport();
+  report_level_size(report);
+  report->values_size = (values_ != nullptr) ? values_->total_size() : 0;
+  report->postings_size =
+      (postings_ != nullptr) ? postings_->total_size() : 0;
+  report->filter_size = (filter_ != nullptr) ? filter_->total_size() : 0;
+  report->total_size = total_size();
+  report->io_size = io_size();
+}
+
+void LoudsTrie::report_level_size(SizeReport *report) const {
+  LevelSizeReport level;
+  level.num_nodes = num_nodes();
+  level.num_terminals = terminal_flags_.num_1s();
+  level.num_links = link_flags_.num_1s();
+  level.num_cache_entries = cache_.size();
+  level.louds = {louds_.total_size(), louds_.index_size()};
+  level.terminal_flags = {terminal_flags_.total_size(),
+                          terminal_flags_.index_size()};
+  level.link_flags = {link_flags_.total_size(), link_flags_.index_size()};
+  level.bases = {bases_.total_size(), 0};
+  level.extras = {extras_.total_size(), 0};
+  level.cache = {cache_.total_size(), 0};
+  report->levels.push_back(level);
+
+  if (next_trie_ != nullptr) {
+    next_trie_->report_level_size(report);
+    return;
+  }
+
+  // Links at the last level point to suffixes in the tail. A text suffix
+  // has a terminating '\0'.
+  tail_.report_size(&report->tail);
+  if (tail_.empty()) {
+    return;
+  }
+  const std::size_t terminator_size =
+      (tail_.mode() == MARISA_TEXT_TAIL) ? 1 : 0;
+  std::size_t link_id = 0;
+  for (std::size_t node_id = 0; node_id < link_flags_.size(); ++node_id) {
+    if (link_flags_[node_id]) {
+      report->tail.unshared_size +=
+          tail_.length(get_link(node_id, link_id)) + terminator_size;
+      ++link_id;
+    }
+  }
+  report->tail.num_suffixes = link_id;
 }
 
 std::size_t LoudsTrie::io_size() const {
@@ -222,7 +392,23 @@ std::size_t LoudsTrie::io_size() const {
          tail_.io_size() +
          ((next_trie_ != nullptr) ? (next_trie_->io_size() - Header().io_size())
                                   : 0) +
-         cache_.io_size() + (sizeof(uint32_t) * 2);
+         cache_.io_size() + (sizeof(uint32_t) * 2) +
+         ((values_ != nullptr) ? values_->io_size() : 0) +
+         ((postings_ != nullptr) ? postings_->io_size() : 0) +
+         ((filter_ != nullptr) ? filter_->io_size() : 0);
+}
+
+std::size_t LoudsTrie::io_size(int flags) const {
+  MARISA_THROW_IF((flags & ~MARISA_SAVE_V2) != 0, std::invalid_argument);
+  if ((flags & MARISA_SAVE_V2) == 0) {
+    return io_size();
+  }
+
+  std::size_t num_sections = 0;
+  const std::size_t table_offset =
+      Header::V2_HEADER_SIZE + io_size_(Header::V2_HEADER_SIZE,
+                                        Header::V2_ALIGNMENT, &num_sections);
+  return table_offset + SectionTable::io_size(num_sections, table_offset);
 }
 
 void LoudsTrie::clear() noexcept {
@@ -241,6 +427,12 @@ void LoudsTrie::swap(LoudsTrie &rhs) noexcept {
   std::swap(cache_mask_, rhs.cache_mask_);
   std::swap(num_l1_nodes_, rhs.num_l1_nodes_);
   config_.swap(rhs.config_);
+  values_.swap(rhs.values_);
+  postings_.swap(rhs.postings_);
+  filter_.swap(rhs.filter_);
+  sections_.swap(rhs.sections_);
+  std::swap(image_, rhs.image_);
+  std::swap(image_offset_, rhs.image_offset_);
   mapper_.swap(rhs.mapper_);
 }
 
@@ -251,6 +443,7 @@ void LoudsTrie::build_(Keyset &keyset, const Config &config) {
     keys[i].set_str(keyset[i].ptr(), keyset[i].length());
     keys[i].set_weight(keyset[i].weight());
   }
+  lap("keys", 1);
 
   Vector<uint32_t> terminals;
   build_trie(keys, &terminals, config, 1);
@@ -281,11 +474,20 @@ void LoudsTrie::build_(Keyset &keyset, const Config &config) {
     ++node_id;
   }
   terminal_flags_.push_back(false);
+  lap("terminals", 1);
   terminal_flags_.build(false, true);
+  lap("bit_vector", 1);
 
   for (std::size_t i = 0; i < keyset.size(); ++i) {
     keyset[pairs[i].second].set_id(terminal_flags_.rank1(pairs[i].first));
   }
+  lap("key_ids", 1);
+}
+
+void LoudsTrie::lap(const char *phase, std::size_t trie_id) const {
+  if (profiler_ != nullptr) {
+    profiler_->lap(phase, trie_id - 1);
+  }
 }
 
 template <typename T>
@@ -307,6 +509,7 @@ void LoudsTrie::build_trie(Vector<T> &keys, Vector<uint32_t> *terminals,
   }
 
   link_flags_.build(false, false);
+  lap("bit_vector", trie_id);
   std::size_t node_id = 0;
   for (std::size_t i = 0; i < next_terminals.size(); ++i) {
     while (!link_flags_[node_id]) {
@@ -318,6 +521,7 @@ void LoudsTrie::build_trie(Vector<T> &keys, Vector<uint32_t> *terminals,
   }
   extras_.build(next_terminals);
   fill_cache();
+  lap("links", trie_id);
 }
 
 template <typename T>
@@ -327,6 +531,7 @@ void LoudsTrie::build_current_trie(Vector<T> &keys, Vector<uint32_t> *terminals,
     keys[i].set_id(i);
   }
   const std::size_t num_keys = algorithm::sort(keys.begin(), keys.end());
+  lap("sort", trie_id);
   reserve_cache(config, trie_id, num_keys);
 
   louds_.push_back(true);
@@ -419,11 +624,14 @@ void LoudsTrie::build_current_trie(Vector<T> &keys, Vector<uint32_t> *terminals,
   }
 
   louds_.push_back(false);
+  lap("trie", trie_id);
   louds_.build(trie_id == 1, true);
+  lap("bit_vector", trie_id);
   bases_.shrink();
 
   build_terminals(keys, terminals);
   keys.swap(next_keys);
+  lap("terminals", trie_id);
 }
 
 template <>
@@ -436,6 +644,7 @@ void LoudsTrie::build_next_trie(Vector<Key> &keys, Vector<uint32_t> *terminals,
       entries[i].set_str(keys[i].ptr(), keys[i].length());
     }
     tail_.build(entries, terminals, config.tail_mode());
+    lap("tail", trie_id);
     return;
   }
   Vector<ReverseKey> reverse_keys;
@@ -445,8 +654,11 @@ void LoudsTrie::build_next_trie(Vector<Key> &keys, Vector<uint32_t> *terminals,
     reverse_keys[i].set_weight(keys[i].weight());
   }
   keys.clear();
+  lap("keys", trie_id + 1);
   next_trie_.reset(new LoudsTrie);
+  next_trie_->profiler_ = profiler_;
   next_trie_->build_trie(reverse_keys, terminals, config, trie_id + 1);
+  next_trie_->profiler_ = nullptr;
 }
 
 template <>
@@ -460,10 +672,13 @@ void LoudsTrie::build_next_trie(Vector<ReverseKey> &keys,
       entries[i].set_str(keys[i].ptr(), keys[i].length());
     }
     tail_.build(entries, terminals, config.tail_mode());
+    lap("tail", trie_id);
     return;
   }
   next_trie_.reset(new LoudsTrie);
+  next_trie_->profiler_ = profiler_;
   next_trie_->build_trie(keys, terminals, config, trie_id + 1);
+  next_trie_->profiler_ = nullptr;
 }
 
 template <typename T>
@@ -528,17 +743,63 @@ void LoudsTrie::fill_cache() {
   }
 }
 
-void LoudsTrie::map_(Mapper &mapper) {
+// map_sections() validates the table of contents of the version 2 format
+// first, and then maps the sections in the order of the table.
+void LoudsTrie::map_sections(Mapper &mapper, std::size_t file_size) {
+  sections_.map(mapper, file_size);
+  image_ = static_cast<const char *>(mapper.ptr());
+  image_offset_ = mapper.offset();
+  std::size_t section_id = 0;
+  map_(mapper, &sections_, 1, &section_id);
+  MARISA_THROW_IF(section_id != sections_.size(), std::runtime_error);
+  mapper.seek(file_size - mapper.offset());
+}
+
+// If `sections' is given, each section is checked against the table and
+// limited to its size in the table, so that a corrupted size in a section
+// is caught there. Each section is advised by the policy of `mapper' for its
+// type, whether or not the table is given.
+void LoudsTrie::map_(Mapper &mapper, const SectionTable *sections,
+                     std::size_t level, std::size_t *section_id) {
+  const void *section_begin = nullptr;
+  SectionType section_type = INDEX_SECTION_TYPE;
+  const auto begin_section = [&](SectionType type) {
+    if (sections != nullptr) {
+      MARISA_THROW_IF(*section_id >= sections->size(), std::runtime_error);
+      const Section &section = (*sections)[*section_id];
+      MARISA_THROW_IF((section.type != type) || (section.level != level) ||
+                          (section.offset != mapper.offset()),
+                      std::runtime_error);
+      mapper.limit(static_cast<std::size_t>(section.size));
+    }
+    section_begin = mapper.ptr();
+    section_type = type;
+  };
+  const auto end_section = [&] {
+    if (sections != nullptr) {
+      MARISA_THROW_IF(mapper.avail() != 0, std::runtime_error);
+      mapper.unlimit();
+      ++*section_id;
+    }
+    mapper.advise(section_begin, mapper.ptr(),
+                  static_cast<marisa_section_type>(section_type));
+  };
+
+  begin_section(INDEX_SECTION_TYPE);
   louds_.map(mapper);
   terminal_flags_.map(mapper);
   link_flags_.map(mapper);
   bases_.map(mapper);
   extras_.map(mapper);
+  end_section();
+  begin_section(TAIL_SECTION_TYPE);
   tail_.map(mapper);
+  end_section();
   if ((link_flags_.num_1s() != 0) && tail_.empty()) {
     next_trie_.reset(new LoudsTrie);
-    next_trie_->map_(mapper);
+    next_trie_->map_(mapper, sections, level + 1, section_id);
   }
+  begin_section(CACHE_SECTION_TYPE);
   cache_.map(mapper);
   cache_mask_ = cache_.size() - 1;
   {
@@ -549,7 +810,31 @@ void LoudsTrie::map_(Mapper &mapper) {
   {
     uint32_t temp_config_flags;
     mapper.map(&temp_config_flags);
-    config_.parse(static_cast<int>(temp_config_flags));
+    const int flags = static_cast<int>(temp_config_flags);
+    MARISA_THROW_IF((flags & ~(MARISA_CONFIG_MASK | SECTION_MASK)) != 0,
+                    std::runtime_error);
+    config_.parse(flags & MARISA_CONFIG_MASK);
+    end_section();
+    if ((flags & VALUE_STORE_FLAG) != 0) {
+      begin_section(VALUE_SECTION_TYPE);
+      values_.reset(new ValueStore);
+      values_->map(mapper);
+      MARISA_THROW_IF(values_->size() != num_keys(), std::runtime_error);
+      end_section();
+    }
+    if ((flags & POSTING_STORE_FLAG) != 0) {
+      begin_section(POSTING_SECTION_TYPE);
+      postings_.reset(new PostingStore);
+      postings_->map(mapper);
+      MARISA_THROW_IF(postings_->size() != num_keys(), std::runtime_error);
+      end_section();
+    }
+    if ((flags & KEY_FILTER_FLAG) != 0) {
+      begin_section(KEY_FILTER_SECTION_TYPE);
+      filter_.reset(new KeyFilter);
+      filter_->map(mapper);
+      end_section();
+    }
   }
 }
 
@@ -574,65 +859,159 @@ void LoudsTrie::read_(Reader &reader) {
   {
     uint32_t temp_config_flags;
     reader.read(&temp_config_flags);
-    config_.parse(static_cast<int>(temp_config_flags));
+    const int flags = static_cast<int>(temp_config_flags);
+    MARISA_THROW_IF((flags & ~(MARISA_CONFIG_MASK | SECTION_MASK)) != 0,
+                    std::runtime_error);
+    config_.parse(flags & MARISA_CONFIG_MASK);
+    if ((flags & VALUE_STORE_FLAG) != 0) {
+      values_.reset(new ValueStore);
+      values_->read(reader);
+      MARISA_THROW_IF(values_->size() != num_keys(), std::runtime_error);
+    }
+    if ((flags & POSTING_STORE_FLAG) != 0) {
+      postings_.reset(new PostingStore);
+      postings_->read(reader);
+      MARISA_THROW_IF(postings_->size() != num_keys(), std::runtime_error);
+    }
+    if ((flags & KEY_FILTER_FLAG) != 0) {
+      filter_.reset(new KeyFilter);
+      filter_->read(reader);
+    }
   }
 }
 
-void LoudsTrie::write_(Writer &writer) const {
+void LoudsTrie::write_(Writer &writer, SectionTable *sections,
+                       std::size_t level) const {
+  const auto begin_section = [&](SectionType type) {
+    if (sections != nullptr) {
+      sections->begin(writer, type, level);
+    }
+  };
+  const auto end_section = [&] {
+    if (sections != nullptr) {
+      sections->end(writer);
+    }
+  };
+
+  begin_section(INDEX_SECTION_TYPE);
   louds_.write(writer);
   terminal_flags_.write(writer);
   link_flags_.write(writer);
   bases_.write(writer);
   extras_.write(writer);
+  end_section();
+  begin_section(TAIL_SECTION_TYPE);
   tail_.write(writer);
+  end_section();
   if (next_trie_ != nullptr) {
-    next_trie_->write_(writer);
+    next_trie_->write_(writer, sections, level + 1);
   }
+  begin_section(CACHE_SECTION_TYPE);
   cache_.write(writer);
   writer.write(static_cast<uint32_t>(num_l1_nodes_));
-  writer.write(static_cast<uint32_t>(config_.flags()));
+  writer.write(static_cast<uint32_t>(
+      config_.flags() | ((values_ != nullptr) ? VALUE_STORE_FLAG : 0) |
+      ((postings_ != nullptr) ? POSTING_STORE_FLAG : 0) |
+      ((filter_ != nullptr) ? KEY_FILTER_FLAG : 0)));
+  end_section();
+  if (values_ != nullptr) {
+    begin_section(VALUE_SECTION_TYPE);
+    values_->write(writer);
+    end_section();
+  }
+  if (postings_ != nullptr) {
+    begin_section(POSTING_SECTION_TYPE);
+    postings_->write(writer);
+    end_section();
+  }
+  if (filter_ != nullptr) {
+    begin_section(KEY_FILTER_SECTION_TYPE);
+    filter_->write(writer);
+    end_section();
+  }
 }
 
-bool LoudsTrie::find_child(Agent &agent) const {
-  assert(agent.state().query_pos() < agent.query().length());
+// io_size_() returns the size of what write_() writes at `offset', which
+// depends on `offset' because of the alignment padding of vectors. It also
+// counts the sections.
+std::size_t LoudsTrie::io_size_(std::size_t offset, std::size_t alignment,
+                                std::size_t *num_sections) const {
+  const std::size_t begin = offset;
+  offset += louds_.io_size(offset, alignment);
+  offset += terminal_flags_.io_size(offset, alignment);
+  offset += link_flags_.io_size(offset, alignment);
+  offset += bases_.io_size(offset, alignment);
+  offset += extras_.io_size(offset, alignment);
+  offset += tail_.io_size(offset, alignment);
+  *num_sections += 2;
+  if (next_trie_ != nullptr) {
+    offset += next_trie_->io_size_(offset, alignment, num_sections);
+  }
+  offset += cache_.io_size(offset, alignment) + (sizeof(uint32_t) * 2);
+  *num_sections += 1;
+  if (values_ != nullptr) {
+    offset += values_->io_size(offset, alignment);
+    *num_sections += 1;
+  }
+  if (postings_ != nullptr) {
+    offset += postings_->io_size(offset, alignment);
+    *num_sections += 1;
+  }
+  if (filter_ != nullptr) {
+    offset += filter_->io_size(offset, alignment);
+    *num_sections += 1;
+  }
+  return offset - begin;
+}
 
+bool LoudsTrie::find_child(Agent &agent) const {
   State &state = agent.state();
-  const std::size_t cache_id =
-      get_cache_id(state.node_id(), agent.query()[state.query_pos()]);
-  if (state.node_id() == cache_[cache_id].parent()) {
+  std::size_t node_id = state.node_id();
+  std::size_t query_pos = state.query_pos();
+  const bool found = find_child(agent.query().str(), node_id, query_pos);
+  state.set_node_id(node_id);
+  state.set_query_pos(query_pos);
+  return found;
+}
+
+bool LoudsTrie::find_child(std::string_view query, std::size_t &node_id,
+                           std::size_t &query_pos) const {
+  assert(query_pos < query.length());
+
+  const std::size_t cache_id = get_cache_id(node_id, query[query_pos]);
+  if (node_id == cache_[cache_id].parent()) {
     if (cache_[cache_id].extra() != MARISA_INVALID_EXTRA) {
-      if (!match(agent, cache_[cache_id].link())) {
+      if (!match(query, query_pos, cache_[cache_id].link())) {
         return false;
       }
     } else {
-      state.set_query_pos(state.query_pos() + 1);
+      ++query_pos;
     }
-    state.set_node_id(cache_[cache_id].child());
+    node_id = cache_[cache_id].child();
     return true;
   }
 
-  std::size_t louds_pos = louds_.select0(state.node_id()) + 1;
+  std::size_t louds_pos = louds_.select0(node_id) + 1;
   if (!louds_[louds_pos]) {
     return false;
   }
-  state.set_node_id(louds_pos - state.node_id() - 1);
+  node_id = louds_pos - node_id - 1;
   std::size_t link_id = MARISA_INVALID_LINK_ID;
   do {
-    if (link_flags_[state.node_id()]) {
-      link_id = update_link_id(link_id, state.node_id());
-      const std::size_t prev_query_pos = state.query_pos();
-      if (match(agent, get_link(state.node_id(), link_id))) {
+    if (link_flags_[node_id]) {
+      link_id = update_link_id(link_id, node_id);
+      const std::size_t prev_query_pos = query_pos;
+      if (match(query, query_pos, get_link(node_id, link_id))) {
         return true;
       }
-      if (state.query_pos() != prev_query_pos) {
+      if (query_pos != prev_query_pos) {
         return false;
       }
-    } else if (bases_[state.node_id()] ==
-               static_cast<uint8_t>(agent.query()[state.query_pos()])) {
-      state.set_query_pos(state.query_pos() + 1);
+    } else if (bases_[node_id] == static_cast<uint8_t>(query[query_pos])) {
+      ++query_pos;
       return true;
     }
-    state.set_node_id(state.node_id() + 1);
+    ++node_id;
     ++louds_pos;
   } while (louds_[louds_pos]);
   return false;
@@ -693,11 +1072,12 @@ void LoudsTrie::restore(Agent &agent, std::size_t link) const {
   }
 }
 
-bool LoudsTrie::match(Agent &agent, std::size_t link) const {
+bool LoudsTrie::match(std::string_view query, std::size_t &query_pos,
+                      std::size_t link) const {
   if (next_trie_ != nullptr) {
-    return next_trie_->match_(agent, link);
+    return next_trie_->match_(query, query_pos, link);
   }
-  return tail_.match(agent, link);
+  return tail_.match(query, query_pos, link);
 }
 
 bool LoudsTrie::prefix_match(Agent &agent, std::size_t link) const {
@@ -740,20 +1120,20 @@ void LoudsTrie::restore_(Agent &agent, std::size_t node_id) const {
   }
 }
 
-bool LoudsTrie::match_(Agent &agent, std::size_t node_id) const {
-  assert(agent.state().query_pos() < agent.query().length());
+bool LoudsTrie::match_(std::string_view query, std::size_t &query_pos,
+                       std::size_t node_id) const {
+  assert(query_pos < query.length());
   assert(node_id != 0);
 
-  State &state = agent.state();
   for (;;) {
     const std::size_t cache_id = get_cache_id(node_id);
     if (node_id == cache_[cache_id].child()) {
       if (cache_[cache_id].extra() != MARISA_INVALID_EXTRA) {
-        if (!match(agent, cache_[cache_id].link())) {
+        if (!match(query, query_pos, cache_[cache_id].link())) {
           return false;
         }
-      } else if (cache_[cache_id].label() == agent.query()[state.query_pos()]) {
-        state.set_query_pos(state.query_pos() + 1);
+      } else if (cache_[cache_id].label() == query[query_pos]) {
+        ++query_pos;
       } else {
         return false;
       }
@@ -762,7 +1142,7 @@ bool LoudsTrie::match_(Agent &agent, std::size_t node_id) const {
       if (node_id == 0) {
         return true;
       }
-      if (state.query_pos() >= agent.query().length()) {
+      if (query_pos >= query.length()) {
         return false;
       }
       continue;
@@ -770,15 +1150,14 @@ bool LoudsTrie::match_(Agent &agent, std::size_t node_id) const {
 
     if (link_flags_[node_id]) {
       if (next_trie_ != nullptr) {
-        if (!match(agent, get_link(node_id))) {
+        if (!match(query, query_pos, get_link(node_id))) {
           return false;
         }
-      } else if (!tail_.match(agent, get_link(node_id))) {
+      } else if (!tail_.match(query, query_pos, get_link(node_id))) {
         return false;
       }
-    } else if (bases_[node_id] ==
-               static_cast<uint8_t>(agent.query()[state.query_pos()])) {
-      state.set_query_pos(state.query_pos() + 1);
+    } else if (bases_[node_id] == static_cast<uint8_t>(query[query_pos])) {
+      ++query_pos;
     } else {
       return false;
     }
@@ -786,7 +1165,7 @@ bool LoudsTrie::match_(Agent &agent, std::size_t node_id) const {
     if (node_id <= num_l1_nodes_) {
       return true;
     }
-    if (state.query_pos() >= agent.query().length()) {
+    if (query_pos >= query.length()) {
       return false;
     }
     node_id = louds_.select1(node_id) - node_id - 1;
@@ -2,17 +2,25 @@
 #define MARISA_GRIMOIRE_TRIE_LOUDS_TRIE_H_
 
 #include <memory>
+#include <string_view>
 
 #include "marisa/agent.h"
+#include "marisa/build-profile.h"
 #include "marisa/grimoire/trie/cache.h"
 #include "marisa/grimoire/trie/config.h"
+#include "marisa/grimoire/trie/key-filter.h"
 #include "marisa/grimoire/trie/key.h"
+#include "marisa/grimoire/trie/posting-store.h"
+#include "marisa/grimoire/trie/section-table.h"
 #include "marisa/grimoire/trie/tail.h"
+#include "marisa/grimoire/trie/value-store.h"
 #include "marisa/grimoire/vector.h"
 #include "marisa/keyset.h"
 
 namespace marisa::grimoire::trie {
 
+class BuildProfiler;
+
 class LoudsTrie {
  public:
   LoudsTrie();
@@ -21,17 +29,54 @@ class LoudsTrie {
   LoudsTrie(const LoudsTrie &) = delete;
   LoudsTrie &operator=(const LoudsTrie &) = delete;
 
-  void build(Keyset &keyset, int flags);
+  // If `callback' is not nullptr, it is called at the end of each phase.
+  void build(Keyset &keyset, int flags,
+             const BuildCallback *callback = nullptr);
 
   void map(Mapper &mapper);
   void read(Reader &reader);
-  void write(Writer &writer) const;
+  // `flags' is a combination of marisa_save_flags.
+  void write(Writer &writer, int flags = 0) const;
 
   bool lookup(Agent &agent) const;
+  // lookup() without an agent sets the ID of `query' to `*key_id' if it is
+  // found. It keeps its state on the stack, so it allocates no memory.
+  bool lookup(std::string_view query, std::size_t *key_id) const;
   void reverse_lookup(Agent &agent) const;
   bool common_prefix_search(Agent &agent) const;
   bool predictive_search(Agent &agent) const;
 
+  // Values are stored only in the top-level trie.
+  void set_values(const void *values, std::size_t value_size,
+                  std::size_t num_values);
+  void set_values(const std::string_view *values, std::size_t num_values);
+  void clear_values() noexcept {
+    values_.reset();
+  }
+  const ValueStore *values() const {
+    return values_.get();
+  }
+
+  // Postings are also stored only in the top-level trie.
+  void set_postings(const uint32_t *ids, const uint64_t *offsets,
+                    std::size_t num_lists);
+  void clear_postings() noexcept {
+    postings_.reset();
+  }
+  const PostingStore *postings() const {
+    return postings_.get();
+  }
+
+  // A key filter is also stored only in the top-level trie, and lookup()
+  // checks it before walking the trie.
+  void set_filter(std::size_t bits_per_key);
+  void clear_filter() noexcept {
+    filter_.reset();
+  }
+  const KeyFilter *filter() const {
+    return filter_.get();
+  }
+
   std::size_t num_tries() const {
     return config_.num_tries();
   }
@@ -60,6 +105,18 @@ class LoudsTrie {
   }
   std::size_t total_size() const;
   std::size_t io_size() const;
+  std::size_t io_size(int flags) const;
+
+  // report_size() breaks down total_size() into components.
+  void report_size(SizeReport *report) const;
+
+  // sections() is empty unless the trie was read from the version 2 format.
+  const SectionTable &sections() const {
+    return sections_;
+  }
+  // verify() returns false if the checksums of the mapped sections do not
+  // match. It returns true if there are no sections.
+  bool verify() const;
 
   void clear() noexcept;
   void swap(LoudsTrie &rhs) noexcept;
@@ -76,9 +133,28 @@ class LoudsTrie {
   std::size_t cache_mask_ = 0;
   std::size_t num_l1_nodes_ = 0;
   Config config_;
+  std::unique_ptr<ValueStore> values_;
+  std::unique_ptr<PostingStore> postings_;
+  std::unique_ptr<KeyFilter> filter_;
+  SectionTable sections_;
+  // `image_' points to the byte at `image_offset_' of the mapped file, and
+  // is set only with `sections_'.
+  const char *image_ = nullptr;
+  std::size_t image_offset_ = 0;
   Mapper mapper_;
+  // `profiler_' is set only during a build.
+  BuildProfiler *profiler_ = nullptr;
+
+  // Flags outside MARISA_CONFIG_MASK tell that optional sections follow the
+  // top-level trie. Older versions reject a file with such a flag.
+  static constexpr int VALUE_STORE_FLAG = 0x100000;
+  static constexpr int POSTING_STORE_FLAG = 0x200000;
+  static constexpr int KEY_FILTER_FLAG = 0x400000;
+  static constexpr int SECTION_MASK =
+      VALUE_STORE_FLAG | POSTING_STORE_FLAG | KEY_FILTER_FLAG;
 
   void build_(Keyset &keyset, const Config &config);
+  void lap(const char *phase, std::size_t trie_id) const;
 
   template <typename T>
   void build_trie(Vector<T> &keys, Vector<uint32_t> *terminals,
@@ -99,19 +175,30 @@ class LoudsTrie {
   void cache(std::size_t parent, std::size_t child, float weight, char label);
   void fill_cache();
 
-  void map_(Mapper &mapper);
+  void report_level_size(SizeReport *report) const;
+
+  void map_sections(Mapper &mapper, std::size_t file_size);
+  void map_(Mapper &mapper, const SectionTable *sections, std::size_t level,
+            std::size_t *section_id);
   void read_(Reader &reader);
-  void write_(Writer &writer) const;
+  void write_(Writer &writer, SectionTable *sections,
+              std::size_t level) const;
+  std::size_t io_size_(std::size_t offset, std::size_t alignment,
+                       std::size_t *num_sections) const;
 
   inline bool find_child(Agent &agent) const;
+  inline bool find_child(std::string_view query, std::size_t &node_id,
+                         std::size_t &query_pos) const;
   inline bool predictive_find_child(Agent &agent) const;
 
   inline void restore(Agent &agent, std::size_t node_id) const;
-  inline bool match(Agent &agent, std::size_t node_id) const;
+  inline bool match(std::string_view query, std::size_t &query_pos,
+                    std::size_t node_id) const;
   inline bool prefix_match(Agent &agent, std::size_t node_id) const;
 
   void restore_(Agent &agent, std::size_t node_id) const;
-  bool match_(Agent &agent, std::size_t node_id) const;
+  bool match_(std::string_view query, std::size_t &query_pos,
+              std::size_t node_id) const;
   bool prefix_match_(Agent &agent, std::size_t node_id) const;
 
   inline std::size_t get_cache_id(std::size_t node_id, char label) const;
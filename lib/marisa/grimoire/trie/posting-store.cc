@@ -0,0 +1,181 @@
+#include "marisa/grimoire/trie/posting-store.h"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#include "marisa/grimoire/intrin.h"
+
+namespace marisa::grimoire::trie {
+namespace {
+
+constexpr std::size_t get_length(uint8_t ctrl, std::size_t i) {
+  return ((ctrl >> (i * 2)) & 3U) + 1;
+}
+
+#ifdef MARISA_USE_SSSE3
+
+// SHUFFLE_TABLE[ctrl] moves the data bytes of a group to 4 little-endian
+// 32-bit integers. 0x80 clears a byte.
+constexpr std::array<std::array<uint8_t, 16>, 256> make_shuffle_table() {
+  std::array<std::array<uint8_t, 16>, 256> table = {};
+  for (std::size_t ctrl = 0; ctrl < 256; ++ctrl) {
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < 4; ++i) {
+      const std::size_t length = get_length(static_cast<uint8_t>(ctrl), i);
+      for (std::size_t j = 0; j < 4; ++j) {
+        table[ctrl][(i * 4) + j] =
+            (j < length) ? static_cast<uint8_t>(offset + j) : 0x80;
+      }
+      offset += length;
+    }
+  }
+  return table;
+}
+
+constexpr std::array<std::array<uint8_t, 16>, 256> SHUFFLE_TABLE =
+    make_shuffle_table();
+
+#endif  // MARISA_USE_SSSE3
+
+}  // namespace
+
+PostingStore::PostingStore() = default;
+
+void PostingStore::build(const uint32_t *ids, const uint64_t *offsets,
+                         std::size_t num_lists) {
+  MARISA_THROW_IF(offsets == nullptr, std::invalid_argument);
+  MARISA_THROW_IF((ids == nullptr) && (offsets[num_lists] != offsets[0]),
+                  std::invalid_argument);
+  MARISA_THROW_IF(num_lists > UINT32_MAX, std::length_error);
+
+  PostingStore temp;
+  temp.offsets_.resize(num_lists + 1);
+  temp.sizes_.resize(num_lists);
+  for (std::size_t i = 0; i < num_lists; ++i) {
+    MARISA_THROW_IF(offsets[i + 1] < offsets[i], std::invalid_argument);
+    MARISA_THROW_IF((offsets[i + 1] - offsets[i]) > UINT32_MAX,
+                    std::length_error);
+    temp.offsets_[i] = temp.buf_.size();
+    temp.sizes_[i] = static_cast<uint32_t>(offsets[i + 1] - offsets[i]);
+    encode_list(ids + offsets[i], temp.sizes_[i], &temp.buf_);
+  }
+  temp.offsets_[num_lists] = temp.buf_.size();
+  temp.buf_.resize(temp.buf_.size() + PADDING, 0);
+  temp.buf_.shrink();
+  swap(temp);
+}
+
+void PostingStore::map(Mapper &mapper) {
+  PostingStore temp;
+  temp.map_(mapper);
+  swap(temp);
+}
+
+void PostingStore::read(Reader &reader) {
+  PostingStore temp;
+  temp.read_(reader);
+  swap(temp);
+}
+
+void PostingStore::write(Writer &writer) const {
+  write_(writer);
+}
+
+void PostingStore::clear() noexcept {
+  PostingStore().swap(*this);
+}
+
+void PostingStore::swap(PostingStore &rhs) noexcept {
+  buf_.swap(rhs.buf_);
+  offsets_.swap(rhs.offsets_);
+  sizes_.swap(rhs.sizes_);
+}
+
+std::size_t PostingStore::decode_group(uint8_t ctrl, const uint8_t *data,
+                                       uint32_t prev, std::size_t count,
+                                       uint32_t *ids) {
+  assert((count >= 1) && (count <= 4));
+
+#ifdef MARISA_USE_SSSE3
+  if (count == 4) {
+    __m128i x = _mm_shuffle_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data)),
+        _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(SHUFFLE_TABLE[ctrl].data())));
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi32(x, _mm_set1_epi32(static_cast<int>(prev)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(ids), x);
+    return get_length(ctrl, 0) + get_length(ctrl, 1) + get_length(ctrl, 2) +
+           get_length(ctrl, 3);
+  }
+#endif  // MARISA_USE_SSSE3
+
+  std::size_t offset = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    const std::size_t length = get_length(ctrl, i);
+    uint32_t gap = 0;
+    for (std::size_t j = 0; j < length; ++j) {
+      gap |= static_cast<uint32_t>(data[offset + j]) << (j * 8);
+    }
+    offset += length;
+    prev += gap;
+    ids[i] = prev;
+  }
+  return offset;
+}
+
+void PostingStore::map_(Mapper &mapper) {
+  buf_.map(mapper);
+  offsets_.map(mapper);
+  sizes_.map(mapper);
+  validate();
+}
+
+void PostingStore::read_(Reader &reader) {
+  buf_.read(reader);
+  offsets_.read(reader);
+  sizes_.read(reader);
+  validate();
+}
+
+void PostingStore::write_(Writer &writer) const {
+  buf_.write(writer);
+  offsets_.write(writer);
+  sizes_.write(writer);
+}
+
+// Like ValueStore::validate(), only the sizes are checked in order not to
+// touch every page.
+void PostingStore::validate() const {
+  MARISA_THROW_IF(offsets_.size() != (sizes_.size() + 1), std::runtime_error);
+  MARISA_THROW_IF(buf_.size() < PADDING, std::runtime_error);
+  MARISA_THROW_IF(offsets_[sizes_.size()] != (buf_.size() - PADDING),
+                  std::runtime_error);
+}
+
+void PostingStore::encode_list(const uint32_t *ids, std::size_t num_ids,
+                               Vector<uint8_t> *buf) {
+  const std::size_t ctrl_offset = buf->size();
+  buf->resize(ctrl_offset + ((num_ids + 3) / 4), 0);
+  uint32_t prev = 0;
+  for (std::size_t i = 0; i < num_ids; ++i) {
+    MARISA_THROW_IF((i != 0) && (ids[i] <= prev), std::invalid_argument);
+    uint32_t gap = ids[i] - prev;
+    prev = ids[i];
+
+    std::size_t length = 1;
+    while ((length < 4) && ((gap >> (length * 8)) != 0)) {
+      ++length;
+    }
+    (*buf)[ctrl_offset + (i / 4)] |=
+        static_cast<uint8_t>((length - 1) << ((i % 4) * 2));
+    for (std::size_t j = 0; j < length; ++j) {
+      buf->push_back(static_cast<uint8_t>(gap & 0xFF));
+      gap >>= 8;
+    }
+  }
+}
+
+}  // namespace marisa::grimoire::trie
@@ -0,0 +1,96 @@
+#ifndef MARISA_GRIMOIRE_TRIE_POSTING_STORE_H_
+#define MARISA_GRIMOIRE_TRIE_POSTING_STORE_H_
+
+#include <cassert>
+#include <stdexcept>
+
+#include "marisa/grimoire/vector.h"
+#include "marisa/postings.h"
+
+namespace marisa::grimoire::trie {
+
+// PostingStore keeps an ascending list of IDs for each key ID. A list is
+// encoded as gaps in the StreamVByte format: a control byte per group of 4
+// gaps gives the byte length (1-4) of each gap, and all the control bytes of
+// a list precede its data bytes. The buffer ends with PADDING bytes so that
+// a decoder can load 16 bytes at any group.
+class PostingStore {
+ public:
+  static constexpr std::size_t PADDING = 16;
+
+  PostingStore();
+
+  PostingStore(const PostingStore &) = delete;
+  PostingStore &operator=(const PostingStore &) = delete;
+
+  // The i-th list consists of ids[offsets[i]], ..., ids[offsets[i + 1] - 1].
+  void build(const uint32_t *ids, const uint64_t *offsets,
+             std::size_t num_lists);
+
+  void map(Mapper &mapper);
+  void read(Reader &reader);
+  void write(Writer &writer) const;
+
+  PostingList operator[](std::size_t id) const {
+    assert(id < sizes_.size());
+    // validate() does not scan the offsets, so a corrupted list is caught
+    // here. A list of n IDs takes (n + 3) / 4 control bytes and 1-4 bytes
+    // per gap.
+    const uint64_t begin = offsets_[id];
+    const uint64_t end = offsets_[id + 1];
+    const uint64_t num_ids = sizes_[id];
+    const uint64_t num_ctrls = (num_ids + 3) / 4;
+    MARISA_THROW_IF((begin > end) || (end > (buf_.size() - PADDING)) ||
+                        ((end - begin) < (num_ctrls + num_ids)) ||
+                        ((end - begin) > (num_ctrls + (num_ids * 4))),
+                    std::runtime_error);
+    return PostingList(&buf_[static_cast<std::size_t>(begin)], sizes_[id]);
+  }
+
+  bool empty() const {
+    return sizes_.empty();
+  }
+  std::size_t size() const {
+    return sizes_.size();
+  }
+  std::size_t total_size() const {
+    return buf_.total_size() + offsets_.total_size() + sizes_.total_size();
+  }
+  std::size_t io_size() const {
+    return buf_.io_size() + offsets_.io_size() + sizes_.io_size();
+  }
+  std::size_t io_size(std::size_t offset, std::size_t alignment) const {
+    const std::size_t begin = offset;
+    offset += buf_.io_size(offset, alignment);
+    offset += offsets_.io_size(offset, alignment);
+    offset += sizes_.io_size(offset, alignment);
+    return offset - begin;
+  }
+
+  void clear() noexcept;
+  void swap(PostingStore &rhs) noexcept;
+
+  // decode_group() decodes `count' (1-4) gaps of a group and adds them to
+  // `prev' cumulatively. It returns the number of consumed data bytes.
+  static std::size_t decode_group(uint8_t ctrl, const uint8_t *data,
+                                  uint32_t prev, std::size_t count,
+                                  uint32_t *ids);
+
+ private:
+  Vector<uint8_t> buf_;
+  Vector<uint64_t> offsets_;
+  Vector<uint32_t> sizes_;
+
+  void map_(Mapper &mapper);
+  void read_(Reader &reader);
+  void write_(Writer &writer) const;
+
+  void validate() const;
+
+  static void encode_list(const uint32_t *ids, std::size_t num_ids,
+                          Vector<uint8_t> *buf);
+};
+
+}  // namespace marisa::grimoire::trie
+
+#endif  // MARISA_GRIMOIRE_TRIE_POSTING_STORE_H_
@@ -0,0 +1,139 @@
+#include "marisa/grimoire/trie/section-table.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "marisa/grimoire/algorithm/crc32c.h"
+#include "marisa/grimoire/trie/header.h"
+
+namespace marisa::grimoire::trie {
+
+SectionTable::SectionTable() = default;
+
+void SectionTable::begin(Writer &writer, SectionType type,
+                         std::size_t level) {
+  writer.reset_checksum();
+  Section section = {};
+  section.type = type;
+  section.level = static_cast<uint32_t>(level);
+  section.offset = writer.offset();
+  sections_.push_back(section);
+}
+
+void SectionTable::end(const Writer &writer) {
+  assert(!sections_.empty());
+  Section &section = sections_.back();
+  section.size = writer.offset() - section.offset;
+  section.checksum = writer.checksum();
+}
+
+// map() validates the trailer, the checksum of the table and the ranges of
+// the sections before any section is mapped. The table is small, so it is
+// copied instead of being mapped.
+void SectionTable::map(const Mapper &mapper, std::size_t file_size) {
+  const std::size_t offset = mapper.offset();
+  MARISA_THROW_IF(file_size < offset, std::runtime_error);
+  MARISA_THROW_IF((file_size - offset) > mapper.avail(), std::runtime_error);
+  MARISA_THROW_IF((file_size - offset) < TRAILER_SIZE, std::runtime_error);
+  // at() returns a pointer to the byte at `pos' of the file.
+  const auto at = [&](std::size_t pos) {
+    return static_cast<const char *>(mapper.ptr()) + (pos - offset);
+  };
+
+  const std::size_t table_end = file_size - TRAILER_SIZE;
+  uint64_t table_offset;
+  std::memcpy(&table_offset, at(table_end), sizeof(table_offset));
+  uint32_t checksum;
+  std::memcpy(&checksum, at(table_end + sizeof(table_offset)),
+              sizeof(checksum));
+  MARISA_THROW_IF(
+      !Header::test_header(at(file_size - Header::HEADER_SIZE),
+                           Header::get_v2_header()),
+      std::runtime_error);
+  MARISA_THROW_IF((table_offset < offset) || (table_offset > table_end),
+                  std::runtime_error);
+  MARISA_THROW_IF(
+      (table_end - table_offset) < sizeof(uint64_t), std::runtime_error);
+  MARISA_THROW_IF(
+      algorithm::crc32c(at(static_cast<std::size_t>(table_offset)),
+                        table_end - static_cast<std::size_t>(table_offset)) !=
+          checksum,
+      std::runtime_error);
+
+  uint64_t total_size;
+  std::memcpy(&total_size, at(static_cast<std::size_t>(table_offset)),
+              sizeof(total_size));
+  MARISA_THROW_IF((total_size % sizeof(Section)) != 0, std::runtime_error);
+  MARISA_THROW_IF(total_size > (table_end - table_offset),
+                  std::runtime_error);
+  MARISA_THROW_IF(Vector<Section>::io_size(
+                      static_cast<std::size_t>(total_size),
+                      static_cast<std::size_t>(table_offset),
+                      Header::V2_ALIGNMENT) != (table_end - table_offset),
+                  std::runtime_error);
+
+  SectionTable temp;
+  temp.sections_.resize(static_cast<std::size_t>(total_size) /
+                        sizeof(Section));
+  if (total_size != 0) {
+    std::memcpy(&temp.sections_[0],
+                at(table_end - static_cast<std::size_t>(total_size)),
+                static_cast<std::size_t>(total_size));
+  }
+  temp.validate(offset, static_cast<std::size_t>(table_offset));
+  swap(temp);
+}
+
+void SectionTable::write(Writer &writer) const {
+  const uint64_t offset = writer.offset();
+  writer.reset_checksum();
+  sections_.write(writer);
+  const uint32_t checksum = writer.checksum();
+  writer.write(offset);
+  writer.write(checksum);
+  writer.seek(sizeof(uint32_t));
+  writer.write(Header::get_v2_header(), Header::HEADER_SIZE);
+}
+
+std::size_t SectionTable::io_size(std::size_t num_sections,
+                                  std::size_t offset) {
+  return Vector<Section>::io_size(num_sections * sizeof(Section), offset,
+                                  Header::V2_ALIGNMENT) +
+         TRAILER_SIZE;
+}
+
+bool SectionTable::operator==(const SectionTable &rhs) const {
+  if (sections_.size() != rhs.sections_.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < sections_.size(); ++i) {
+    if (sections_[i] != rhs.sections_[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SectionTable::clear() noexcept {
+  SectionTable().swap(*this);
+}
+
+void SectionTable::swap(SectionTable &rhs) noexcept {
+  sections_.swap(rhs.sections_);
+}
+
+// validate() checks that the sections are contiguous from `offset' to the
+// table.
+void SectionTable::validate(std::size_t offset,
+                            std::size_t table_offset) const {
+  MARISA_THROW_IF(sections_.empty(), std::runtime_error);
+  for (std::size_t i = 0; i < sections_.size(); ++i) {
+    MARISA_THROW_IF(sections_[i].offset != offset, std::runtime_error);
+    MARISA_THROW_IF(sections_[i].size > (table_offset - offset),
+                    std::runtime_error);
+    offset += static_cast<std::size_t>(sections_[i].size);
+  }
+  MARISA_THROW_IF(offset != table_offset, std::runtime_error);
+}
+
+}  // namespace marisa::grimoire::trie
@@ -0,0 +1,103 @@
+#ifndef MARISA_GRIMOIRE_TRIE_SECTION_TABLE_H_
+#define MARISA_GRIMOIRE_TRIE_SECTION_TABLE_H_
+
+#include <cassert>
+
+#include "marisa/grimoire/vector.h"
+#include "marisa/map-policy.h"
+
+namespace marisa::grimoire::trie {
+
+// Section types are written to files, and are public as marisa_section_type
+// for MapPolicy.
+enum SectionType : uint32_t {
+  // LOUDS, terminal flags, link flags, bases and extras of a trie.
+  INDEX_SECTION_TYPE = MARISA_INDEX_SECTION,
+  TAIL_SECTION_TYPE = MARISA_TAIL_SECTION,
+  // Cache and the other fields of a trie.
+  CACHE_SECTION_TYPE = MARISA_CACHE_SECTION,
+  VALUE_SECTION_TYPE = MARISA_VALUE_SECTION,
+  POSTING_SECTION_TYPE = MARISA_POSTING_SECTION,
+  KEY_FILTER_SECTION_TYPE = MARISA_KEY_FILTER_SECTION,
+};
+
+// A section is a range of a file in the version 2 format. `level' is 1 for
+// the top-level trie and is incremented for each nested trie. `checksum' is
+// the CRC-32C of the section, and `reserved' is left for future use.
+struct Section {
+  uint32_t type;
+  uint32_t level;
+  uint64_t offset;
+  uint64_t size;
+  uint32_t checksum;
+  uint32_t reserved;
+
+  friend bool operator==(const Section &, const Section &) = default;
+};
+
+static_assert(sizeof(Section) == 32);
+
+// SectionTable is the table of contents of a file in the version 2 format.
+// It follows the last section, and the file ends with a 32-byte trailer
+// which consists of the offset of the table, the CRC-32C of the table, a
+// reserved field and the magic string of the version 2 header. Offsets are
+// relative to the start of the header.
+//
+// The header of a file gives the file size, so the table is found and its
+// checksum is verified before any section is read. The checksums of
+// sections are verified only on request because it takes a full scan.
+class SectionTable {
+ public:
+  enum {
+    TRAILER_SIZE = 32
+  };
+
+  SectionTable();
+
+  SectionTable(const SectionTable &) = delete;
+  SectionTable &operator=(const SectionTable &) = delete;
+
+  // begin() starts a section at the current offset of `writer', and end()
+  // closes it. Checksums are recorded if the checksum of `writer' is
+  // enabled.
+  void begin(Writer &writer, SectionType type, std::size_t level);
+  void end(const Writer &writer);
+
+  // map() reads the table at the end of a file of `file_size' bytes.
+  // `mapper' is positioned after the header, and it is not moved.
+  void map(const Mapper &mapper, std::size_t file_size);
+  void write(Writer &writer) const;
+
+  // io_size() returns the size of a table of `num_sections' sections and
+  // the trailer, written at `offset'.
+  static std::size_t io_size(std::size_t num_sections, std::size_t offset);
+
+  const Section &operator[](std::size_t i) const {
+    assert(i < sections_.size());
+    return sections_[i];
+  }
+
+  bool empty() const {
+    return sections_.empty();
+  }
+  std::size_t size() const {
+    return sections_.size();
+  }
+  std::size_t total_size() const {
+    return sections_.total_size();
+  }
+
+  bool operator==(const SectionTable &rhs) const;
+
+  void clear() noexcept;
+  void swap(SectionTable &rhs) noexcept;
+
+ private:
+  Vector<Section> sections_;
+
+  void validate(std::size_t offset, std::size_t table_offset) const;
+};
+
+}  // namespace marisa::grimoire::trie
+
+#endif  // MARISA_GRIMOIRE_TRIE_SECTION_TABLE_H_
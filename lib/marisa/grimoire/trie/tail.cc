@@ -60,6 +60,31 @@ void Tail::write(Writer &writer) const {
   write_(writer);
 }
 
+std::size_t Tail::length(std::size_t offset) const {
+  assert(offset < buf_.size());
+
+  std::size_t length = 0;
+  if (end_flags_.empty()) {
+    while (buf_[offset + length] != '\0') {
+      ++length;
+    }
+  } else {
+    do {
+      ++length;
+    } while (!end_flags_[offset + length - 1]);
+  }
+  return length;
+}
+
+// report_size() fills in the sizes of buffers. The numbers of suffixes are
+// filled in by LoudsTrie, which knows the links.
+void Tail::report_size(TailSizeReport *report) const {
+  report->mode = mode();
+  report->buf.size = buf_.total_size();
+  report->end_flags.size = end_flags_.total_size();
+  report->end_flags.index_size = end_flags_.index_size();
+}
+
 void Tail::restore(Agent &agent, std::size_t offset) const {
   assert(!buf_.empty());
 
@@ -76,33 +101,41 @@ void Tail::restore(Agent &agent, std::size_t offset) const {
 }
 
 bool Tail::match(Agent &agent, std::size_t offset) const {
+  State &state = agent.state();
+  std::size_t query_pos = state.query_pos();
+  const bool matched = match(agent.query().str(), query_pos, offset);
+  state.set_query_pos(query_pos);
+  return matched;
+}
+
+bool Tail::match(std::string_view query, std::size_t &query_pos,
+                 std::size_t offset) const {
   assert(!buf_.empty());
-  assert(agent.state().query_pos() < agent.query().length());
+  assert(query_pos < query.length());
 
-  State &state = agent.state();
   if (end_flags_.empty()) {
-    const char *const ptr = &buf_[offset] - state.query_pos();
+    const char *const ptr = &buf_[offset] - query_pos;
     do {
-      if (ptr[state.query_pos()] != agent.query()[state.query_pos()]) {
+      if (ptr[query_pos] != query[query_pos]) {
         return false;
       }
-      state.set_query_pos(state.query_pos() + 1);
-      if (ptr[state.query_pos()] == '\0') {
+      ++query_pos;
+      if (ptr[query_pos] == '\0') {
         return true;
       }
-    } while (state.query_pos() < agent.query().length());
+    } while (query_pos < query.length());
     return false;
   }
 
   do {
-    if (buf_[offset] != agent.query()[state.query_pos()]) {
+    if (buf_[offset] != query[query_pos]) {
       return false;
     }
-    state.set_query_pos(state.query_pos() + 1);
+    ++query_pos;
     if (end_flags_[offset++]) {
       return true;
     }
-  } while (state.query_pos() < agent.query().length());
+  } while (query_pos < query.length());
   return false;
 }
 
@@ -2,9 +2,11 @@
 #define MARISA_GRIMOIRE_TRIE_TAIL_H_
 
 #include <cassert>
+#include <string_view>
 
 #include "marisa/agent.h"
 #include "marisa/grimoire/trie/entry.h"
+#include "marisa/size-report.h"
 #include "marisa/grimoire/vector.h"
 
 namespace marisa::grimoire::trie {
@@ -24,6 +26,10 @@ class Tail {
 
   void restore(Agent &agent, std::size_t offset) const;
   bool match(Agent &agent, std::size_t offset) const;
+  // match() without an agent advances `query_pos' as match(agent) advances
+  // the query position of its state.
+  bool match(std::string_view query, std::size_t &query_pos,
+             std::size_t offset) const;
   bool prefix_match(Agent &agent, std::size_t offset) const;
 
   const char &operator[](std::size_t offset) const {
@@ -31,6 +37,9 @@ class Tail {
     return buf_[offset];
   }
 
+  // length() returns the length of the suffix at `offset'.
+  std::size_t length(std::size_t offset) const;
+
   TailMode mode() const {
     return end_flags_.empty() ? MARISA_TEXT_TAIL : MARISA_BINARY_TAIL;
   }
@@ -47,6 +56,12 @@ class Tail {
   std::size_t io_size() const {
     return buf_.io_size() + end_flags_.io_size();
   }
+  std::size_t io_size(std::size_t offset, std::size_t alignment) const {
+    const std::size_t size = buf_.io_size(offset, alignment);
+    return size + end_flags_.io_size(offset + size, alignment);
+  }
+
+  void report_size(TailSizeReport *report) const;
 
   void clear() noexcept;
   void swap(Tail &rhs) noexcept;
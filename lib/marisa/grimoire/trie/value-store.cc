@@ -0,0 +1,142 @@
+#include "marisa/grimoire/trie/value-store.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace marisa::grimoire::trie {
+
+ValueStore::ValueStore() = default;
+
+void ValueStore::build(const void *values, std::size_t value_size,
+                       std::size_t num_values) {
+  MARISA_THROW_IF((values == nullptr) && (num_values != 0),
+                  std::invalid_argument);
+  MARISA_THROW_IF(value_size == 0, std::invalid_argument);
+  MARISA_THROW_IF(num_values > (Vector<char>::max_size() / value_size),
+                  std::length_error);
+
+  ValueStore temp;
+  temp.buf_.resize(value_size * num_values);
+  if (!temp.buf_.empty()) {
+    std::memcpy(temp.buf_.begin(), values, temp.buf_.size());
+  }
+  temp.value_size_ = value_size;
+  temp.num_values_ = num_values;
+  swap(temp);
+}
+
+void ValueStore::build(const std::string_view *values,
+                       std::size_t num_values) {
+  MARISA_THROW_IF((values == nullptr) && (num_values != 0),
+                  std::invalid_argument);
+
+  ValueStore temp;
+  temp.offsets_.resize(num_values + 1);
+  std::size_t total_length = 0;
+  for (std::size_t i = 0; i < num_values; ++i) {
+    temp.offsets_[i] = total_length;
+    MARISA_THROW_IF(values[i].length() > (SIZE_MAX - total_length),
+                    std::length_error);
+    total_length += values[i].length();
+  }
+  temp.offsets_[num_values] = total_length;
+
+  temp.buf_.resize(total_length);
+  for (std::size_t i = 0; i < num_values; ++i) {
+    if (!values[i].empty()) {
+      std::memcpy(temp.buf_.begin() + temp.offsets_[i], values[i].data(),
+                  values[i].length());
+    }
+  }
+  temp.num_values_ = num_values;
+  swap(temp);
+}
+
+void ValueStore::map(Mapper &mapper) {
+  ValueStore temp;
+  temp.map_(mapper);
+  swap(temp);
+}
+
+void ValueStore::read(Reader &reader) {
+  ValueStore temp;
+  temp.read_(reader);
+  swap(temp);
+}
+
+void ValueStore::write(Writer &writer) const {
+  write_(writer);
+}
+
+void ValueStore::clear() noexcept {
+  ValueStore().swap(*this);
+}
+
+void ValueStore::swap(ValueStore &rhs) noexcept {
+  buf_.swap(rhs.buf_);
+  offsets_.swap(rhs.offsets_);
+  std::swap(value_size_, rhs.value_size_);
+  std::swap(num_values_, rhs.num_values_);
+}
+
+void ValueStore::map_(Mapper &mapper) {
+  buf_.map(mapper);
+  offsets_.map(mapper);
+  {
+    uint64_t temp_value_size;
+    mapper.map(&temp_value_size);
+    MARISA_THROW_IF(temp_value_size > SIZE_MAX, std::runtime_error);
+    value_size_ = static_cast<std::size_t>(temp_value_size);
+  }
+  {
+    uint64_t temp_num_values;
+    mapper.map(&temp_num_values);
+    MARISA_THROW_IF(temp_num_values > SIZE_MAX, std::runtime_error);
+    num_values_ = static_cast<std::size_t>(temp_num_values);
+  }
+  validate();
+}
+
+void ValueStore::read_(Reader &reader) {
+  buf_.read(reader);
+  offsets_.read(reader);
+  {
+    uint64_t temp_value_size;
+    reader.read(&temp_value_size);
+    MARISA_THROW_IF(temp_value_size > SIZE_MAX, std::runtime_error);
+    value_size_ = static_cast<std::size_t>(temp_value_size);
+  }
+  {
+    uint64_t temp_num_values;
+    reader.read(&temp_num_values);
+    MARISA_THROW_IF(temp_num_values > SIZE_MAX, std::runtime_error);
+    num_values_ = static_cast<std::size_t>(temp_num_values);
+  }
+  validate();
+}
+
+void ValueStore::write_(Writer &writer) const {
+  buf_.write(writer);
+  offsets_.write(writer);
+  writer.write(static_cast<uint64_t>(value_size_));
+  writer.write(static_cast<uint64_t>(num_values_));
+}
+
+// validate() only checks the sizes and both ends of the offsets, so that
+// mapping does not touch every page of a large store.
+void ValueStore::validate() const {
+  if (value_size_ != 0) {
+    MARISA_THROW_IF(!offsets_.empty(), std::runtime_error);
+    MARISA_THROW_IF(num_values_ > (buf_.size() / value_size_),
+                    std::runtime_error);
+    MARISA_THROW_IF(buf_.size() != (value_size_ * num_values_),
+                    std::runtime_error);
+    return;
+  }
+  MARISA_THROW_IF(offsets_.empty(), std::runtime_error);
+  MARISA_THROW_IF((offsets_.size() - 1) != num_values_, std::runtime_error);
+  MARISA_THROW_IF(offsets_[0] != 0, std::runtime_error);
+  MARISA_THROW_IF(offsets_[num_values_] != buf_.size(), std::runtime_error);
+}
+
+}  // namespace marisa::grimoire::trie
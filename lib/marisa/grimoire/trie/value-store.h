@@ -0,0 +1,85 @@
+#ifndef MARISA_GRIMOIRE_TRIE_VALUE_STORE_H_
+#define MARISA_GRIMOIRE_TRIE_VALUE_STORE_H_
+
+#include <cassert>
+#include <stdexcept>
+#include <string_view>
+
+#include "marisa/grimoire/vector.h"
+
+namespace marisa::grimoire::trie {
+
+// ValueStore keeps a value for each key ID. Fixed-width values are packed
+// back to back, and variable-width values are concatenated and delimited by
+// `num_values + 1' offsets.
+class ValueStore {
+ public:
+  ValueStore();
+
+  ValueStore(const ValueStore &) = delete;
+  ValueStore &operator=(const ValueStore &) = delete;
+
+  void build(const void *values, std::size_t value_size,
+             std::size_t num_values);
+  void build(const std::string_view *values, std::size_t num_values);
+
+  void map(Mapper &mapper);
+  void read(Reader &reader);
+  void write(Writer &writer) const;
+
+  std::string_view operator[](std::size_t id) const {
+    assert(id < num_values_);
+    if (value_size_ != 0) {
+      return std::string_view(buf_.begin() + (id * value_size_), value_size_);
+    }
+    // validate() does not scan the offsets, so a corrupted pair is caught
+    // here.
+    const uint64_t begin = offsets_[id];
+    const uint64_t end = offsets_[id + 1];
+    MARISA_THROW_IF((begin > end) || (end > buf_.size()), std::runtime_error);
+    return std::string_view(buf_.begin() + begin,
+                            static_cast<std::size_t>(end - begin));
+  }
+
+  // value_size() returns 0 if values are variable-width.
+  std::size_t value_size() const {
+    return value_size_;
+  }
+
+  bool empty() const {
+    return num_values_ == 0;
+  }
+  std::size_t size() const {
+    return num_values_;
+  }
+  std::size_t total_size() const {
+    return buf_.total_size() + offsets_.total_size();
+  }
+  std::size_t io_size() const {
+    return buf_.io_size() + offsets_.io_size() + (sizeof(uint64_t) * 2);
+  }
+  std::size_t io_size(std::size_t offset, std::size_t alignment) const {
+    const std::size_t size = buf_.io_size(offset, alignment);
+    return size + offsets_.io_size(offset + size, alignment) +
+           (sizeof(uint64_t) * 2);
+  }
+
+  void clear() noexcept;
+  void swap(ValueStore &rhs) noexcept;
+
+ private:
+  Vector<char> buf_;
+  Vector<uint64_t> offsets_;
+  std::size_t value_size_ = 0;
+  std::size_t num_values_ = 0;
+
+  void map_(Mapper &mapper);
+  void read_(Reader &reader);
+  void write_(Writer &writer) const;
+
+  void validate() const;
+};
+
+}  // namespace marisa::grimoire::trie
+
+#endif  // MARISA_GRIMOIRE_TRIE_VALUE_STORE_H_
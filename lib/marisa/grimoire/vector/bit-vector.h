@@ -96,10 +96,23 @@ class BitVector {
     return units_.total_size() + ranks_.total_size() + select0s_.total_size() +
            select1s_.total_size();
   }
+  // index_size() returns the part of total_size() for rank/select indexes.
+  std::size_t index_size() const {
+    return ranks_.total_size() + select0s_.total_size() +
+           select1s_.total_size();
+  }
   std::size_t io_size() const {
     return units_.io_size() + (sizeof(uint32_t) * 2) + ranks_.io_size() +
            select0s_.io_size() + select1s_.io_size();
   }
+  std::size_t io_size(std::size_t offset, std::size_t alignment) const {
+    const std::size_t begin = offset;
+    offset += units_.io_size(offset, alignment) + (sizeof(uint32_t) * 2);
+    offset += ranks_.io_size(offset, alignment);
+    offset += select0s_.io_size(offset, alignment);
+    offset += select1s_.io_size(offset, alignment);
+    return offset - begin;
+  }
 
   void clear() noexcept {
     BitVector().swap(*this);
@@ -77,6 +77,10 @@ class FlatVector {
   std::size_t io_size() const {
     return units_.io_size() + (sizeof(uint32_t) * 2) + sizeof(uint64_t);
   }
+  std::size_t io_size(std::size_t offset, std::size_t alignment) const {
+    return units_.io_size(offset, alignment) + (sizeof(uint32_t) * 2) +
+           sizeof(uint64_t);
+  }
 
   void clear() noexcept {
     FlatVector().swap(*this);
@@ -0,0 +1,43 @@
+#ifndef MARISA_GRIMOIRE_VECTOR_VECTOR_USAGE_H_
+#define MARISA_GRIMOIRE_VECTOR_VECTOR_USAGE_H_
+
+#include <cstddef>
+
+namespace marisa::grimoire::vector {
+
+// VectorUsage counts the bytes of Vector buffers held by each thread, and
+// their peak. Other allocations, such as blocks of a Keyset and scratch
+// space of the standard library, are not counted. A buffer freed by another
+// thread is subtracted from that thread, so the counts are meaningful for
+// work done by a thread, such as a build.
+class VectorUsage {
+ public:
+  static void allocate(std::size_t size) noexcept {
+    current_ += size;
+    if (current_ > peak_) {
+      peak_ = current_;
+    }
+  }
+  static void release(std::size_t size) noexcept {
+    current_ = (size < current_) ? (current_ - size) : 0;
+  }
+
+  static std::size_t current() noexcept {
+    return current_;
+  }
+  static std::size_t peak() noexcept {
+    return peak_;
+  }
+  // reset_peak() starts a new measurement of the peak.
+  static void reset_peak() noexcept {
+    peak_ = current_;
+  }
+
+ private:
+  static inline thread_local std::size_t current_ = 0;
+  static inline thread_local std::size_t peak_ = 0;
+};
+
+}  // namespace marisa::grimoire::vector
+
+#endif  // MARISA_GRIMOIRE_VECTOR_VECTOR_USAGE_H_
@@ -10,6 +10,7 @@
 #include <utility>
 
 #include "marisa/grimoire/io.h"
+#include "marisa/grimoire/vector/vector-usage.h"
 
 namespace marisa::grimoire::vector {
 
@@ -198,6 +199,18 @@ class Vector {
   std::size_t io_size() const {
     return sizeof(uint64_t) + ((total_size() + 7) & ~0x07U);
   }
+  // io_size() with `offset' returns the size of the vector written at
+  // `offset' by a writer whose alignment is `alignment'.
+  std::size_t io_size(std::size_t offset, std::size_t alignment) const {
+    return io_size(total_size(), offset, alignment);
+  }
+  static std::size_t io_size(std::size_t total_size, std::size_t offset,
+                             std::size_t alignment) {
+    const std::size_t data_offset = offset + sizeof(uint64_t);
+    return sizeof(uint64_t) +
+           ((alignment - (data_offset % alignment)) % alignment) +
+           ((total_size + 7) & ~std::size_t{7});
+  }
 
   void clear() noexcept {
     Vector().swap(*this);
@@ -216,7 +229,18 @@ class Vector {
   }
 
  private:
-  std::unique_ptr<char[]> buf_;
+  // BufferDeleter frees a buffer and its record in VectorUsage.
+  struct BufferDeleter {
+    std::size_t size = 0;
+
+    void operator()(char *buf) const noexcept {
+      VectorUsage::release(size);
+      delete[] buf;
+    }
+  };
+  using Buffer = std::unique_ptr<char[], BufferDeleter>;
+
+  Buffer buf_;
   T *objs_ = nullptr;
   const T *const_objs_ = nullptr;
   std::size_t size_ = 0;
@@ -229,6 +253,7 @@ class Vector {
     MARISA_THROW_IF(total_size > SIZE_MAX, std::runtime_error);
     MARISA_THROW_IF((total_size % sizeof(T)) != 0, std::runtime_error);
     const std::size_t size = static_cast<std::size_t>(total_size / sizeof(T));
+    mapper.align();
     mapper.map(&const_objs_, size);
     mapper.seek(static_cast<std::size_t>((8 - (total_size % 8)) % 8));
     size_ = size;
@@ -241,22 +266,30 @@ class Vector {
     MARISA_THROW_IF((total_size % sizeof(T)) != 0, std::runtime_error);
     const std::size_t size = static_cast<std::size_t>(total_size / sizeof(T));
     resize(size);
+    reader.align();
     reader.read(objs_, size);
     reader.seek(static_cast<std::size_t>((8 - (total_size % 8)) % 8));
   }
   void write_(Writer &writer) const {
     writer.write(static_cast<uint64_t>(total_size()));
+    writer.align();
     writer.write(const_objs_, size_);
     writer.seek((8 - (total_size() % 8)) % 8);
   }
 
+  static Buffer allocate(std::size_t size) {
+    Buffer buf(new char[size], BufferDeleter{size});
+    VectorUsage::allocate(size);
+    return buf;
+  }
+
   // Copies current elements to new buffer of size `new_capacity`.
   // Requires `new_capacity >= size_`.
   void realloc(std::size_t new_capacity) {
     assert(new_capacity >= size_);
     assert(new_capacity <= max_size());
 
-    std::unique_ptr<char[]> new_buf(new char[sizeof(T) * new_capacity]);
+    Buffer new_buf = allocate(sizeof(T) * new_capacity);
     T *new_objs = reinterpret_cast<T *>(new_buf.get());
 
     static_assert(std::is_trivially_copyable_v<T>);
@@ -273,7 +306,7 @@ class Vector {
   void copyInit(const T *src, std::size_t size, std::size_t capacity) {
     assert(size_ == 0);
 
-    std::unique_ptr<char[]> new_buf(new char[sizeof(T) * capacity]);
+    Buffer new_buf = allocate(sizeof(T) * capacity);
     T *new_objs = reinterpret_cast<T *>(new_buf.get());
 
     static_assert(std::is_trivially_copyable_v<T>);
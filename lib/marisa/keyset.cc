@@ -10,6 +10,16 @@ namespace marisa {
 
 Keyset::Keyset() = default;
 
+Keyset::Keyset(const char *data, const uint32_t *offsets,
+               std::size_t num_keys) {
+  push_back_refs(data, offsets, num_keys);
+}
+
+Keyset::Keyset(const char *data, const uint64_t *offsets,
+               std::size_t num_keys) {
+  push_back_refs(data, offsets, num_keys);
+}
+
 void Keyset::push_back(const Key &key) {
   assert(size_ < SIZE_MAX);
 
@@ -67,6 +77,32 @@ void Keyset::push_back(const char *ptr, std::size_t length, float weight) {
   total_length_ += length;
 }
 
+void Keyset::push_back_ref(const char *ptr, std::size_t length, float weight) {
+  assert(size_ < SIZE_MAX);
+  MARISA_THROW_IF((ptr == nullptr) && (length != 0), std::invalid_argument);
+  MARISA_THROW_IF(length > UINT32_MAX, std::invalid_argument);
+
+  if ((size_ / KEY_BLOCK_SIZE) == key_blocks_size_) {
+    append_key_block();
+  }
+
+  Key &key = key_blocks_[size_ / KEY_BLOCK_SIZE][size_ % KEY_BLOCK_SIZE];
+  key.set_str(ptr, length);
+  key.set_weight(weight);
+  ++size_;
+  total_length_ += length;
+}
+
+void Keyset::push_back_refs(const char *data, const uint32_t *offsets,
+                            std::size_t num_keys) {
+  push_back_refs_(data, offsets, num_keys);
+}
+
+void Keyset::push_back_refs(const char *data, const uint64_t *offsets,
+                            std::size_t num_keys) {
+  push_back_refs_(data, offsets, num_keys);
+}
+
 void Keyset::reset() {
   base_blocks_size_ = 0;
   extra_blocks_size_ = 0;
@@ -113,6 +149,33 @@ char *Keyset::reserve(std::size_t size) {
   return ptr_ - size;
 }
 
+template <typename T>
+void Keyset::push_back_refs_(const char *data, const T *offsets,
+                             std::size_t num_keys) {
+  MARISA_THROW_IF((offsets == nullptr) && (num_keys != 0),
+                  std::invalid_argument);
+  MARISA_THROW_IF(num_keys > (SIZE_MAX - size_), std::length_error);
+  if (num_keys == 0) {
+    return;
+  }
+  // All the keys are validated and the key blocks are allocated first, so
+  // that the keyset is left unchanged if any of them is rejected.
+  MARISA_THROW_IF((data == nullptr) && (offsets[num_keys] != offsets[0]),
+                  std::invalid_argument);
+  for (std::size_t i = 0; i < num_keys; ++i) {
+    MARISA_THROW_IF(offsets[i + 1] < offsets[i], std::invalid_argument);
+    MARISA_THROW_IF((offsets[i + 1] - offsets[i]) > UINT32_MAX,
+                    std::invalid_argument);
+  }
+  while ((key_blocks_size_ * KEY_BLOCK_SIZE) < (size_ + num_keys)) {
+    append_key_block();
+  }
+  for (std::size_t i = 0; i < num_keys; ++i) {
+    push_back_ref(data + offsets[i],
+                  static_cast<std::size_t>(offsets[i + 1] - offsets[i]));
+  }
+}
+
 void Keyset::append_base_block() {
   if (base_blocks_size_ == base_blocks_capacity_) {
     const std::size_t new_capacity =
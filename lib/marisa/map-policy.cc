@@ -0,0 +1,43 @@
+#include "marisa/map-policy.h"
+
+#include <stdexcept>
+
+namespace marisa {
+
+// Every lookup reads the key filter, so it is advised as an index.
+MapPolicy::MapPolicy(int map_flags) {
+  int index_advice = 0;
+  int data_advice = 0;
+  if (map_flags & MARISA_MAP_LOCK_INDEX) {
+    index_advice |= MARISA_ADVICE_LOCK;
+  }
+  if (map_flags & MARISA_MAP_WILLNEED_INDEX) {
+    index_advice |= MARISA_ADVICE_WILLNEED;
+  }
+  if (map_flags & MARISA_MAP_RANDOM_DATA) {
+    data_advice |= MARISA_ADVICE_RANDOM;
+  }
+  if (map_flags & MARISA_MAP_HUGEPAGE) {
+    index_advice |= MARISA_ADVICE_HUGEPAGE;
+    data_advice |= MARISA_ADVICE_HUGEPAGE;
+  }
+  advice_[MARISA_INDEX_SECTION] = index_advice;
+  advice_[MARISA_TAIL_SECTION] = data_advice;
+  advice_[MARISA_CACHE_SECTION] = index_advice;
+  advice_[MARISA_VALUE_SECTION] = data_advice;
+  advice_[MARISA_POSTING_SECTION] = data_advice;
+  advice_[MARISA_KEY_FILTER_SECTION] = index_advice;
+}
+
+void MapPolicy::set(marisa_section_type type, int advice) {
+  MARISA_THROW_IF((type <= 0) || (type >= MARISA_NUM_SECTION_TYPES),
+                  std::invalid_argument);
+  MARISA_THROW_IF((advice & ~MARISA_ADVICE_MASK) != 0, std::invalid_argument);
+  advice_[type] = advice;
+}
+
+int MapPolicy::get(marisa_section_type type) const {
+  return ((type > 0) && (type < MARISA_NUM_SECTION_TYPES)) ? advice_[type] : 0;
+}
+
+}  // namespace marisa
@@ -0,0 +1,87 @@
+#include "marisa/postings.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "marisa/grimoire/trie/posting-store.h"
+
+namespace marisa {
+
+using grimoire::trie::PostingStore;
+
+PostingList::Iterator::Iterator(const uint8_t *ptr, std::size_t pos,
+                                std::size_t size)
+    : ctrl_(ptr), data_(ptr + ((size + 3) / 4)), pos_(pos), size_(size) {
+  if (pos_ < size_) {
+    fill();
+  }
+}
+
+void PostingList::Iterator::fill() {
+  const std::size_t group_id = pos_ / 4;
+  const uint32_t prev = (group_id == 0) ? 0 : buf_[3];
+  data_ += PostingStore::decode_group(ctrl_[group_id], data_, prev,
+                                      std::min<std::size_t>(size_ - pos_, 4),
+                                      buf_);
+}
+
+void PostingList::decode(uint32_t *ids) const {
+  MARISA_THROW_IF((ids == nullptr) && (size_ != 0), std::invalid_argument);
+
+  const uint8_t *data = ptr_ + ((size_ + 3) / 4);
+  uint32_t prev = 0;
+  for (std::size_t i = 0; i < size_; i += 4) {
+    const std::size_t count = std::min<std::size_t>(size_ - i, 4);
+    data += PostingStore::decode_group(ptr_[i / 4], data, prev, count, ids + i);
+    prev = ids[i + count - 1];
+  }
+}
+
+void intersect(const PostingList &lhs, const PostingList &rhs,
+               std::vector<uint32_t> *result) {
+  const PostingList lists[] = {lhs, rhs};
+  intersect(lists, 2, result);
+}
+
+void intersect(const PostingList *lists, std::size_t num_lists,
+               std::vector<uint32_t> *result) {
+  MARISA_THROW_IF((lists == nullptr) && (num_lists != 0),
+                  std::invalid_argument);
+  MARISA_THROW_IF(result == nullptr, std::invalid_argument);
+
+  result->clear();
+  if (num_lists == 0) {
+    return;
+  }
+
+  std::vector<const PostingList *> order(num_lists);
+  for (std::size_t i = 0; i < num_lists; ++i) {
+    order[i] = &lists[i];
+  }
+  std::sort(order.begin(), order.end(),
+            [](const PostingList *lhs, const PostingList *rhs) {
+              return lhs->size() < rhs->size();
+            });
+
+  // The shortest list is decoded as candidates, and each of the other lists
+  // filters them in a merge.
+  result->resize(order[0]->size());
+  order[0]->decode(result->data());
+  for (std::size_t i = 1; (i < num_lists) && !result->empty(); ++i) {
+    std::size_t num_matches = 0;
+    PostingList::Iterator it = order[i]->begin();
+    const PostingList::Iterator end = order[i]->end();
+    for (std::size_t j = 0; (j < result->size()) && (it != end); ++j) {
+      const uint32_t id = (*result)[j];
+      while ((it != end) && (*it < id)) {
+        ++it;
+      }
+      if ((it != end) && (*it == id)) {
+        (*result)[num_matches++] = id;
+      }
+    }
+    result->resize(num_matches);
+  }
+}
+
+}  // namespace marisa
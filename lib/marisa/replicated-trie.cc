@@ -0,0 +1,89 @@
+#include "marisa/replicated-trie.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "marisa/grimoire/io.h"
+#include "marisa/grimoire/io/numa.h"
+
+namespace marisa {
+
+struct ReplicatedTrie::Impl {
+  struct Replica {
+    grimoire::io::NumaMemory memory;
+    Trie trie;
+  };
+
+  std::vector<std::unique_ptr<Replica>> replicas;
+  // node_replicas[node] is the index of the replica on `node'.
+  std::vector<std::size_t> node_replicas;
+};
+
+ReplicatedTrie::ReplicatedTrie() = default;
+
+ReplicatedTrie::~ReplicatedTrie() = default;
+
+ReplicatedTrie::ReplicatedTrie(ReplicatedTrie &&) noexcept = default;
+
+ReplicatedTrie &ReplicatedTrie::operator=(ReplicatedTrie &&) noexcept =
+    default;
+
+// The file is mapped once and copied to each node, which is cheaper than
+// reading it for each node.
+void ReplicatedTrie::load(const char *filename, int flags) {
+  MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
+
+  grimoire::Mapper mapper;
+  mapper.open(filename);
+  const void *const src = mapper.ptr();
+  const std::size_t size = mapper.avail();
+
+  std::unique_ptr<Impl> temp(new Impl);
+  const std::vector<std::size_t> &nodes = grimoire::io::numa_nodes();
+  temp->node_replicas.assign(nodes.back() + 1, 0);
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    std::unique_ptr<Impl::Replica> replica(new Impl::Replica);
+    replica->memory.allocate(size, nodes[i],
+                             (flags & MARISA_MAP_HUGEPAGE) != 0);
+    if (size != 0) {
+      std::memcpy(replica->memory.data(), src, size);
+    }
+    replica->memory.protect();
+    replica->trie.map(replica->memory.data(), size);
+    if ((i == 0) && (flags & MARISA_MAP_VERIFY)) {
+      MARISA_THROW_IF(!replica->trie.verify(), std::runtime_error);
+    }
+    temp->replicas.push_back(std::move(replica));
+    temp->node_replicas[nodes[i]] = i;
+  }
+  impl_.swap(temp);
+}
+
+const Trie &ReplicatedTrie::local() const {
+  MARISA_THROW_IF(impl_ == nullptr, std::logic_error);
+  const std::size_t node = grimoire::io::current_numa_node();
+  const std::size_t i =
+      (node < impl_->node_replicas.size()) ? impl_->node_replicas[node] : 0;
+  return impl_->replicas[i]->trie;
+}
+
+const Trie &ReplicatedTrie::replica(std::size_t i) const {
+  MARISA_THROW_IF(impl_ == nullptr, std::logic_error);
+  MARISA_THROW_IF(i >= impl_->replicas.size(), std::out_of_range);
+  return impl_->replicas[i]->trie;
+}
+
+std::size_t ReplicatedTrie::num_replicas() const {
+  return (impl_ != nullptr) ? impl_->replicas.size() : 0;
+}
+
+void ReplicatedTrie::clear() noexcept {
+  ReplicatedTrie().swap(*this);
+}
+
+void ReplicatedTrie::swap(ReplicatedTrie &rhs) noexcept {
+  impl_.swap(rhs.impl_);
+}
+
+}  // namespace marisa
@@ -0,0 +1,141 @@
+#include "marisa/set-operations.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace marisa {
+namespace {
+
+// KeyStream visits the keys of a trie in ascending lexicographic order.
+class KeyStream {
+ public:
+  explicit KeyStream(const Trie &trie) : trie_(trie) {
+    agent_.set_query("");
+    if (trie_.node_order() != MARISA_LABEL_ORDER) {
+      // Predictive search follows weight order, so keys are sorted here.
+      keys_.reserve(trie_.num_keys());
+      while (trie_.predictive_search(agent_)) {
+        keys_.emplace_back(agent_.key().str());
+      }
+      std::sort(keys_.begin(), keys_.end());
+      is_sorted_ = true;
+    }
+    next();
+  }
+
+  KeyStream(const KeyStream &) = delete;
+  KeyStream &operator=(const KeyStream &) = delete;
+
+  bool empty() const {
+    return is_empty_;
+  }
+  std::string_view key() const {
+    return key_;
+  }
+
+  void next() {
+    if (is_sorted_) {
+      is_empty_ = (key_id_ == keys_.size());
+      if (!is_empty_) {
+        key_ = keys_[key_id_++];
+      }
+    } else {
+      is_empty_ = !trie_.predictive_search(agent_);
+      if (!is_empty_) {
+        key_ = agent_.key().str();
+      }
+    }
+  }
+
+ private:
+  const Trie &trie_;
+  Agent agent_;
+  std::vector<std::string> keys_;
+  std::size_t key_id_ = 0;
+  std::string_view key_;
+  bool is_sorted_ = false;
+  bool is_empty_ = false;
+};
+
+// merge() calls `f' with each key and whether it is in `lhs' and `rhs'.
+template <typename F>
+void merge(const Trie &lhs, const Trie &rhs, F f) {
+  KeyStream lhs_stream(lhs);
+  KeyStream rhs_stream(rhs);
+  while (!lhs_stream.empty() || !rhs_stream.empty()) {
+    int result;
+    if (lhs_stream.empty()) {
+      result = 1;
+    } else if (rhs_stream.empty()) {
+      result = -1;
+    } else {
+      result = lhs_stream.key().compare(rhs_stream.key());
+    }
+
+    if (result < 0) {
+      if (!f(lhs_stream.key(), true, false)) {
+        return;
+      }
+      lhs_stream.next();
+    } else if (result > 0) {
+      if (!f(rhs_stream.key(), false, true)) {
+        return;
+      }
+      rhs_stream.next();
+    } else {
+      if (!f(lhs_stream.key(), true, true)) {
+        return;
+      }
+      lhs_stream.next();
+      rhs_stream.next();
+    }
+  }
+}
+
+// build() builds `result' from the keys selected by `filter'.
+template <typename F>
+void build(const Trie &lhs, const Trie &rhs, Trie *result, int config_flags,
+           F filter) {
+  MARISA_THROW_IF(result == nullptr, std::invalid_argument);
+
+  Keyset keyset;
+  merge(lhs, rhs, [&](std::string_view key, bool in_lhs, bool in_rhs) {
+    if (filter(in_lhs, in_rhs)) {
+      keyset.push_back(key);
+    }
+    return true;
+  });
+  result->build(keyset, config_flags);
+}
+
+}  // namespace
+
+void set_union(const Trie &lhs, const Trie &rhs, Trie *result,
+               int config_flags) {
+  build(lhs, rhs, result, config_flags, [](bool, bool) { return true; });
+}
+
+void set_intersection(const Trie &lhs, const Trie &rhs, Trie *result,
+                      int config_flags) {
+  build(lhs, rhs, result, config_flags,
+        [](bool in_lhs, bool in_rhs) { return in_lhs && in_rhs; });
+}
+
+void set_difference(const Trie &lhs, const Trie &rhs, Trie *result,
+                    int config_flags) {
+  build(lhs, rhs, result, config_flags,
+        [](bool in_lhs, bool in_rhs) { return in_lhs && !in_rhs; });
+}
+
+void diff(const Trie &lhs, const Trie &rhs, const DiffCallback &callback) {
+  merge(lhs, rhs, [&](std::string_view key, bool in_lhs, bool in_rhs) {
+    if (in_lhs == in_rhs) {
+      return true;
+    }
+    return callback(key, in_rhs);
+  });
+}
+
+}  // namespace marisa
@@ -0,0 +1,248 @@
+#include "marisa/trie-bundle.h"
+
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+
+#include "marisa/grimoire/io.h"
+#include "marisa/iostream.h"
+
+namespace marisa {
+namespace {
+
+constexpr std::size_t HEADER_SIZE = 16;
+constexpr std::size_t ALIGNMENT = 64;
+// Each value of the directory consists of the offset and the size of a trie.
+constexpr std::size_t VALUE_SIZE = sizeof(uint64_t) * 2;
+
+const char *get_header() {
+  static const char buf[HEADER_SIZE] = "We love MarisaB";
+  return buf;
+}
+
+uint64_t align(uint64_t offset) {
+  return (offset + ALIGNMENT - 1) & ~uint64_t{ALIGNMENT - 1};
+}
+
+}  // namespace
+
+struct TrieBundle::Impl {
+  struct Entry {
+    std::once_flag once;
+    Trie trie;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+  };
+
+  grimoire::Mapper mapper;
+  const char *base = nullptr;
+  int flags = 0;
+  Trie directory;
+  std::unique_ptr<Entry[]> entries;
+
+  void open();
+  const Trie &get(std::size_t i) const;
+};
+
+// open() parses the directory of the bundle opened by `mapper'.
+void TrieBundle::Impl::open() {
+  base = static_cast<const char *>(mapper.ptr());
+  const std::size_t file_size = mapper.avail();
+
+  const char *header;
+  mapper.map(&header, HEADER_SIZE);
+  MARISA_THROW_IF(std::memcmp(header, get_header(), HEADER_SIZE) != 0,
+                  std::runtime_error);
+  uint64_t directory_size;
+  mapper.map(&directory_size);
+  MARISA_THROW_IF(directory_size > mapper.avail(), std::runtime_error);
+  const char *directory_ptr;
+  mapper.map(&directory_ptr, static_cast<std::size_t>(directory_size));
+  directory.map(directory_ptr, static_cast<std::size_t>(directory_size));
+  MARISA_THROW_IF((directory.num_keys() != 0) &&
+                      (directory.value_size() != VALUE_SIZE),
+                  std::runtime_error);
+
+  const uint64_t min_offset = mapper.offset();
+  entries.reset(new Entry[directory.num_keys()]);
+  for (std::size_t i = 0; i < directory.num_keys(); ++i) {
+    const std::string_view value = directory.value(i);
+    std::memcpy(&entries[i].offset, value.data(), sizeof(uint64_t));
+    std::memcpy(&entries[i].size, value.data() + sizeof(uint64_t),
+                sizeof(uint64_t));
+    MARISA_THROW_IF(entries[i].offset < min_offset, std::runtime_error);
+    MARISA_THROW_IF(entries[i].offset > file_size, std::runtime_error);
+    MARISA_THROW_IF(entries[i].size > (file_size - entries[i].offset),
+                    std::runtime_error);
+  }
+}
+
+// A trie is mapped by the first thread which accesses it. If mapping fails,
+// the next access tries again.
+const Trie &TrieBundle::Impl::get(std::size_t i) const {
+  Entry &entry = entries[i];
+  std::call_once(entry.once, [this, &entry] {
+    Trie temp;
+    temp.map(base + entry.offset, static_cast<std::size_t>(entry.size));
+    MARISA_THROW_IF((flags & MARISA_MAP_VERIFY) && !temp.verify(),
+                    std::runtime_error);
+    entry.trie.swap(temp);
+  });
+  return entry.trie;
+}
+
+TrieBundle::TrieBundle() = default;
+
+TrieBundle::~TrieBundle() = default;
+
+TrieBundle::TrieBundle(TrieBundle &&) noexcept = default;
+
+TrieBundle &TrieBundle::operator=(TrieBundle &&) noexcept = default;
+
+void TrieBundle::mmap(const char *filename, int flags) {
+  MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
+
+  std::unique_ptr<Impl> temp(new Impl);
+  temp->mapper.open(filename, flags);
+  temp->flags = flags;
+  temp->open();
+  impl_.swap(temp);
+}
+
+void TrieBundle::map(const void *ptr, std::size_t size) {
+  MARISA_THROW_IF((ptr == nullptr) && (size != 0), std::invalid_argument);
+
+  std::unique_ptr<Impl> temp(new Impl);
+  temp->mapper.open(ptr, size);
+  temp->open();
+  impl_.swap(temp);
+}
+
+const Trie *TrieBundle::find(std::string_view name) const {
+  MARISA_THROW_IF(impl_ == nullptr, std::logic_error);
+
+  Agent agent;
+  agent.set_query(name);
+  if (!impl_->directory.lookup(agent)) {
+    return nullptr;
+  }
+  return &impl_->get(agent.key().id());
+}
+
+const Trie &TrieBundle::trie(std::size_t i) const {
+  MARISA_THROW_IF(impl_ == nullptr, std::logic_error);
+  MARISA_THROW_IF(i >= size(), std::out_of_range);
+  return impl_->get(i);
+}
+
+std::string TrieBundle::name(std::size_t i) const {
+  MARISA_THROW_IF(impl_ == nullptr, std::logic_error);
+  MARISA_THROW_IF(i >= size(), std::out_of_range);
+
+  Agent agent;
+  agent.set_query(i);
+  impl_->directory.reverse_lookup(agent);
+  return std::string(agent.key().str());
+}
+
+std::size_t TrieBundle::offset(std::size_t i) const {
+  MARISA_THROW_IF(impl_ == nullptr, std::logic_error);
+  MARISA_THROW_IF(i >= size(), std::out_of_range);
+  return static_cast<std::size_t>(impl_->entries[i].offset);
+}
+
+std::size_t TrieBundle::io_size(std::size_t i) const {
+  MARISA_THROW_IF(impl_ == nullptr, std::logic_error);
+  MARISA_THROW_IF(i >= size(), std::out_of_range);
+  return static_cast<std::size_t>(impl_->entries[i].size);
+}
+
+bool TrieBundle::empty() const {
+  return size() == 0;
+}
+
+std::size_t TrieBundle::size() const {
+  MARISA_THROW_IF(impl_ == nullptr, std::logic_error);
+  return impl_->directory.num_keys();
+}
+
+void TrieBundle::clear() noexcept {
+  TrieBundle().swap(*this);
+}
+
+void TrieBundle::swap(TrieBundle &rhs) noexcept {
+  impl_.swap(rhs.impl_);
+}
+
+TrieBundleBuilder::TrieBundleBuilder() = default;
+
+TrieBundleBuilder::~TrieBundleBuilder() = default;
+
+void TrieBundleBuilder::add(std::string_view name, const Trie &trie) {
+  entries_.emplace_back(std::string(name), &trie);
+}
+
+void TrieBundleBuilder::save(const char *filename, int flags) const {
+  MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
+
+  std::ofstream file(filename, std::ios::binary);
+  MARISA_THROW_IF(!file, std::runtime_error);
+  write(file, flags);
+  file.close();
+  MARISA_THROW_IF(!file, std::runtime_error);
+}
+
+// The size of the directory does not depend on its values, so the offsets
+// of tries are computed with the size of a directory with dummy values.
+void TrieBundleBuilder::write(std::ostream &stream, int flags) const {
+  Keyset keyset;
+  for (const auto &entry : entries_) {
+    keyset.push_back(entry.first);
+  }
+  Trie directory;
+  directory.build(keyset, MARISA_LABEL_ORDER);
+  MARISA_THROW_IF(directory.num_keys() != entries_.size(),
+                  std::invalid_argument);
+
+  std::vector<const Trie *> tries(entries_.size());
+  for (const auto &entry : entries_) {
+    Agent agent;
+    agent.set_query(entry.first);
+    directory.lookup(agent);
+    tries[agent.key().id()] = entry.second;
+  }
+
+  std::vector<uint64_t> values(tries.size() * 2);
+  directory.set_values(values.data(), VALUE_SIZE, tries.size());
+  const uint64_t directory_size = directory.io_size();
+  uint64_t offset = align(HEADER_SIZE + sizeof(uint64_t) + directory_size);
+  for (std::size_t i = 0; i < tries.size(); ++i) {
+    values[i * 2] = offset;
+    values[(i * 2) + 1] = tries[i]->io_size(flags);
+    offset = align(offset + values[(i * 2) + 1]);
+  }
+  directory.set_values(values.data(), VALUE_SIZE, tries.size());
+
+  const auto pad = [&stream](uint64_t size) {
+    static const char buf[ALIGNMENT] = {};
+    stream.write(buf, static_cast<std::streamsize>(align(size) - size));
+  };
+  stream.write(get_header(), HEADER_SIZE);
+  stream.write(reinterpret_cast<const char *>(&directory_size),
+               sizeof(directory_size));
+  marisa::write(stream, directory);
+  pad(HEADER_SIZE + sizeof(uint64_t) + directory_size);
+  for (std::size_t i = 0; i < tries.size(); ++i) {
+    marisa::write(stream, *tries[i], flags);
+    pad(values[(i * 2) + 1]);
+  }
+  MARISA_THROW_IF(!stream, std::runtime_error);
+}
+
+void TrieBundleBuilder::clear() noexcept {
+  entries_.clear();
+}
+
+}  // namespace marisa
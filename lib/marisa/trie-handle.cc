@@ -0,0 +1,94 @@
+#include "marisa/trie-handle.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace marisa {
+namespace {
+
+#ifdef __cpp_lib_atomic_shared_ptr
+
+TrieHandle::Snapshot load_snapshot(
+    const std::atomic<TrieHandle::Snapshot> &current) {
+  return current.load(std::memory_order_acquire);
+}
+
+TrieHandle::Snapshot exchange_snapshot(
+    std::atomic<TrieHandle::Snapshot> &current, TrieHandle::Snapshot trie) {
+  return current.exchange(std::move(trie), std::memory_order_acq_rel);
+}
+
+#else  // __cpp_lib_atomic_shared_ptr
+
+TrieHandle::Snapshot load_snapshot(const TrieHandle::Snapshot &current) {
+  return std::atomic_load_explicit(&current, std::memory_order_acquire);
+}
+
+TrieHandle::Snapshot exchange_snapshot(TrieHandle::Snapshot &current,
+                                       TrieHandle::Snapshot trie) {
+  return std::atomic_exchange_explicit(&current, std::move(trie),
+                                       std::memory_order_acq_rel);
+}
+
+#endif  // __cpp_lib_atomic_shared_ptr
+
+}  // namespace
+
+TrieHandle::TrieHandle() = default;
+
+TrieHandle::TrieHandle(Trie &&trie) {
+  publish(std::move(trie));
+}
+
+TrieHandle::~TrieHandle() = default;
+
+TrieHandle::Snapshot TrieHandle::snapshot() const {
+  return load_snapshot(current_);
+}
+
+void TrieHandle::publish(Trie &&trie) {
+  Snapshot new_trie = std::make_shared<const Trie>(std::move(trie));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  Snapshot old_trie = exchange_snapshot(current_, std::move(new_trie));
+  generation_.fetch_add(1, std::memory_order_release);
+  if (old_trie != nullptr) {
+    retired_.push_back(std::move(old_trie));
+  }
+  reclaim_();
+}
+
+void TrieHandle::mmap(const char *filename, int flags) {
+  Trie trie;
+  trie.mmap(filename, flags);
+  publish(std::move(trie));
+}
+
+void TrieHandle::load(const char *filename) {
+  Trie trie;
+  trie.load(filename);
+  publish(std::move(trie));
+}
+
+std::size_t TrieHandle::reclaim() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return reclaim_();
+}
+
+std::size_t TrieHandle::generation() const {
+  return generation_.load(std::memory_order_acquire);
+}
+
+// A retired trie is unreachable from current_, so its use count never grows
+// again, and a use count of 1 means that only `retired_' holds it.
+std::size_t TrieHandle::reclaim_() {
+  retired_.erase(std::remove_if(retired_.begin(), retired_.end(),
+                                [](const Snapshot &trie) {
+                                  return trie.use_count() == 1;
+                                }),
+                 retired_.end());
+  return retired_.size();
+}
+
+}  // namespace marisa
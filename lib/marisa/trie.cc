@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <stdexcept>
+#include <utility>
 
 #include "marisa/grimoire/trie.h"
 #include "marisa/iostream.h"
@@ -21,18 +22,72 @@ void Trie::build(Keyset &keyset, int config_flags) {
   std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie);
 
   temp->build(keyset, config_flags);
-  trie_.swap(temp);
+  trie_ = std::move(temp);
+}
+
+void Trie::build(Keyset &keyset, int config_flags,
+                 const BuildCallback &callback) {
+  std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie);
+
+  temp->build(keyset, config_flags, &callback);
+  trie_ = std::move(temp);
 }
 
 void Trie::mmap(const char *filename, int flags) {
+  mmap(filename, flags, MapPolicy(flags));
+}
+
+void Trie::mmap(const char *filename, std::size_t offset, std::size_t size,
+                int flags) {
+  mmap(filename, offset, size, flags, MapPolicy(flags));
+}
+
+void Trie::map_fd(int fd, std::size_t offset, std::size_t size, int flags) {
+  map_fd(fd, offset, size, flags, MapPolicy(flags));
+}
+
+void Trie::mmap(const char *filename, int flags, const MapPolicy &policy) {
   MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
 
   std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie);
 
   grimoire::Mapper mapper;
   mapper.open(filename, flags);
+  mapper.set_policy(policy);
+  temp->map(mapper);
+  MARISA_THROW_IF((flags & MARISA_MAP_VERIFY) && !temp->verify(),
+                  std::runtime_error);
+  trie_ = std::move(temp);
+}
+
+void Trie::mmap(const char *filename, std::size_t offset, std::size_t size,
+                int flags, const MapPolicy &policy) {
+  MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
+
+  std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie);
+
+  grimoire::Mapper mapper;
+  mapper.open(filename, offset, size, flags);
+  mapper.set_policy(policy);
+  temp->map(mapper);
+  MARISA_THROW_IF((flags & MARISA_MAP_VERIFY) && !temp->verify(),
+                  std::runtime_error);
+  trie_ = std::move(temp);
+}
+
+void Trie::map_fd(int fd, std::size_t offset, std::size_t size, int flags,
+                  const MapPolicy &policy) {
+  MARISA_THROW_IF(fd == -1, std::invalid_argument);
+
+  std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie);
+
+  grimoire::Mapper mapper;
+  mapper.open(fd, offset, size, flags);
+  mapper.set_policy(policy);
   temp->map(mapper);
-  trie_.swap(temp);
+  MARISA_THROW_IF((flags & MARISA_MAP_VERIFY) && !temp->verify(),
+                  std::runtime_error);
+  trie_ = std::move(temp);
 }
 
 void Trie::map(const void *ptr, std::size_t size) {
@@ -43,47 +98,94 @@ void Trie::map(const void *ptr, std::size_t size) {
   grimoire::Mapper mapper;
   mapper.open(ptr, size);
   temp->map(mapper);
-  trie_.swap(temp);
+  trie_ = std::move(temp);
 }
 
 void Trie::load(const char *filename) {
+  load(filename, 0);
+}
+
+void Trie::load(const char *filename, int flags) {
   MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
+  MARISA_THROW_IF((flags & ~MARISA_MAP_VERIFY) != 0, std::invalid_argument);
 
   std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie);
 
   grimoire::Reader reader;
   reader.open(filename);
   temp->read(reader);
-  trie_.swap(temp);
+  MARISA_THROW_IF((flags & MARISA_MAP_VERIFY) && !temp->verify(),
+                  std::runtime_error);
+  trie_ = std::move(temp);
 }
 
 void Trie::read(int fd) {
+  read(fd, 0);
+}
+
+void Trie::read(int fd, int flags) {
   MARISA_THROW_IF(fd == -1, std::invalid_argument);
+  MARISA_THROW_IF((flags & ~MARISA_MAP_VERIFY) != 0, std::invalid_argument);
 
   std::unique_ptr<grimoire::LoudsTrie> temp(new grimoire::LoudsTrie);
 
   grimoire::Reader reader;
   reader.open(fd);
   temp->read(reader);
-  trie_.swap(temp);
+  MARISA_THROW_IF((flags & MARISA_MAP_VERIFY) && !temp->verify(),
+                  std::runtime_error);
+  trie_ = std::move(temp);
 }
 
 void Trie::save(const char *filename) const {
+  save(filename, 0);
+}
+
+void Trie::save(const char *filename, int flags) const {
   MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
   MARISA_THROW_IF(filename == nullptr, std::invalid_argument);
 
   grimoire::Writer writer;
   writer.open(filename);
-  trie_->write(writer);
+  trie_->write(writer, flags);
 }
 
 void Trie::write(int fd) const {
+  write(fd, 0);
+}
+
+std::size_t Trie::write(int fd, int flags) const {
   MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
   MARISA_THROW_IF(fd == -1, std::invalid_argument);
 
   grimoire::Writer writer;
   writer.open(fd);
-  trie_->write(writer);
+  trie_->write(writer, flags);
+  return writer.offset();
+}
+
+int Trie::create_memfd(const char *name, int flags) const {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  MARISA_THROW_IF(name == nullptr, std::invalid_argument);
+
+  grimoire::Writer writer;
+  writer.open_memfd(name);
+  trie_->write(writer, flags);
+  return writer.seal();
+}
+
+bool Trie::verify() const {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  return trie_->verify();
+}
+
+std::future<bool> Trie::verify_async() const {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  // The task shares the ownership, so the trie may be cleared, replaced or
+  // destroyed before the result is ready.
+  std::shared_ptr<const grimoire::LoudsTrie> trie = trie_;
+  return std::async(std::launch::async,
+                    [trie = std::move(trie)] { return trie->verify(); });
 }
 
 bool Trie::lookup(Agent &agent) const {
@@ -94,6 +196,15 @@ bool Trie::lookup(Agent &agent) const {
   return trie_->lookup(agent);
 }
 
+std::optional<std::size_t> Trie::lookup(std::string_view key) const {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  std::size_t key_id;
+  if (!trie_->lookup(key, &key_id)) {
+    return std::nullopt;
+  }
+  return key_id;
+}
+
 void Trie::reverse_lookup(Agent &agent) const {
   MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
   if (!agent.has_state()) {
@@ -118,6 +229,106 @@ bool Trie::predictive_search(Agent &agent) const {
   return trie_->predictive_search(agent);
 }
 
+void Trie::set_values(const void *values, std::size_t value_size,
+                      std::size_t num_values) {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  trie_->set_values(values, value_size, num_values);
+}
+
+void Trie::set_values(const std::string_view *values, std::size_t num_values) {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  trie_->set_values(values, num_values);
+}
+
+void Trie::clear_values() {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  trie_->clear_values();
+}
+
+bool Trie::has_values() const {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  return trie_->values() != nullptr;
+}
+
+std::size_t Trie::value_size() const {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  MARISA_THROW_IF(trie_->values() == nullptr, std::logic_error);
+  return trie_->values()->value_size();
+}
+
+std::string_view Trie::value(std::size_t key_id) const {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  MARISA_THROW_IF(trie_->values() == nullptr, std::logic_error);
+  MARISA_THROW_IF(key_id >= trie_->values()->size(), std::out_of_range);
+  return (*trie_->values())[key_id];
+}
+
+bool Trie::lookup_value(Agent &agent, std::string_view *value) const {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  MARISA_THROW_IF(trie_->values() == nullptr, std::logic_error);
+  MARISA_THROW_IF(value == nullptr, std::invalid_argument);
+  if (!agent.has_state()) {
+    agent.init_state();
+  }
+  if (!trie_->lookup(agent)) {
+    return false;
+  }
+  *value = (*trie_->values())[agent.key().id()];
+  return true;
+}
+
+void Trie::set_postings(const uint32_t *ids, const uint64_t *offsets,
+                        std::size_t num_lists) {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  trie_->set_postings(ids, offsets, num_lists);
+}
+
+void Trie::clear_postings() {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  trie_->clear_postings();
+}
+
+bool Trie::has_postings() const {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  return trie_->postings() != nullptr;
+}
+
+PostingList Trie::postings(std::size_t key_id) const {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  MARISA_THROW_IF(trie_->postings() == nullptr, std::logic_error);
+  MARISA_THROW_IF(key_id >= trie_->postings()->size(), std::out_of_range);
+  return (*trie_->postings())[key_id];
+}
+
+bool Trie::lookup_postings(Agent &agent, PostingList *postings) const {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  MARISA_THROW_IF(trie_->postings() == nullptr, std::logic_error);
+  MARISA_THROW_IF(postings == nullptr, std::invalid_argument);
+  if (!agent.has_state()) {
+    agent.init_state();
+  }
+  if (!trie_->lookup(agent)) {
+    return false;
+  }
+  *postings = (*trie_->postings())[agent.key().id()];
+  return true;
+}
+
+void Trie::set_filter(std::size_t bits_per_key) {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  trie_->set_filter(bits_per_key);
+}
+
+void Trie::clear_filter() {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  trie_->clear_filter();
+}
+
+bool Trie::has_filter() const {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  return trie_->filter() != nullptr;
+}
+
 std::size_t Trie::num_tries() const {
   MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
   return trie_->num_tries();
@@ -159,8 +370,19 @@ std::size_t Trie::total_size() const {
 }
 
 std::size_t Trie::io_size() const {
+  return io_size(0);
+}
+
+std::size_t Trie::io_size(int flags) const {
   MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
-  return trie_->io_size();
+  return trie_->io_size(flags);
+}
+
+SizeReport Trie::size_report() const {
+  MARISA_THROW_IF(trie_ == nullptr, std::logic_error);
+  SizeReport report;
+  trie_->report_size(&report);
+  return report;
 }
 
 void Trie::clear() noexcept {
@@ -187,14 +409,14 @@ class TrieIO {
     grimoire::Reader reader;
     reader.open(file);
     temp->read(reader);
-    trie->trie_.swap(temp);
+    trie->trie_ = std::move(temp);
   }
-  static void fwrite(std::FILE *file, const Trie &trie) {
+  static void fwrite(std::FILE *file, const Trie &trie, int flags) {
     MARISA_THROW_IF(file == nullptr, std::invalid_argument);
     MARISA_THROW_IF(trie.trie_ == nullptr, std::logic_error);
     grimoire::Writer writer;
     writer.open(file);
-    trie.trie_->write(writer);
+    trie.trie_->write(writer, flags);
   }
 
   static std::istream &read(std::istream &stream, Trie *trie) {
@@ -205,14 +427,15 @@ class TrieIO {
     grimoire::Reader reader;
     reader.open(stream);
     temp->read(reader);
-    trie->trie_.swap(temp);
+    trie->trie_ = std::move(temp);
     return stream;
   }
-  static std::ostream &write(std::ostream &stream, const Trie &trie) {
+  static std::ostream &write(std::ostream &stream, const Trie &trie,
+                             int flags) {
     MARISA_THROW_IF(trie.trie_ == nullptr, std::logic_error);
     grimoire::Writer writer;
     writer.open(stream);
-    trie.trie_->write(writer);
+    trie.trie_->write(writer, flags);
     return stream;
   }
 };
@@ -224,8 +447,12 @@ void fread(std::FILE *file, Trie *trie) {
 }
 
 void fwrite(std::FILE *file, const Trie &trie) {
+  fwrite(file, trie, 0);
+}
+
+void fwrite(std::FILE *file, const Trie &trie, int flags) {
   MARISA_THROW_IF(file == nullptr, std::invalid_argument);
-  TrieIO::fwrite(file, trie);
+  TrieIO::fwrite(file, trie, flags);
 }
 
 std::istream &read(std::istream &stream, Trie *trie) {
@@ -234,7 +461,11 @@ std::istream &read(std::istream &stream, Trie *trie) {
 }
 
 std::ostream &write(std::ostream &stream, const Trie &trie) {
-  return TrieIO::write(stream, trie);
+  return write(stream, trie, 0);
+}
+
+std::ostream &write(std::ostream &stream, const Trie &trie, int flags) {
+  return TrieIO::write(stream, trie, flags);
 }
 
 std::istream &operator>>(std::istream &stream, Trie &trie) {
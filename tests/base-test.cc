@@ -197,6 +197,68 @@ void TestKeyset() {
   ASSERT(keyset.size() == 0);
   ASSERT(keyset.total_length() == 0);
 
+  // Keys added by push_back_ref() refer to the given memory.
+  total_length = 0;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    keyset.push_back_ref(keys[i], weights[i]);
+    total_length += keys[i].length();
+    ASSERT(keyset.total_length() == total_length);
+  }
+
+  ASSERT(keyset.size() == keys.size());
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    ASSERT(keyset[i].ptr() == keys[i].data());
+    ASSERT(keyset[i].length() == keys[i].length());
+    ASSERT(keyset[i].weight() == weights[i]);
+  }
+
+  {
+    std::string data;
+    std::vector<uint32_t> offsets32(1, 0);
+    std::vector<uint64_t> offsets64(1, 0);
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      data += keys[i];
+      offsets32.push_back(static_cast<uint32_t>(data.length()));
+      offsets64.push_back(data.length());
+    }
+
+    marisa::Keyset keyset32(data.data(), offsets32.data(), keys.size());
+    marisa::Keyset keyset64(data.data(), offsets64.data(), keys.size());
+    ASSERT(keyset32.size() == keys.size());
+    ASSERT(keyset64.size() == keys.size());
+    ASSERT(keyset32.total_length() == data.length());
+    ASSERT(keyset64.total_length() == data.length());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      ASSERT(keyset32[i].ptr() == data.data() + offsets32[i]);
+      ASSERT(keyset32[i].str() == keys[i]);
+      ASSERT(keyset64[i].ptr() == data.data() + offsets64[i]);
+      ASSERT(keyset64[i].str() == keys[i]);
+      ASSERT(keyset64[i].weight() == 1.0F);
+    }
+
+    offsets32[1] = offsets32[2] + 1;
+    EXCEPT(keyset32.push_back_refs(data.data(), offsets32.data(), 2),
+           std::invalid_argument);
+    ASSERT(keyset32.size() == keys.size());
+
+    // Invalid input is rejected before any key is appended.
+    EXCEPT(keyset64.push_back_refs(nullptr, offsets64.data(), keys.size()),
+           std::invalid_argument);
+    ASSERT(keyset64.size() == keys.size());
+    ASSERT(keyset64.total_length() == data.length());
+    const uint64_t long_offsets[] = {0, 1, uint64_t{UINT32_MAX} + 2};
+    EXCEPT(keyset64.push_back_refs(data.data(), long_offsets, 2),
+           std::invalid_argument);
+    ASSERT(keyset64.size() == keys.size());
+    keyset64.push_back_refs(nullptr, offsets64.data(), 0);
+    const uint64_t empty_offsets[] = {0, 0, 0};
+    keyset64.push_back_refs(nullptr, empty_offsets, 2);
+    ASSERT(keyset64.size() == (keys.size() + 2));
+    ASSERT(keyset64[keys.size()].length() == 0);
+  }
+
+  keyset.reset();
+
   total_length = 0;
   for (std::size_t i = 0; i < keys.size(); ++i) {
     keys[i].resize(random_engine() % (marisa::Keyset::EXTRA_BLOCK_SIZE * 2));
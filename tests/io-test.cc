@@ -5,14 +5,18 @@
 #endif  // _MSC_VER
 
 #include <fcntl.h>
+#include <marisa/grimoire/algorithm/crc32c.h>
 #include <marisa/grimoire/io.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
 #include <cstdint>
+#include <cstring>
 #include <exception>
+#include <fstream>
 #include <sstream>
 #include <stdexcept>
+#include <string>
 
 #include "marisa-assert.h"
 
@@ -72,6 +76,25 @@ void TestFilename() {
     EXCEPT(mapper.map(&byte), std::runtime_error);
   }
 
+  {
+    marisa::grimoire::Mapper mapper;
+    mapper.open("io-test.dat", MARISA_MAP_BULK_LOAD);
+
+    std::uint32_t value;
+    mapper.map(&value);
+    ASSERT(value == 123);
+    mapper.map(&value);
+    ASSERT(value == 234);
+
+    const double *values;
+    mapper.map(&values, 2);
+    ASSERT(values[0] == 3.45);
+    ASSERT(values[1] == 4.56);
+
+    char byte;
+    EXCEPT(mapper.map(&byte), std::runtime_error);
+  }
+
   {
     marisa::grimoire::Mapper mapper;
     mapper.open("io-test.dat", MARISA_MAP_POPULATE);
@@ -91,6 +114,29 @@ void TestFilename() {
     EXCEPT(mapper.map(&byte), std::runtime_error);
   }
 
+  {
+    marisa::grimoire::Mapper mapper;
+    mapper.open("io-test.dat", MARISA_MAP_LOCK_INDEX |
+                                   MARISA_MAP_WILLNEED_INDEX |
+                                   MARISA_MAP_RANDOM_DATA | MARISA_MAP_HUGEPAGE);
+
+    const void *const begin = mapper.ptr();
+    std::uint32_t value;
+    mapper.map(&value);
+    ASSERT(value == 123);
+    TryLock([&] {
+      mapper.advise(begin, mapper.ptr(), MARISA_INDEX_SECTION);
+    });
+    ASSERT(mapper.ptr() == static_cast<const char *>(begin) + sizeof(value));
+
+    const void *const data_begin = mapper.ptr();
+    mapper.seek(sizeof(value) + (sizeof(double) * 2));
+    mapper.advise(data_begin, mapper.ptr(), MARISA_VALUE_SECTION);
+
+    char byte;
+    EXCEPT(mapper.map(&byte), std::runtime_error);
+  }
+
   {
     marisa::grimoire::Writer writer;
     writer.open("io-test.dat");
@@ -128,6 +174,7 @@ void TestFd() {
 
     double values[] = {34.5, 67.8};
     writer.write(values, 2);
+    ASSERT(writer.offset() == sizeof(value) + sizeof(values));
 
 #ifdef _MSC_VER
     ASSERT(::_close(fd) == 0);
@@ -160,11 +207,30 @@ void TestFd() {
     char byte;
     EXCEPT(reader.read(&byte), std::runtime_error);
 
+    // A mapper maps a range of the file and keeps its own descriptor.
+    marisa::grimoire::Mapper mapper;
+    mapper.open(fd, sizeof(std::uint32_t), 0);
+    marisa::grimoire::Mapper loader;
+    loader.open(fd, sizeof(std::uint32_t), sizeof(double) * 2,
+                MARISA_MAP_BULK_LOAD);
+
+    EXCEPT(mapper.open(fd, 21, 0), std::runtime_error);
+    EXCEPT(mapper.open(fd, 4, 17), std::runtime_error);
+
 #ifdef _MSC_VER
     ASSERT(::_close(fd) == 0);
 #else   // _MSC_VER
     ASSERT(::close(fd) == 0);
 #endif  // _MSC_VER
+
+    for (marisa::grimoire::Mapper *m : {&mapper, &loader}) {
+      const char *ptr;
+      m->map(&ptr, sizeof(values));
+      std::memcpy(values, ptr, sizeof(values));
+      ASSERT(values[0] == 34.5);
+      ASSERT(values[1] == 67.8);
+      EXCEPT(m->map(&byte), std::runtime_error);
+    }
   }
 
   TEST_END();
@@ -258,6 +324,229 @@ void TestStream() {
   TEST_END();
 }
 
+void TestAlignment() {
+  TEST_START();
+
+  std::stringstream stream;
+
+  {
+    marisa::grimoire::Writer writer;
+    writer.open(stream);
+    EXCEPT(writer.set_alignment(0), std::invalid_argument);
+    EXCEPT(writer.set_alignment(48), std::invalid_argument);
+
+    writer.write(std::uint32_t{12});
+    writer.align();
+    ASSERT(writer.offset() == sizeof(std::uint32_t));
+
+    writer.set_alignment(64);
+    writer.align();
+    ASSERT(writer.offset() == 64);
+    writer.align();
+    ASSERT(writer.offset() == 64);
+    writer.write(std::uint32_t{34});
+  }
+
+  ASSERT(stream.str().size() == 64 + sizeof(std::uint32_t));
+
+  {
+    marisa::grimoire::Reader reader;
+    reader.open(stream);
+    reader.set_alignment(64);
+
+    std::uint32_t value;
+    reader.read(&value);
+    ASSERT(value == 12);
+    reader.align();
+    ASSERT(reader.offset() == 64);
+    reader.read(&value);
+    ASSERT(value == 34);
+  }
+
+  {
+    const std::string buf = stream.str();
+    marisa::grimoire::Mapper mapper;
+    mapper.open(static_cast<const void *>(buf.data()), buf.size());
+    mapper.set_alignment(64);
+
+    std::uint32_t value;
+    mapper.map(&value);
+    ASSERT(value == 12);
+    mapper.align();
+    ASSERT(mapper.offset() == 64);
+    mapper.map(&value);
+    ASSERT(value == 34);
+    EXCEPT(mapper.align(), std::runtime_error);
+  }
+
+  TEST_END();
+}
+
+void TestChecksum() {
+  TEST_START();
+
+  using marisa::grimoire::algorithm::crc32c;
+
+  ASSERT(crc32c("", 0) == 0);
+  ASSERT(crc32c("123456789", 9) == 0xE3069283U);
+
+  // Checksums are chained regardless of alignment and length.
+  std::string data;
+  for (std::size_t i = 0; i < 1000; ++i) {
+    data.push_back(static_cast<char>((i * 31) ^ (i >> 3)));
+  }
+  const std::uint32_t expected = crc32c(data.data(), data.size());
+  for (std::size_t i = 0; i < 20; ++i) {
+    const std::uint32_t crc = crc32c(data.data(), i);
+    ASSERT(crc32c(data.data() + i, data.size() - i, crc) == expected);
+  }
+
+  std::stringstream stream;
+  {
+    marisa::grimoire::Writer writer;
+    writer.open(stream);
+    writer.write(std::uint32_t{12});
+    ASSERT(writer.checksum() == 0);
+
+    writer.enable_checksum();
+    writer.write(data.data(), data.size());
+    ASSERT(writer.checksum() == expected);
+    writer.reset_checksum();
+    ASSERT(writer.checksum() == 0);
+  }
+
+  {
+    marisa::grimoire::Reader reader;
+    reader.open(stream);
+    std::uint32_t value;
+    reader.read(&value);
+    ASSERT(value == 12);
+
+    reader.enable_checksum();
+    std::string buf(data.size(), '\0');
+    reader.read(&buf[0], buf.size());
+    ASSERT(buf == data);
+    ASSERT(reader.checksum() == expected);
+  }
+
+  TEST_END();
+}
+
+void TestParallelLoad() {
+  TEST_START();
+
+  // Readers take ranges aligned to 2MB. For these sizes, size / num_readers
+  // is a multiple of 2MB but does not cover the remainder.
+  constexpr std::size_t HUGE_PAGE_SIZE = std::size_t{1} << 21;
+  for (const std::size_t num_readers : {2, 3, 4}) {
+    const std::size_t size = (HUGE_PAGE_SIZE * num_readers) + num_readers - 1;
+    std::string data(size, '\0');
+    for (std::size_t i = 0; i < size; ++i) {
+      data[i] = static_cast<char>((i % 251) + 1);
+    }
+    {
+      marisa::grimoire::Writer writer;
+      writer.open("io-test.dat");
+      writer.write(data.data(), data.size());
+    }
+
+    marisa::grimoire::Mapper::set_num_readers(num_readers);
+    marisa::grimoire::Mapper mapper;
+    mapper.open("io-test.dat", MARISA_MAP_BULK_LOAD);
+    marisa::grimoire::Mapper::set_num_readers(0);
+
+    const char *ptr;
+    mapper.map(&ptr, size);
+    ASSERT(std::memcmp(ptr, data.data(), size) == 0);
+  }
+
+  TEST_END();
+}
+
+#ifdef __linux__
+// GetLockedSize() returns VmLck of the process in kB.
+std::size_t GetLockedSize() {
+  std::ifstream file("/proc/self/status");
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.compare(0, 6, "VmLck:") == 0) {
+      return static_cast<std::size_t>(std::stoul(line.substr(6)));
+    }
+  }
+  return 0;
+}
+#endif  // __linux__
+
+void TestMapPolicy() {
+  TEST_START();
+
+  {
+    const marisa::MapPolicy policy;
+    for (int i = 0; i <= MARISA_NUM_SECTION_TYPES; ++i) {
+      ASSERT(policy.get(static_cast<marisa_section_type>(i)) == 0);
+    }
+  }
+
+  {
+    const marisa::MapPolicy policy(MARISA_MAP_LOCK_INDEX |
+                                   MARISA_MAP_RANDOM_DATA);
+    ASSERT(policy.get(MARISA_INDEX_SECTION) == MARISA_ADVICE_LOCK);
+    ASSERT(policy.get(MARISA_TAIL_SECTION) == MARISA_ADVICE_RANDOM);
+    ASSERT(policy.get(MARISA_CACHE_SECTION) == MARISA_ADVICE_LOCK);
+    ASSERT(policy.get(MARISA_VALUE_SECTION) == MARISA_ADVICE_RANDOM);
+    ASSERT(policy.get(MARISA_POSTING_SECTION) == MARISA_ADVICE_RANDOM);
+    ASSERT(policy.get(MARISA_KEY_FILTER_SECTION) == MARISA_ADVICE_LOCK);
+  }
+
+  {
+    marisa::MapPolicy policy(MARISA_MAP_HUGEPAGE);
+    ASSERT(policy.get(MARISA_TAIL_SECTION) == MARISA_ADVICE_HUGEPAGE);
+    policy.set(MARISA_TAIL_SECTION,
+               MARISA_ADVICE_WILLNEED | MARISA_ADVICE_RANDOM);
+    ASSERT(policy.get(MARISA_TAIL_SECTION) ==
+           (MARISA_ADVICE_WILLNEED | MARISA_ADVICE_RANDOM));
+    ASSERT(policy.get(MARISA_INDEX_SECTION) == MARISA_ADVICE_HUGEPAGE);
+
+    EXCEPT(policy.set(static_cast<marisa_section_type>(0), 0),
+           std::invalid_argument);
+    EXCEPT(policy.set(MARISA_NUM_SECTION_TYPES, 0), std::invalid_argument);
+    EXCEPT(policy.set(MARISA_TAIL_SECTION, MARISA_ADVICE_MASK + 1),
+           std::invalid_argument);
+  }
+
+  {
+    marisa::grimoire::Writer writer;
+    writer.open("io-test.dat");
+    writer.seek(4096);
+  }
+
+  {
+    // The policy replaces the flags given to open(), so only the value
+    // section is locked.
+    marisa::MapPolicy policy;
+    policy.set(MARISA_VALUE_SECTION, MARISA_ADVICE_LOCK);
+    marisa::grimoire::Mapper mapper;
+    mapper.open("io-test.dat", MARISA_MAP_LOCK_INDEX);
+    mapper.set_policy(policy);
+
+    const void *const begin = mapper.ptr();
+    mapper.seek(4096);
+    mapper.advise(begin, mapper.ptr(), MARISA_INDEX_SECTION);
+#ifdef __linux__
+    ASSERT(GetLockedSize() == 0);
+#endif  // __linux__
+    if (TryLock([&] {
+          mapper.advise(begin, mapper.ptr(), MARISA_VALUE_SECTION);
+        })) {
+#ifdef __linux__
+      ASSERT(GetLockedSize() != 0);
+#endif  // __linux__
+    }
+  }
+
+  TEST_END();
+}
+
 }  // namespace
 
 int main() try {
@@ -265,6 +554,10 @@ int main() try {
   TestFd();
   TestFile();
   TestStream();
+  TestAlignment();
+  TestChecksum();
+  TestParallelLoad();
+  TestMapPolicy();
 
   return 0;
 } catch (const std::exception &ex) {
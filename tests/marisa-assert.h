@@ -3,6 +3,7 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <system_error>
 
 #define ASSERT(cond)                                                       \
   (void)((!!(cond)) || ((std::cout << __LINE__ << ": Assertion `" << #cond \
@@ -24,4 +25,22 @@
 
 #define TEST_END() (std::cout << "ok\n")
 
+// TryLock() calls `f', which locks memory, and returns false if the process
+// may not lock memory, i.e. mlock() fails with EPERM without CAP_IPC_LOCK or
+// with ENOMEM beyond RLIMIT_MEMLOCK. Checks of locked memory are skipped then.
+template <typename F>
+inline bool TryLock(F f) {
+  try {
+    f();
+    return true;
+  } catch (const std::system_error &ex) {
+    if ((ex.code() != std::errc::operation_not_permitted) &&
+        (ex.code() != std::errc::not_enough_memory)) {
+      throw;
+    }
+  }
+  std::cout << "(mlock() is not permitted) ";
+  return false;
+}
+
 #endif  // MARISA_ASSERT_H_
@@ -0,0 +1,55 @@
+# Checks that marisa-build with sorted runs (-T) writes the same trie as a
+# build in memory. Keys have duplicates with various weights, and the run
+# size of 1 KiB spills dozens of runs, so the merge of runs must sum the
+# weights of duplicates across runs to get the same weight order.
+#
+# Usage: cmake -DMARISA_BUILD=<path> -DWORK_DIR=<dir> -P marisa-build-test.cmake
+
+if(NOT MARISA_BUILD OR NOT WORK_DIR)
+  message(FATAL_ERROR "MARISA_BUILD and WORK_DIR must be given")
+endif()
+
+set(_runs_dir "${WORK_DIR}/runs")
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(MAKE_DIRECTORY "${_runs_dir}")
+
+# Weights are small integers, so their sums do not depend on the order.
+set(_keys "")
+foreach(_i RANGE 1999)
+  math(EXPR _key "(${_i} * 37) % 500")
+  math(EXPR _weight "(${_i} % 7) + 1")
+  string(APPEND _keys "key${_key}\t${_weight}\n")
+endforeach()
+file(WRITE "${WORK_DIR}/keys.txt" "${_keys}")
+
+foreach(_args "" "-T;${_runs_dir};-R;1")
+  if(_args STREQUAL "")
+    set(_output "${WORK_DIR}/memory.dic")
+  else()
+    set(_output "${WORK_DIR}/runs.dic")
+  endif()
+  execute_process(
+    COMMAND "${MARISA_BUILD}" -w ${_args} -o "${_output}"
+            "${WORK_DIR}/keys.txt"
+    RESULT_VARIABLE _result
+    ERROR_VARIABLE _error
+  )
+  if(NOT _result EQUAL 0)
+    message(FATAL_ERROR "marisa-build ${_args} failed: ${_error}")
+  endif()
+endforeach()
+
+# Sorted runs are removed after the merge.
+file(GLOB _leftovers "${_runs_dir}/*")
+if(_leftovers)
+  message(FATAL_ERROR "sorted runs are left: ${_leftovers}")
+endif()
+
+execute_process(
+  COMMAND "${CMAKE_COMMAND}" -E compare_files "${WORK_DIR}/memory.dic"
+          "${WORK_DIR}/runs.dic"
+  RESULT_VARIABLE _result
+)
+if(NOT _result EQUAL 0)
+  message(FATAL_ERROR "sorted runs give a different trie")
+endif()
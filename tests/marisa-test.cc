@@ -1,13 +1,30 @@
 #include <marisa.h>
-
+#include <marisa/dynamic-trie.h>
+#include <marisa/replicated-trie.h>
+#include <marisa/set-operations.h>
+#include <marisa/trie-bundle.h>
+#include <marisa/trie-handle.h>
+
+#ifdef __linux__
+ #include <unistd.h>
+#endif  // __linux__
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <exception>
+#include <fstream>
+#include <iterator>
+#include <optional>
 #include <random>
+#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -231,6 +248,8 @@ void TestLookup(const marisa::Trie &trie, const marisa::Keyset &keyset) {
     agent.set_query(keyset[i].ptr(), keyset[i].length());
     ASSERT(trie.lookup(agent));
     ASSERT(agent.key().id() == keyset[i].id());
+    ASSERT(trie.lookup(keyset[i].str()) == keyset[i].id());
+    ASSERT(trie.contains(keyset[i].str()));
 
     agent.set_query(keyset[i].id());
     trie.reverse_lookup(agent);
@@ -467,12 +486,1227 @@ void TestTrie() {
   TestTrie(MARISA_BINARY_TAIL);
 }
 
+void TestDynamicTrie() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  keyset.push_back("a");
+  keyset.push_back("ab");
+  keyset.push_back("abc");
+  keyset.push_back("b");
+
+  marisa::Trie base;
+  base.build(keyset, MARISA_LABEL_ORDER);
+
+  marisa::DynamicTrie trie(std::move(base), MARISA_LABEL_ORDER);
+  ASSERT(trie.num_keys() == 4);
+  ASSERT(trie.delta_size() == 0);
+
+  trie.insert("abcd");
+  trie.insert("a");
+  trie.erase("ab");
+  trie.erase("xyz");
+  ASSERT(trie.num_keys() == 4);
+  ASSERT(trie.delta_size() == 2);
+
+  ASSERT(trie.lookup("a"));
+  ASSERT(!trie.lookup("ab"));
+  ASSERT(trie.lookup("abc"));
+  ASSERT(trie.lookup("abcd"));
+  ASSERT(!trie.lookup("xyz"));
+
+  const auto search = [&](bool is_predictive, std::string_view query) {
+    std::vector<std::string> keys;
+    const auto callback = [&](std::string_view key) {
+      keys.emplace_back(key);
+      return true;
+    };
+    if (is_predictive) {
+      trie.predictive_search(query, callback);
+    } else {
+      trie.common_prefix_search(query, callback);
+    }
+    return keys;
+  };
+
+  const std::vector<std::string> prefixes = {"a", "abc", "abcd"};
+  ASSERT(search(false, "abcde") == prefixes);
+  const std::vector<std::string> predicted = {"a", "abc", "abcd"};
+  ASSERT(search(true, "a") == predicted);
+
+  trie.compact();
+  ASSERT(trie.num_keys() == 4);
+  ASSERT(trie.delta_size() == 0);
+  ASSERT(search(false, "abcde") == prefixes);
+  ASSERT(search(true, "a") == predicted);
+
+  // Updates during a background compaction are kept in the delta.
+  std::set<std::string> expected = {"a", "abc", "abcd", "b"};
+  for (std::size_t i = 0; i < 1000; ++i) {
+    const std::string key = std::to_string(random_engine() % 500);
+    if (random_engine() % 3 == 0) {
+      trie.erase(key);
+      expected.erase(key);
+    } else {
+      trie.insert(key);
+      expected.insert(key);
+    }
+    if (i % 100 == 0) {
+      trie.compact_async();
+    }
+  }
+  trie.wait();
+  ASSERT(trie.num_keys() == expected.size());
+  for (std::size_t i = 0; i < 500; ++i) {
+    const std::string key = std::to_string(i);
+    ASSERT(trie.lookup(key) == (expected.count(key) != 0));
+  }
+  const std::vector<std::string> keys = search(true, "");
+  ASSERT(std::set<std::string>(keys.begin(), keys.end()) == expected);
+  ASSERT(keys.size() == expected.size());
+
+  trie.compact();
+  ASSERT(trie.delta_size() == 0);
+  ASSERT(trie.num_keys() == expected.size());
+
+  // Entries of the delta which are not prefixes of the query are skipped.
+  {
+    marisa::Keyset base_keyset;
+    base_keyset.push_back("a");
+    base_keyset.push_back("abc");
+    base_keyset.push_back("abd");
+    base_keyset.push_back("b");
+    marisa::Trie base_trie;
+    base_trie.build(base_keyset);
+
+    marisa::DynamicTrie trie2(std::move(base_trie));
+    trie2.insert("aa");
+    trie2.insert("ab");
+    trie2.erase("abc");
+    trie2.insert("abcd");
+    trie2.insert("abcde");
+    trie2.insert("abz");
+
+    std::vector<std::string> keys2;
+    trie2.common_prefix_search("abcdef", [&](std::string_view key) {
+      keys2.emplace_back(key);
+      return true;
+    });
+    const std::vector<std::string> prefixes2 = {"a", "ab", "abcd", "abcde"};
+    ASSERT(keys2 == prefixes2);
+  }
+
+  // The error of a compaction is kept until wait() reports it.
+  {
+    marisa::DynamicTrie trie2(~0);
+    trie2.insert("a");
+    trie2.compact_async();
+    while (trie2.compacting()) {
+      std::this_thread::yield();
+    }
+    trie2.compact_async();
+    ASSERT(!trie2.compacting());
+    EXCEPT(trie2.wait(), std::invalid_argument);
+    trie2.wait();
+  }
+
+  TEST_END();
+}
+
+void TestSetOperations() {
+  TEST_START();
+
+  std::set<std::string> lhs_keys, rhs_keys;
+  marisa::Keyset lhs_keyset, rhs_keyset;
+  for (std::size_t i = 0; i < 1000; ++i) {
+    const std::string key = std::to_string(random_engine() % 1500);
+    if (random_engine() % 2 == 0) {
+      lhs_keys.insert(key);
+      lhs_keyset.push_back(key);
+    } else {
+      rhs_keys.insert(key);
+      rhs_keyset.push_back(key);
+    }
+  }
+
+  // Weight order requires sorting, and label order is streamed.
+  marisa::Trie lhs, rhs;
+  lhs.build(lhs_keyset, MARISA_WEIGHT_ORDER);
+  rhs.build(rhs_keyset, MARISA_LABEL_ORDER);
+
+  const auto get_keys = [](const marisa::Trie &trie) {
+    std::set<std::string> keys;
+    marisa::Agent agent;
+    agent.set_query("");
+    while (trie.predictive_search(agent)) {
+      keys.emplace(agent.key().str());
+    }
+    ASSERT(keys.size() == trie.num_keys());
+    return keys;
+  };
+
+  std::set<std::string> expected;
+  marisa::Trie trie;
+
+  marisa::set_union(lhs, rhs, &trie);
+  std::set_union(lhs_keys.begin(), lhs_keys.end(), rhs_keys.begin(),
+                 rhs_keys.end(), std::inserter(expected, expected.end()));
+  ASSERT(get_keys(trie) == expected);
+
+  expected.clear();
+  marisa::set_intersection(lhs, rhs, &trie);
+  std::set_intersection(lhs_keys.begin(), lhs_keys.end(), rhs_keys.begin(),
+                        rhs_keys.end(),
+                        std::inserter(expected, expected.end()));
+  ASSERT(get_keys(trie) == expected);
+
+  expected.clear();
+  marisa::set_difference(lhs, rhs, &trie, MARISA_LABEL_ORDER);
+  std::set_difference(lhs_keys.begin(), lhs_keys.end(), rhs_keys.begin(),
+                      rhs_keys.end(), std::inserter(expected, expected.end()));
+  ASSERT(get_keys(trie) == expected);
+  ASSERT(trie.node_order() == MARISA_LABEL_ORDER);
+
+  std::vector<std::string> added, removed;
+  std::string prev_key;
+  marisa::diff(lhs, rhs, [&](std::string_view key, bool is_added) {
+    ASSERT(prev_key.empty() || (prev_key < key));
+    prev_key = key;
+    (is_added ? added : removed).emplace_back(key);
+    return true;
+  });
+  ASSERT(std::set<std::string>(removed.begin(), removed.end()) == expected);
+  expected.clear();
+  std::set_difference(rhs_keys.begin(), rhs_keys.end(), lhs_keys.begin(),
+                      lhs_keys.end(), std::inserter(expected, expected.end()));
+  ASSERT(std::set<std::string>(added.begin(), added.end()) == expected);
+
+  TEST_END();
+}
+
+void TestValues() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  keyset.push_back("apple");
+  keyset.push_back("banana");
+  keyset.push_back("cherry");
+  keyset.push_back("");
+
+  marisa::Trie trie;
+  trie.build(keyset);
+
+  ASSERT(!trie.has_values());
+  EXCEPT(trie.value(0), std::logic_error);
+
+  std::vector<uint32_t> fixed_values(trie.num_keys());
+  std::vector<std::string> variable_values(trie.num_keys());
+  for (std::size_t i = 0; i < keyset.size(); ++i) {
+    fixed_values[keyset[i].id()] = static_cast<uint32_t>(i * 1000);
+    variable_values[keyset[i].id()] = std::string(i, 'x');
+  }
+
+  EXCEPT(trie.set_values(fixed_values.data(), sizeof(uint32_t),
+                         fixed_values.size() - 1),
+         std::invalid_argument);
+  ASSERT(!trie.has_values());
+
+  const auto check_fixed_values = [&](const marisa::Trie &trie) {
+    ASSERT(trie.has_values());
+    ASSERT(trie.value_size() == sizeof(uint32_t));
+    EXCEPT(trie.value(trie.num_keys()), std::out_of_range);
+
+    marisa::Agent agent;
+    for (std::size_t i = 0; i < keyset.size(); ++i) {
+      std::string_view value;
+      agent.set_query(keyset[i].str());
+      ASSERT(trie.lookup_value(agent, &value));
+      ASSERT(agent.key().id() == keyset[i].id());
+      ASSERT(value.length() == sizeof(uint32_t));
+      uint32_t x;
+      std::memcpy(&x, value.data(), sizeof(x));
+      ASSERT(x == i * 1000);
+    }
+    std::string_view value;
+    agent.set_query("orange");
+    ASSERT(!trie.lookup_value(agent, &value));
+  };
+
+  trie.set_values(fixed_values.data(), sizeof(uint32_t), fixed_values.size());
+  check_fixed_values(trie);
+
+  trie.save("marisa-test.dat");
+  trie.clear();
+  trie.load("marisa-test.dat");
+  check_fixed_values(trie);
+
+  trie.clear();
+  trie.mmap("marisa-test.dat");
+  check_fixed_values(trie);
+
+  {
+    std::stringstream stream;
+    stream << trie;
+    trie.clear();
+    stream >> trie;
+  }
+  check_fixed_values(trie);
+
+  const auto check_variable_values = [&](const marisa::Trie &trie) {
+    ASSERT(trie.has_values());
+    ASSERT(trie.value_size() == 0);
+    for (std::size_t i = 0; i < keyset.size(); ++i) {
+      ASSERT(trie.value(keyset[i].id()) == variable_values[keyset[i].id()]);
+    }
+  };
+
+  std::vector<std::string_view> views(variable_values.begin(),
+                                      variable_values.end());
+  trie.set_values(views.data(), views.size());
+  check_variable_values(trie);
+
+  {
+    std::stringstream stream;
+    stream << trie;
+    ASSERT(stream.str().size() == trie.io_size());
+    trie.clear();
+    stream >> trie;
+    check_variable_values(trie);
+
+    const std::string buf = stream.str();
+    trie.clear();
+    trie.map(buf.data(), buf.size());
+    check_variable_values(trie);
+
+    // Offsets are followed by the value size and the number of values, and
+    // a corrupted offset in the middle is caught on access.
+    std::string buf2 = buf;
+    const std::size_t num_values = trie.num_keys();
+    const std::size_t offsets_pos =
+        buf2.size() - (sizeof(uint64_t) * (num_values + 3));
+    const uint64_t offset = buf2.size();
+    std::memcpy(&buf2[offsets_pos + sizeof(uint64_t)], &offset,
+                sizeof(offset));
+    trie.clear();
+    trie.map(buf2.data(), buf2.size());
+    EXCEPT(trie.value(0), std::runtime_error);
+    EXCEPT(trie.value(1), std::runtime_error);
+    ASSERT(trie.value(2) == variable_values[2]);
+  }
+
+  trie.clear_values();
+  ASSERT(!trie.has_values());
+
+  TEST_END();
+}
+
+void TestPostings() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  for (std::size_t i = 0; i < 100; ++i) {
+    keyset.push_back(std::to_string(i));
+  }
+
+  marisa::Trie trie;
+  trie.build(keyset);
+
+  ASSERT(!trie.has_postings());
+
+  // Gaps of various byte lengths are mixed, and some lists are empty.
+  std::vector<std::vector<uint32_t>> lists(trie.num_keys());
+  for (std::size_t i = 0; i < lists.size(); ++i) {
+    const std::size_t size = random_engine() % 40;
+    uint32_t id = 0;
+    for (std::size_t j = 0; j < size; ++j) {
+      const uint32_t max_gap = 1U << (random_engine() % 4 * 8);
+      const uint32_t gap = 1 + (random_engine() % max_gap);
+      if (id > (UINT32_MAX - gap)) {
+        break;
+      }
+      id += gap;
+      lists[i].push_back(id);
+    }
+  }
+
+  std::vector<uint32_t> ids;
+  std::vector<uint64_t> offsets(1, 0);
+  for (const std::vector<uint32_t> &list : lists) {
+    ids.insert(ids.end(), list.begin(), list.end());
+    offsets.push_back(ids.size());
+  }
+
+  EXCEPT(trie.set_postings(ids.data(), offsets.data(), lists.size() - 1),
+         std::invalid_argument);
+  {
+    const uint32_t unsorted_ids[] = {2, 1};
+    std::vector<uint64_t> unsorted_offsets(lists.size() + 1, 2);
+    unsorted_offsets[0] = 0;
+    EXCEPT(trie.set_postings(unsorted_ids, unsorted_offsets.data(),
+                             lists.size()),
+           std::invalid_argument);
+  }
+
+  trie.set_postings(ids.data(), offsets.data(), lists.size());
+
+  const auto check_postings = [&](const marisa::Trie &trie) {
+    ASSERT(trie.has_postings());
+
+    marisa::Agent agent;
+    for (std::size_t i = 0; i < keyset.size(); ++i) {
+      marisa::PostingList postings;
+      agent.set_query(keyset[i].str());
+      ASSERT(trie.lookup_postings(agent, &postings));
+      const std::vector<uint32_t> &list = lists[agent.key().id()];
+      ASSERT(postings.size() == list.size());
+      ASSERT(std::vector<uint32_t>(postings.begin(), postings.end()) == list);
+
+      std::vector<uint32_t> decoded(postings.size());
+      postings.decode(decoded.data());
+      ASSERT(decoded == list);
+    }
+  };
+
+  check_postings(trie);
+
+  trie.save("marisa-test.dat");
+  trie.clear();
+  trie.load("marisa-test.dat");
+  check_postings(trie);
+
+  trie.clear();
+  trie.mmap("marisa-test.dat");
+  check_postings(trie);
+
+  trie.clear();
+  if (TryLock([&] {
+        trie.mmap("marisa-test.dat",
+                  MARISA_MAP_LOCK_INDEX | MARISA_MAP_WILLNEED_INDEX |
+                      MARISA_MAP_RANDOM_DATA | MARISA_MAP_HUGEPAGE);
+      })) {
+    check_postings(trie);
+  }
+
+  trie.clear();
+  if (TryLock([&] {
+        trie.mmap("marisa-test.dat",
+                  MARISA_MAP_BULK_LOAD | MARISA_MAP_LOCK_INDEX);
+      })) {
+    check_postings(trie);
+  }
+
+  {
+    marisa::MapPolicy policy;
+    policy.set(MARISA_POSTING_SECTION, MARISA_ADVICE_WILLNEED);
+    policy.set(MARISA_TAIL_SECTION, MARISA_ADVICE_RANDOM);
+    trie.clear();
+    trie.mmap("marisa-test.dat", 0, policy);
+    check_postings(trie);
+  }
+
+  {
+    std::stringstream stream;
+    stream << trie;
+    ASSERT(stream.str().size() == trie.io_size());
+    trie.clear();
+    stream >> trie;
+  }
+  check_postings(trie);
+
+  // Offsets and sizes end the file, and a corrupted entry in the middle is
+  // caught on access.
+  {
+    std::stringstream stream;
+    stream << trie;
+    const std::string buf = stream.str();
+    const std::size_t num_lists = trie.num_keys();
+    const std::size_t sizes_pos =
+        buf.size() - (((sizeof(uint32_t) * num_lists) + 7) & ~std::size_t{7});
+    const std::size_t offsets_pos =
+        sizes_pos - (sizeof(uint64_t) * (num_lists + 2));
+
+    std::string buf2 = buf;
+    const uint64_t offset = buf2.size();
+    std::memcpy(&buf2[offsets_pos + sizeof(uint64_t)], &offset,
+                sizeof(offset));
+    marisa::Trie trie2;
+    trie2.map(buf2.data(), buf2.size());
+    EXCEPT(trie2.postings(0), std::runtime_error);
+    EXCEPT(trie2.postings(1), std::runtime_error);
+    ASSERT(std::vector<uint32_t>(trie2.postings(2).begin(),
+                                 trie2.postings(2).end()) == lists[2]);
+
+    buf2 = buf;
+    const uint32_t size = 1000;
+    std::memcpy(&buf2[sizes_pos], &size, sizeof(size));
+    trie2.map(buf2.data(), buf2.size());
+    EXCEPT(trie2.postings(0), std::runtime_error);
+    ASSERT(std::vector<uint32_t>(trie2.postings(1).begin(),
+                                 trie2.postings(1).end()) == lists[1]);
+  }
+
+  // Lists with common IDs are made from a small universe.
+  lists.assign(trie.num_keys(), std::vector<uint32_t>());
+  ids.clear();
+  offsets.assign(1, 0);
+  for (std::vector<uint32_t> &list : lists) {
+    for (uint32_t id = 0; id < 200; ++id) {
+      if ((random_engine() % 3) == 0) {
+        list.push_back(id);
+      }
+    }
+    ids.insert(ids.end(), list.begin(), list.end());
+    offsets.push_back(ids.size());
+  }
+  trie.set_postings(ids.data(), offsets.data(), lists.size());
+
+  std::vector<uint32_t> result, expected;
+  marisa::intersect(trie.postings(0), trie.postings(1), &result);
+  std::set_intersection(lists[0].begin(), lists[0].end(), lists[1].begin(),
+                        lists[1].end(), std::back_inserter(expected));
+  ASSERT(result == expected);
+
+  const marisa::PostingList postings[] = {trie.postings(2), trie.postings(3),
+                                          trie.postings(4)};
+  marisa::intersect(postings, 3, &result);
+  std::vector<uint32_t> temp;
+  std::set_intersection(lists[2].begin(), lists[2].end(), lists[3].begin(),
+                        lists[3].end(), std::back_inserter(temp));
+  expected.clear();
+  std::set_intersection(temp.begin(), temp.end(), lists[4].begin(),
+                        lists[4].end(), std::back_inserter(expected));
+  ASSERT(result == expected);
+
+  trie.clear_postings();
+  ASSERT(!trie.has_postings());
+  EXCEPT(trie.postings(0), std::logic_error);
+
+  TEST_END();
+}
+
+void TestTrieHandle() {
+  TEST_START();
+
+  marisa::TrieHandle handle;
+  ASSERT(handle.snapshot() == nullptr);
+  ASSERT(handle.generation() == 0);
+
+  const auto make_trie = [](std::size_t generation) {
+    marisa::Keyset keyset;
+    keyset.push_back("generation");
+    keyset.push_back(std::to_string(generation));
+    marisa::Trie trie;
+    trie.build(keyset);
+    return trie;
+  };
+
+  make_trie(1).save("marisa-test.dat");
+  handle.mmap("marisa-test.dat");
+  ASSERT(handle.generation() == 1);
+
+  // A snapshot keeps the old trie alive after a new one is published.
+  const marisa::TrieHandle::Snapshot old_trie = handle.snapshot();
+  handle.publish(make_trie(2));
+  ASSERT(handle.generation() == 2);
+  ASSERT(handle.reclaim() == 1);
+
+  marisa::Agent agent;
+  agent.set_query("1");
+  ASSERT(old_trie->lookup(agent));
+  agent.set_query("2");
+  ASSERT(handle.snapshot()->lookup(agent));
+
+  EXCEPT(handle.mmap("does-not-exist.dat"), std::system_error);
+  ASSERT(handle.generation() == 2);
+
+  // Readers always find a complete trie while tries are being published.
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+  for (std::size_t i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      marisa::Agent agent;
+      while (!done) {
+        const marisa::TrieHandle::Snapshot trie = handle.snapshot();
+        agent.set_query("generation");
+        ASSERT(trie->lookup(agent));
+        ASSERT(trie->num_keys() == 2);
+      }
+    });
+  }
+  for (std::size_t i = 3; i < 100; ++i) {
+    handle.publish(make_trie(i));
+  }
+  done = true;
+  for (std::thread &reader : readers) {
+    reader.join();
+  }
+  ASSERT(handle.generation() == 99);
+  ASSERT(handle.reclaim() == 1);
+
+  TEST_END();
+}
+
+void TestFormatV2() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+
+  marisa::Trie trie;
+  trie.build(keyset, 2);
+
+  std::vector<uint64_t> values(trie.num_keys());
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = i * 3;
+  }
+  trie.set_values(values.data(), sizeof(uint64_t), values.size());
+
+  const auto check_trie = [&](const marisa::Trie &trie) {
+    ASSERT(trie.num_tries() == 2);
+    TestLookup(trie, keyset);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      uint64_t value;
+      std::memcpy(&value, trie.value(i).data(), sizeof(value));
+      ASSERT(value == values[i]);
+    }
+  };
+
+  trie.save("marisa-test.dat", MARISA_SAVE_V2);
+  {
+    std::stringstream stream;
+    marisa::write(stream, trie, MARISA_SAVE_V2);
+    const std::string buf = stream.str();
+    ASSERT(buf.size() == trie.io_size(MARISA_SAVE_V2));
+    ASSERT(buf.size() > trie.io_size());
+    ASSERT(buf.compare(0, 16, std::string("We love Marisa2", 16)) == 0);
+    ASSERT(buf.compare(buf.size() - 16, 16,
+                       std::string("We love Marisa2", 16)) == 0);
+
+    trie.clear();
+    stream >> trie;
+    check_trie(trie);
+
+    trie.clear();
+    trie.map(buf.data(), buf.size());
+    check_trie(trie);
+
+    // A truncated file is rejected.
+    trie.clear();
+    EXCEPT(trie.map(buf.data(), buf.size() - 16), std::runtime_error);
+
+    // The header gives the file size, so data may follow a trie.
+    {
+      std::stringstream stream2(buf + buf + "trailing data");
+      marisa::Trie trie2;
+      stream2 >> trie;
+      stream2 >> trie2;
+      check_trie(trie);
+      check_trie(trie2);
+      const std::string buf2 = buf + "trailing data";
+      trie.map(buf2.data(), buf2.size());
+      check_trie(trie);
+    }
+
+    // A wrong file size in the header is rejected before any section is
+    // read.
+    {
+      std::string buf2 = buf;
+      const uint64_t file_size = buf.size() + 64;
+      std::memcpy(&buf2[24], &file_size, sizeof(file_size));
+      trie.clear();
+      EXCEPT(trie.map(buf2.data(), buf2.size()), std::runtime_error);
+      std::stringstream stream2(buf2);
+      EXCEPT(stream2 >> trie, std::runtime_error);
+    }
+
+    // Sections are bounded by the table, so a vector size which reaches
+    // beyond its section is rejected even if it stays within the file.
+    {
+      std::string buf2 = buf;
+      const uint64_t vector_size = (buf.size() - 128) & ~uint64_t{7};
+      std::memcpy(&buf2[64], &vector_size, sizeof(vector_size));
+      trie.clear();
+      EXCEPT(trie.map(buf2.data(), buf2.size()), std::runtime_error);
+      std::stringstream stream2(buf2);
+      EXCEPT(stream2 >> trie, std::runtime_error);
+    }
+  }
+
+  trie.load("marisa-test.dat");
+  check_trie(trie);
+
+  // Descriptors are read and written in chunks, and the padding depends on
+  // the offsets counted on the way.
+  {
+    std::FILE *file = std::fopen("marisa-test.dat", "wb");
+    ASSERT(file != nullptr);
+#ifdef _MSC_VER
+    trie.write(::_fileno(file), MARISA_SAVE_V2);
+#else   // _MSC_VER
+    trie.write(::fileno(file), MARISA_SAVE_V2);
+#endif  // _MSC_VER
+    std::fclose(file);
+  }
+  {
+    std::ifstream file("marisa-test.dat", std::ios::binary | std::ios::ate);
+    ASSERT(static_cast<std::size_t>(file.tellg()) ==
+           trie.io_size(MARISA_SAVE_V2));
+  }
+  {
+    std::FILE *file = std::fopen("marisa-test.dat", "rb");
+    ASSERT(file != nullptr);
+    trie.clear();
+#ifdef _MSC_VER
+    trie.read(::_fileno(file));
+#else   // _MSC_VER
+    trie.read(::fileno(file));
+#endif  // _MSC_VER
+    std::fclose(file);
+  }
+  check_trie(trie);
+  ASSERT(trie.verify());
+
+  // Vectors are aligned to 64 bytes in the version 2 format.
+  trie.mmap("marisa-test.dat");
+  check_trie(trie);
+  ASSERT((reinterpret_cast<std::uintptr_t>(trie.value(0).data()) % 64) == 0);
+
+  EXCEPT(trie.save("marisa-test.dat", 1 << 8), std::invalid_argument);
+
+  TEST_END();
+}
+
+void TestChecksum() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+
+  marisa::Trie trie;
+  trie.build(keyset, 2);
+  std::vector<uint32_t> values(trie.num_keys());
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<uint32_t>(i);
+  }
+  trie.set_values(values.data(), sizeof(uint32_t), values.size());
+
+  std::string buf;
+  {
+    std::stringstream stream;
+    marisa::write(stream, trie, MARISA_SAVE_V2);
+    buf = stream.str();
+  }
+
+  trie.map(buf.data(), buf.size());
+  ASSERT(trie.verify());
+  ASSERT(trie.verify_async().get());
+
+  // The version 1 format has no checksums.
+  trie.save("marisa-test.dat");
+  trie.mmap("marisa-test.dat", MARISA_MAP_VERIFY);
+  ASSERT(trie.verify());
+
+  // A corrupted value is detected only by verification.
+  {
+    std::string corrupted = buf;
+    const std::size_t offset = buf.rfind(std::string(
+        reinterpret_cast<const char *>(&values[100]), sizeof(uint32_t) * 2));
+    ASSERT(offset != std::string::npos);
+    corrupted[offset] ^= 1;
+
+    trie.map(corrupted.data(), corrupted.size());
+    ASSERT(!trie.verify());
+    ASSERT(!trie.verify_async().get());
+
+    std::stringstream stream(corrupted);
+    stream >> trie;
+    ASSERT(!trie.verify());
+
+    std::ofstream file("marisa-test.dat", std::ios::binary);
+    file.write(corrupted.data(),
+               static_cast<std::streamsize>(corrupted.size()));
+  }
+  trie.mmap("marisa-test.dat");
+  ASSERT(!trie.verify());
+  EXCEPT(trie.mmap("marisa-test.dat", MARISA_MAP_VERIFY), std::runtime_error);
+  trie.load("marisa-test.dat");
+  ASSERT(!trie.verify());
+  EXCEPT(trie.load("marisa-test.dat", MARISA_MAP_VERIFY), std::runtime_error);
+  EXCEPT(trie.load("marisa-test.dat", MARISA_MAP_HUGEPAGE),
+         std::invalid_argument);
+
+  // The table of contents is always verified.
+  {
+    std::string corrupted = buf;
+    corrupted[buf.size() - 48] ^= 1;
+    EXCEPT(trie.map(corrupted.data(), corrupted.size()), std::runtime_error);
+  }
+
+  // Checksums cover the padding before the first vector.
+  {
+    std::string corrupted = buf;
+    corrupted[100] ^= 1;
+    trie.map(corrupted.data(), corrupted.size());
+    ASSERT(!trie.verify());
+  }
+
+  // Replacing optional sections does not modify the mapped image.
+  trie.map(buf.data(), buf.size());
+  trie.set_values(values.data(), sizeof(uint32_t), values.size());
+  ASSERT(trie.verify());
+  trie.set_filter(10);
+  ASSERT(trie.verify());
+  trie.clear_values();
+  ASSERT(trie.verify());
+
+  // verify_async() keeps the loaded image alive after clear().
+  {
+    std::ofstream file("marisa-test.dat", std::ios::binary);
+    file.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+  }
+  trie.load("marisa-test.dat", MARISA_MAP_VERIFY);
+  {
+    std::future<bool> result = trie.verify_async();
+    trie.clear();
+    ASSERT(result.get());
+  }
+
+  TEST_END();
+}
+
+void TestMapFd() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+
+  marisa::Trie trie;
+  trie.build(keyset, 2);
+  const std::size_t trie_size = trie.io_size(MARISA_SAVE_V2);
+
+  // A trie follows unaligned garbage in a file.
+  {
+    std::ofstream file("marisa-test.dat", std::ios::binary);
+    file.write("garbage", 7);
+    marisa::write(file, trie);
+  }
+  {
+    std::FILE *file = std::fopen("marisa-test.dat", "rb");
+    ASSERT(file != nullptr);
+#ifdef _MSC_VER
+    const int fd = ::_fileno(file);
+#else   // _MSC_VER
+    const int fd = ::fileno(file);
+#endif  // _MSC_VER
+    marisa::Trie mapped;
+    mapped.map_fd(fd, 7);
+    EXCEPT(mapped.map_fd(fd, 8), std::runtime_error);
+    std::fclose(file);
+    TestLookup(mapped, keyset);
+  }
+
+#ifdef __linux__
+  const int fd = trie.create_memfd("marisa-test", MARISA_SAVE_V2);
+  ASSERT(fd != -1);
+  {
+    marisa::Trie mapped;
+    mapped.map_fd(fd, 0, trie_size, MARISA_MAP_VERIFY);
+    TestLookup(mapped, keyset);
+  }
+  // The file is sealed.
+  ASSERT(::write(fd, "x", 1) == -1);
+  ASSERT(::ftruncate(fd, 0) == -1);
+  ASSERT(::close(fd) == 0);
+#else   // __linux__
+  (void)trie_size;
+#endif  // __linux__
+
+  TEST_END();
+}
+
+void TestMmapOffset() {
+  TEST_START();
+
+  marisa::Keyset keyset1, keyset2;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset1);
+  MakeKeyset(500, MARISA_BINARY_TAIL, &keyset2);
+
+  marisa::Trie trie1, trie2;
+  trie1.build(keyset1, 2);
+  trie2.build(keyset2);
+  const std::vector<uint32_t> values(trie1.num_keys(), 123);
+  trie1.set_values(values.data(), sizeof(uint32_t), values.size());
+
+  // Tries are bundled after a 64-byte header.
+  std::size_t size1, size2;
+  {
+    std::FILE *file = std::fopen("marisa-test.dat", "wb");
+    ASSERT(file != nullptr);
+    const char header[64] = "bundle";
+    ASSERT(std::fwrite(header, 1, sizeof(header), file) == sizeof(header));
+    ASSERT(std::fflush(file) == 0);
+#ifdef _MSC_VER
+    const int fd = ::_fileno(file);
+#else   // _MSC_VER
+    const int fd = ::fileno(file);
+#endif  // _MSC_VER
+    size1 = trie1.write(fd, MARISA_SAVE_V2);
+    ASSERT(size1 == trie1.io_size(MARISA_SAVE_V2));
+    size2 = trie2.write(fd, 0);
+    ASSERT(size2 == trie2.io_size());
+    std::fclose(file);
+  }
+
+  marisa::Trie trie;
+  trie.mmap("marisa-test.dat", 64, size1, MARISA_MAP_VERIFY);
+  TestLookup(trie, keyset1);
+  ASSERT((reinterpret_cast<std::uintptr_t>(trie.value(0).data()) % 64) == 0);
+
+  trie.mmap("marisa-test.dat", 64 + size1, size2);
+  TestLookup(trie, keyset2);
+  trie.mmap("marisa-test.dat", 64 + size1, 0, MARISA_MAP_BULK_LOAD);
+  TestLookup(trie, keyset2);
+
+  EXCEPT(trie.mmap("marisa-test.dat", 64, size1 - 1), std::runtime_error);
+  EXCEPT(trie.mmap("marisa-test.dat", 64 + size1, size2 + 1),
+         std::runtime_error);
+
+  TEST_END();
+}
+
+void TestTrieBundle() {
+  TEST_START();
+
+  std::vector<marisa::Keyset> keysets(3);
+  std::vector<marisa::Trie> tries(keysets.size());
+  for (std::size_t i = 0; i < keysets.size(); ++i) {
+    MakeKeyset(100 * (i + 1), MARISA_TEXT_TAIL, &keysets[i]);
+    tries[i].build(keysets[i]);
+  }
+
+  marisa::TrieBundleBuilder builder;
+  builder.add("ja", tries[0]);
+  builder.add("en", tries[1]);
+  builder.add("fr", tries[2]);
+  builder.save("marisa-test.dat", MARISA_SAVE_V2);
+
+  marisa::TrieBundle bundle;
+  bundle.mmap("marisa-test.dat", MARISA_MAP_VERIFY);
+  ASSERT(bundle.size() == 3);
+  ASSERT(bundle.name(0) == "en");
+  ASSERT(bundle.name(1) == "fr");
+  ASSERT(bundle.name(2) == "ja");
+  for (std::size_t i = 0; i < bundle.size(); ++i) {
+    ASSERT((bundle.offset(i) % 64) == 0);
+  }
+  ASSERT(bundle.io_size(2) == tries[0].io_size(MARISA_SAVE_V2));
+  EXCEPT(bundle.trie(3), std::out_of_range);
+
+  ASSERT(bundle.find("de") == nullptr);
+  const marisa::Trie *ja = bundle.find("ja");
+  ASSERT(ja != nullptr);
+  ASSERT(ja == &bundle.trie(2));
+  TestLookup(*ja, keysets[0]);
+  TestLookup(*bundle.find("en"), keysets[1]);
+
+  // Tries are mapped once even if threads race.
+  std::vector<std::thread> threads;
+  std::vector<const marisa::Trie *> found(4);
+  for (std::size_t i = 0; i < found.size(); ++i) {
+    threads.emplace_back(
+        [&bundle, &found, i] { found[i] = bundle.find("fr"); });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (const marisa::Trie *trie : found) {
+    ASSERT(trie == bundle.find("fr"));
+  }
+  TestLookup(*found[0], keysets[2]);
+
+  {
+    std::stringstream stream;
+    builder.write(stream);
+    const std::string buf = stream.str();
+    marisa::TrieBundle mapped;
+    mapped.map(buf.data(), buf.size());
+    TestLookup(*mapped.find("fr"), keysets[2]);
+
+    EXCEPT(mapped.map(buf.data(), buf.size() / 2), std::runtime_error);
+  }
+
+  builder.add("en", tries[0]);
+  EXCEPT(builder.save("marisa-test.dat"), std::invalid_argument);
+
+  builder.clear();
+  builder.save("marisa-test.dat");
+  bundle.mmap("marisa-test.dat");
+  ASSERT(bundle.empty());
+
+  TEST_END();
+}
+
+void TestReplicatedTrie() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+
+  marisa::Trie trie;
+  trie.build(keyset);
+  trie.save("marisa-test.dat", MARISA_SAVE_V2);
+
+  marisa::ReplicatedTrie replicated;
+  ASSERT(replicated.num_replicas() == 0);
+  EXCEPT(replicated.local(), std::logic_error);
+
+  replicated.load("marisa-test.dat", MARISA_MAP_VERIFY | MARISA_MAP_HUGEPAGE);
+  ASSERT(replicated.num_replicas() >= 1);
+  for (std::size_t i = 0; i < replicated.num_replicas(); ++i) {
+    TestLookup(replicated.replica(i), keyset);
+  }
+  EXCEPT(replicated.replica(replicated.num_replicas()), std::out_of_range);
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < 4; ++i) {
+    threads.emplace_back([&replicated, &keyset] {
+      TestLookup(replicated.local(), keyset);
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  replicated.clear();
+  ASSERT(replicated.num_replicas() == 0);
+
+  TEST_END();
+}
+
+void TestSizeReport() {
+  TEST_START();
+
+  marisa::Trie trie;
+  EXCEPT(trie.size_report(), std::logic_error);
+
+  for (const marisa::TailMode tail_mode :
+       {MARISA_TEXT_TAIL, MARISA_BINARY_TAIL}) {
+    marisa::Keyset keyset;
+    MakeKeyset(1000, tail_mode, &keyset);
+    trie.build(keyset, 3 | tail_mode);
+
+    std::vector<std::string_view> values(trie.num_keys(), "value");
+    trie.set_values(values.data(), values.size());
+
+    const marisa::SizeReport report = trie.size_report();
+    ASSERT(report.levels.size() == trie.num_tries());
+    ASSERT(report.levels[0].num_nodes == trie.num_nodes());
+    ASSERT(report.levels[0].num_terminals == trie.num_keys());
+    ASSERT(report.tail.mode == trie.tail_mode());
+    ASSERT(report.values_size != 0);
+    ASSERT(report.postings_size == 0);
+    ASSERT(report.total_size == trie.total_size());
+    ASSERT(report.io_size == trie.io_size());
+
+    std::size_t total_size = report.tail.total_size() + report.values_size +
+                             report.postings_size + report.filter_size;
+    for (const marisa::LevelSizeReport &level : report.levels) {
+      ASSERT(level.louds.index_size < level.louds.size);
+      total_size += level.total_size();
+    }
+    ASSERT(total_size == report.total_size);
+
+    if (report.tail.num_suffixes != 0) {
+      ASSERT(report.tail.unshared_size >= report.tail.buf.size);
+      ASSERT(report.tail.sharing_ratio() >= 0.0);
+      ASSERT(report.tail.sharing_ratio() < 1.0);
+    }
+  }
+
+  TEST_END();
+}
+
+void TestBuildCallback() {
+  TEST_START();
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+  marisa::Keyset keyset2;
+  for (std::size_t i = 0; i < keyset.size(); ++i) {
+    keyset2.push_back(keyset[i].ptr(), keyset[i].length());
+  }
+
+  std::vector<marisa::BuildEvent> events;
+  marisa::Trie trie;
+  trie.build(keyset, 3, [&events](const marisa::BuildEvent &event) {
+    events.push_back(event);
+  });
+  TestLookup(trie, keyset);
+
+  std::set<std::string> phases;
+  std::size_t max_level = 0;
+  std::size_t max_peak_vector_size = 0;
+  for (const marisa::BuildEvent &event : events) {
+    ASSERT(event.elapsed >= 0.0);
+    phases.insert(event.phase);
+    max_level = std::max(max_level, event.level);
+    max_peak_vector_size =
+        std::max(max_peak_vector_size, event.peak_vector_size);
+  }
+  ASSERT(std::string(events.front().phase) == "keys");
+  ASSERT(max_level + 1 == trie.num_tries());
+  ASSERT(max_peak_vector_size >= trie.total_size());
+  for (const char *phase :
+       {"keys", "sort", "trie", "bit_vector", "terminals", "key_ids",
+        "links"}) {
+    ASSERT(phases.count(phase) == 1);
+  }
+
+  EXCEPT(trie.build(keyset, 3,
+                    [](const marisa::BuildEvent &) {
+                      throw std::runtime_error("cancelled");
+                    }),
+         std::runtime_error);
+  TestLookup(trie, keyset);
+
+  marisa::Trie trie2;
+  trie2.build(keyset2, 3);
+  ASSERT(trie2.io_size() == trie.io_size());
+  TestLookup(trie2, keyset2);
+
+  TEST_END();
+}
+
+void TestAgentFreeLookup() {
+  TEST_START();
+
+  marisa::Trie trie;
+  EXCEPT(trie.lookup(std::string_view("apple")), std::logic_error);
+  EXCEPT(trie.contains("apple"), std::logic_error);
+
+  for (const marisa::TailMode tail_mode :
+       {MARISA_TEXT_TAIL, MARISA_BINARY_TAIL}) {
+    marisa::Keyset keyset;
+    MakeKeyset(1000, tail_mode, &keyset);
+    trie.build(keyset, 3 | tail_mode | MARISA_TINY_CACHE);
+    TestLookup(trie, keyset);
+
+    // Prefixes and extensions of keys fail at various depths, and the result
+    // must agree with lookup() with an agent.
+    marisa::Agent agent;
+    for (std::size_t i = 0; i < keyset.size(); ++i) {
+      std::string key(keyset[i].str());
+      for (const std::string &query :
+           {key + '0', key + '\x01', key.substr(0, key.length() / 2)}) {
+        agent.set_query(query);
+        const std::optional<std::size_t> key_id = trie.lookup(query);
+        ASSERT(key_id.has_value() == trie.lookup(agent));
+        ASSERT(trie.contains(query) == key_id.has_value());
+        if (key_id.has_value()) {
+          ASSERT(*key_id == agent.key().id());
+        }
+      }
+    }
+  }
+
+  TEST_END();
+}
+
+void TestKeyFilter() {
+  TEST_START();
+
+  marisa::Trie trie;
+  EXCEPT(trie.set_filter(), std::logic_error);
+
+  marisa::Keyset keyset;
+  MakeKeyset(1000, MARISA_TEXT_TAIL, &keyset);
+  trie.build(keyset, 3);
+  const std::size_t io_size = trie.io_size();
+  ASSERT(!trie.has_filter());
+
+  EXCEPT(trie.set_filter(0), std::invalid_argument);
+  EXCEPT(trie.set_filter(65), std::invalid_argument);
+  ASSERT(!trie.has_filter());
+
+  trie.set_filter(10);
+  ASSERT(trie.has_filter());
+  ASSERT(trie.size_report().filter_size != 0);
+
+  // Misses have a byte that never appears in keys. The filter rejects most
+  // of them, and the trie rejects false positives.
+  std::vector<std::string> misses;
+  for (std::size_t i = 0; i < keyset.size(); ++i) {
+    std::string miss(keyset[i].str());
+    miss.insert(random_engine() % (miss.length() + 1), 1, 'x');
+    misses.push_back(miss);
+  }
+  const auto check_filter = [&](const marisa::Trie &trie) {
+    ASSERT(trie.has_filter());
+    TestLookup(trie, keyset);
+
+    marisa::Agent agent;
+    for (const std::string &miss : misses) {
+      agent.set_query(miss);
+      ASSERT(!trie.lookup(agent));
+      ASSERT(!trie.contains(miss));
+    }
+  };
+  check_filter(trie);
+
+  for (const int save_flags : {0, static_cast<int>(MARISA_SAVE_V2)}) {
+    trie.save("marisa-test.dat", save_flags);
+    marisa::Trie trie2;
+    trie2.load("marisa-test.dat");
+    check_filter(trie2);
+    ASSERT(trie2.io_size(save_flags) == trie.io_size(save_flags));
+    ASSERT(trie2.verify());
+
+    trie2.clear();
+    if (TryLock([&] {
+          trie2.mmap("marisa-test.dat",
+                     MARISA_MAP_LOCK_INDEX | MARISA_MAP_WILLNEED_INDEX);
+        })) {
+      check_filter(trie2);
+      ASSERT(trie2.verify());
+    }
+
+    std::stringstream stream;
+    marisa::write(stream, trie, save_flags);
+    ASSERT(stream.str().size() == trie.io_size(save_flags));
+    trie2.clear();
+    marisa::read(stream, &trie2);
+    check_filter(trie2);
+  }
+
+  trie.clear_filter();
+  ASSERT(!trie.has_filter());
+  ASSERT(trie.io_size() == io_size);
+  TestLookup(trie, keyset);
+
+  TEST_END();
+}
+
 }  // namespace
 
 int main() try {
   TestEmptyTrie();
   TestTinyTrie();
   TestTrie();
+  TestDynamicTrie();
+  TestSetOperations();
+  TestValues();
+  TestPostings();
+  TestTrieHandle();
+  TestFormatV2();
+  TestChecksum();
+  TestMapFd();
+  TestMmapOffset();
+  TestTrieBundle();
+  TestReplicatedTrie();
+  TestSizeReport();
+  TestBuildCallback();
+  TestAgentFreeLookup();
+  TestKeyFilter();
 
   return 0;
 } catch (const std::exception &ex) {
@@ -1,5 +1,6 @@
 #include <marisa/grimoire/trie/config.h>
 #include <marisa/grimoire/trie/header.h>
+#include <marisa/grimoire/trie/key-filter.h>
 #include <marisa/grimoire/trie/key.h>
 #include <marisa/grimoire/trie/range.h>
 #include <marisa/grimoire/trie/state.h>
@@ -10,6 +11,7 @@
 #include <cstring>
 #include <exception>
 #include <sstream>
+#include <string>
 
 #include "marisa-assert.h"
 
@@ -420,6 +422,85 @@ void TestBinaryTail() {
   TEST_END();
 }
 
+void TestKeyFilter() {
+  TEST_START();
+
+  marisa::grimoire::trie::KeyFilter filter;
+  ASSERT(filter.empty());
+
+  EXCEPT(filter.build(100, 0), std::invalid_argument);
+  EXCEPT(filter.build(100, 65), std::invalid_argument);
+
+  // An empty filter rejects everything.
+  filter.build(0, 10);
+  ASSERT(filter.size() == 1);
+  ASSERT(!filter.contains(""));
+  ASSERT(!filter.contains("apple"));
+
+  // The hash must not change because filters are saved in files. The keys
+  // cover no, a partial, a full and a full plus a partial 8-byte word.
+  using marisa::grimoire::trie::KeyFilter;
+  ASSERT(KeyFilter::hash("") == 0x9CA066F1A4AB2EEAULL);
+  ASSERT(KeyFilter::hash(std::string_view()) == 0x9CA066F1A4AB2EEAULL);
+  ASSERT(KeyFilter::hash("a") == 0x8710A0093E3AC099ULL);
+  ASSERT(KeyFilter::hash("apple") == 0xCF69F498C4C36200ULL);
+  ASSERT(KeyFilter::hash("abcdefgh") == 0x7AF9B8D496FD5B58ULL);
+  ASSERT(KeyFilter::hash("abcdefghi") == 0x29933C86FD46BAD8ULL);
+  ASSERT(KeyFilter::hash("\xE3\x81\x82\xE3\x81\x84") ==
+         0xDE77991FAACF2F7DULL);
+  ASSERT(KeyFilter::hash("apple") != KeyFilter::hash("apples"));
+
+  filter.build(10000, 10);
+  ASSERT(filter.size() == 196);
+  ASSERT(filter.num_hashes() == 7);
+  ASSERT(filter.total_size() ==
+         (filter.size() * marisa::grimoire::trie::KeyFilter::BLOCK_SIZE *
+          sizeof(std::uint64_t)));
+  for (std::size_t i = 0; i < 10000; ++i) {
+    filter.insert(std::to_string(i * 2));
+  }
+  const auto check_filter = [](const marisa::grimoire::trie::KeyFilter &f) {
+    std::size_t num_false_positives = 0;
+    for (std::size_t i = 0; i < 10000; ++i) {
+      ASSERT(f.contains(std::to_string(i * 2)));
+      num_false_positives += f.contains(std::to_string((i * 2) + 1)) ? 1 : 0;
+    }
+    // The expected false positive rate is about 1%.
+    ASSERT(num_false_positives < 300);
+  };
+  check_filter(filter);
+
+  {
+    std::stringstream stream;
+    marisa::grimoire::Writer writer;
+    writer.open(stream);
+    filter.write(writer);
+    ASSERT(stream.str().size() == filter.io_size());
+    filter.clear();
+    ASSERT(filter.empty());
+    marisa::grimoire::Reader reader;
+    reader.open(stream);
+    filter.read(reader);
+  }
+  check_filter(filter);
+
+  {
+    marisa::grimoire::Writer writer;
+    writer.open("trie-test.dat");
+    filter.write(writer);
+  }
+  filter.clear();
+  {
+    marisa::grimoire::Mapper mapper;
+    mapper.open("trie-test.dat");
+    filter.map(mapper);
+    check_filter(filter);
+    filter.clear();
+  }
+
+  TEST_END();
+}
+
 void TestHistory() {
   TEST_START();
 
@@ -497,6 +578,7 @@ int main() try {
   TestEntry();
   TestTextTail();
   TestBinaryTail();
+  TestKeyFilter();
   TestHistory();
   TestState();
 
@@ -109,6 +109,10 @@ void TestVector() {
   ASSERT(vec.total_size() == (sizeof(int) * values.size()));
   ASSERT(vec.io_size() ==
          sizeof(std::uint64_t) + ((sizeof(int) * values.size())));
+  ASSERT(vec.io_size(0, 1) == vec.io_size());
+  ASSERT(vec.io_size(56, 64) == vec.io_size());
+  ASSERT(vec.io_size(0, 64) == (vec.io_size() + 56));
+  ASSERT(vec.io_size(64, 64) == (vec.io_size() + 56));
 
   ASSERT(static_cast<const marisa::grimoire::Vector<int> &>(vec).front() ==
          values.front());
@@ -1,15 +1,26 @@
 #include <marisa.h>
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <exception>
 #include <fstream>
 #include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "cmdopt.h"
+#include "query-log.h"
 
 namespace {
 
@@ -21,6 +32,68 @@ marisa::CacheLevel param_cache_level = MARISA_DEFAULT_CACHE;
 bool param_predict_on = true;
 bool param_reuse_on = true;
 bool param_print_speed = true;
+const char *param_queries = nullptr;
+int param_num_runs = 1;
+const char *param_compare = nullptr;
+double param_threshold = 5.0;
+const char *param_write_queries = nullptr;
+
+enum Workload {
+  NO_WORKLOAD,
+  UNIFORM_WORKLOAD,
+  ZIPF_WORKLOAD,
+  PREFIX_WORKLOAD,
+  MISS_WORKLOAD,
+  LONG_KEY_WORKLOAD,
+  NUM_WORKLOADS
+};
+
+const char *const WORKLOAD_NAMES[NUM_WORKLOADS] = {
+    "none", "uniform", "zipf", "prefix", "miss", "long"};
+
+Workload param_workload = NO_WORKLOAD;
+std::size_t param_num_queries = 100000;
+// Negative values are replaced with the defaults of the workload.
+double param_skew = -1.0;
+double param_miss_ratio = -1.0;
+uint32_t param_seed = 1;
+
+enum OutputFormat {
+  TEXT_FORMAT,
+  JSON_FORMAT,
+  CSV_FORMAT
+};
+
+OutputFormat param_format = TEXT_FORMAT;
+
+enum Operation {
+  BUILD_OPERATION,
+  LOOKUP_OPERATION,
+  REVERSE_LOOKUP_OPERATION,
+  COMMON_PREFIX_SEARCH_OPERATION,
+  PREDICTIVE_SEARCH_OPERATION,
+  NUM_OPERATIONS
+};
+
+const char *const OPERATION_NAMES[NUM_OPERATIONS] = {
+    "build", "lookup", "reverse_lookup", "common_prefix_search",
+    "predictive_search"};
+
+// Result keeps the time per key of each operation in each run, and the
+// latency of each query in each run, so that percentiles pool the samples of
+// all the runs as averages do. Every run replays queries after the other
+// operations have warmed its trie. Latencies are measured with
+// std::chrono::steady_clock because std::clock() is too coarse for a query.
+struct Result {
+  int num_tries;
+  std::size_t size;
+  std::vector<double> samples[NUM_OPERATIONS];
+  std::vector<uint64_t> latencies[NUM_QUERY_TYPES];
+  std::size_t num_misses[NUM_QUERY_TYPES];
+};
+
+std::vector<Query> queries;
+std::vector<Result> results;
 
 class Clock {
  public:
@@ -62,7 +135,45 @@ void print_help(const char *cmd) {
          "  -r, --reuse-off     don't reuse agents\n"
          "  -S, --print-speed   print speed [1000 keys/s] (default)\n"
          "  -s, --print-time    print time [ns/key]\n"
+         "  -q, --queries=[FILE]     replay queries in FILE in each run and"
+         " print latency\n"
+         "                           percentiles\n"
+         "  -x, --num-runs=[N]  repeat each benchmark N times (default: 1)\n"
+         "  -f, --format=[FMT]  print results in FMT: text, json or csv"
+         " (default: text)\n"
+         "  -C, --compare=[FILE]     compare results with a baseline written"
+         " by -f json\n"
+         "  -T, --threshold=[N]      flag regressions slower than the"
+         " baseline by N%\n"
+         "                           (default: 5)\n"
+         "  -G, --generate=[KIND]    generate queries of a workload KIND:"
+         " uniform,\n"
+         "                           zipf, prefix, miss or long\n"
+         "  -Q, --num-queries=[N]    generate N queries (default: 100000)\n"
+         "  -Z, --skew=[S]      draw keys with Zipf's law of exponent S"
+         " (default: 1 for\n"
+         "                      zipf, and 0, i.e. uniform, for the others)\n"
+         "  -M, --miss-ratio=[R]     make a ratio R of queries miss"
+         " (default: 0.9 for\n"
+         "                           miss, 0.5 for long and 0 for the"
+         " others)\n"
+         "  -e, --seed=[N]      seed the workload generator (default: 1)\n"
+         "  -W, --write-queries=[FILE]   write generated queries to FILE"
+         " for -q\n"
          "  -h, --help          print this help\n"
+         "\n"
+         "Each line of a query file is a key to look up, or OP<tab>QUERY where"
+         " OP is\n"
+         "one of `lookup', `reverse', `prefix' and `predict'. The QUERY of"
+         " `reverse'\n"
+         "is a key ID.\n"
+         "\n"
+         "Text output shows the median over runs. Regressions are flagged only"
+         " if they\n"
+         "are significant by Welch's t-test, which needs two or more runs in"
+         " both the\n"
+         "baseline and the current results. The exit status is 20 if there are"
+         " any.\n"
          "\n";
 }
 
@@ -119,20 +230,13 @@ void print_config() {
   }
 }
 
-void print_time_info(std::size_t num_keys, double elasped) {
-  if (param_print_speed) {
-    if (elasped == 0.0) {
-      std::printf(" %8s", "-");
-    } else {
-      std::printf(" %8.2f", static_cast<double>(num_keys) / elasped / 1000.0);
-    }
+void print_time_info(double ns_per_key) {
+  if (ns_per_key == 0.0) {
+    std::printf(" %8s", "-");
+  } else if (param_print_speed) {
+    std::printf(" %8.2f", 1000000.0 / ns_per_key);
   } else {
-    if ((elasped == 0.0) || (num_keys == 0)) {
-      std::printf(" %8s", "-");
-    } else {
-      std::printf(" %8.1f",
-                  1000000000.0 * elasped / static_cast<double>(num_keys));
-    }
+    std::printf(" %8.1f", ns_per_key);
   }
 }
 
@@ -168,24 +272,28 @@ int read_keys(const char *const *args, std::size_t num_args,
     }
     read_keys(input_file, keyset, weights);
   }
-  std::cout << "Number of keys: " << keyset->size() << "\n";
-  std::cout << "Total length: " << keyset->total_length() << "\n" << std::flush;
+  if (param_format == TEXT_FORMAT) {
+    std::cout << "Number of keys: " << keyset->size() << "\n";
+    std::cout << "Total length: " << keyset->total_length() << "\n"
+              << std::flush;
+  }
   return 0;
 }
 
-void benchmark_build(marisa::Keyset &keyset, const std::vector<float> &weights,
-                     int num_tries, marisa::Trie *trie) {
+double benchmark_build(marisa::Keyset &keyset,
+                       const std::vector<float> &weights, int num_tries,
+                       marisa::Trie *trie) {
   for (std::size_t i = 0; i < keyset.size(); ++i) {
     keyset[i].set_weight(weights[i]);
   }
   Clock cl;
   trie->build(keyset, num_tries | param_tail_mode | param_node_order |
                           param_cache_level);
-  std::printf(" %10lu", static_cast<unsigned long>(trie->io_size()));
-  print_time_info(keyset.size(), cl.elasped());
+  return cl.elasped();
 }
 
-void benchmark_lookup(const marisa::Trie &trie, const marisa::Keyset &keyset) {
+double benchmark_lookup(const marisa::Trie &trie,
+                        const marisa::Keyset &keyset) {
   Clock cl;
   if (param_reuse_on) {
     marisa::Agent agent;
@@ -193,7 +301,7 @@ void benchmark_lookup(const marisa::Trie &trie, const marisa::Keyset &keyset) {
       agent.set_query(keyset[i].ptr(), keyset[i].length());
       if (!trie.lookup(agent) || (agent.key().id() != keyset[i].id())) {
         std::cerr << "error: lookup() failed\n";
-        return;
+        return 0.0;
       }
     }
   } else {
@@ -202,15 +310,15 @@ void benchmark_lookup(const marisa::Trie &trie, const marisa::Keyset &keyset) {
       agent.set_query(keyset[i].ptr(), keyset[i].length());
       if (!trie.lookup(agent) || (agent.key().id() != keyset[i].id())) {
         std::cerr << "error: lookup() failed\n";
-        return;
+        return 0.0;
       }
     }
   }
-  print_time_info(keyset.size(), cl.elasped());
+  return cl.elasped();
 }
 
-void benchmark_reverse_lookup(const marisa::Trie &trie,
-                              const marisa::Keyset &keyset) {
+double benchmark_reverse_lookup(const marisa::Trie &trie,
+                                const marisa::Keyset &keyset) {
   Clock cl;
   if (param_reuse_on) {
     marisa::Agent agent;
@@ -222,7 +330,7 @@ void benchmark_reverse_lookup(const marisa::Trie &trie,
           (std::memcmp(agent.key().ptr(), keyset[i].ptr(),
                        agent.key().length()) != 0)) {
         std::cerr << "error: reverse_lookup() failed\n";
-        return;
+        return 0.0;
       }
     }
   } else {
@@ -235,15 +343,15 @@ void benchmark_reverse_lookup(const marisa::Trie &trie,
           (std::memcmp(agent.key().ptr(), keyset[i].ptr(),
                        agent.key().length()) != 0)) {
         std::cerr << "error: reverse_lookup() failed\n";
-        return;
+        return 0.0;
       }
     }
   }
-  print_time_info(keyset.size(), cl.elasped());
+  return cl.elasped();
 }
 
-void benchmark_common_prefix_search(const marisa::Trie &trie,
-                                    const marisa::Keyset &keyset) {
+double benchmark_common_prefix_search(const marisa::Trie &trie,
+                                      const marisa::Keyset &keyset) {
   Clock cl;
   if (param_reuse_on) {
     marisa::Agent agent;
@@ -252,12 +360,12 @@ void benchmark_common_prefix_search(const marisa::Trie &trie,
       while (trie.common_prefix_search(agent)) {
         if (agent.key().id() > keyset[i].id()) {
           std::cerr << "error: common_prefix_search() failed\n";
-          return;
+          return 0.0;
         }
       }
       if (agent.key().id() != keyset[i].id()) {
         std::cerr << "error: common_prefix_search() failed\n";
-        return;
+        return 0.0;
       }
     }
   } else {
@@ -267,23 +375,22 @@ void benchmark_common_prefix_search(const marisa::Trie &trie,
       while (trie.common_prefix_search(agent)) {
         if (agent.key().id() > keyset[i].id()) {
           std::cerr << "error: common_prefix_search() failed\n";
-          return;
+          return 0.0;
         }
       }
       if (agent.key().id() != keyset[i].id()) {
         std::cerr << "error: common_prefix_search() failed\n";
-        return;
+        return 0.0;
       }
     }
   }
-  print_time_info(keyset.size(), cl.elasped());
+  return cl.elasped();
 }
 
-void benchmark_predictive_search(const marisa::Trie &trie,
-                                 const marisa::Keyset &keyset) {
+double benchmark_predictive_search(const marisa::Trie &trie,
+                                   const marisa::Keyset &keyset) {
   if (!param_predict_on) {
-    print_time_info(keyset.size(), 0.0);
-    return;
+    return 0.0;
   }
 
   Clock cl;
@@ -294,12 +401,12 @@ void benchmark_predictive_search(const marisa::Trie &trie,
       if (!trie.predictive_search(agent) ||
           (agent.key().id() != keyset[i].id())) {
         std::cerr << "error: predictive_search() failed\n";
-        return;
+        return 0.0;
       }
       while (trie.predictive_search(agent)) {
         if (agent.key().id() <= keyset[i].id()) {
           std::cerr << "error: predictive_search() failed\n";
-          return;
+          return 0.0;
         }
       }
     }
@@ -310,31 +417,940 @@ void benchmark_predictive_search(const marisa::Trie &trie,
       if (!trie.predictive_search(agent) ||
           (agent.key().id() != keyset[i].id())) {
         std::cerr << "error: predictive_search() failed\n";
-        return;
+        return 0.0;
       }
       while (trie.predictive_search(agent)) {
         if (agent.key().id() <= keyset[i].id()) {
           std::cerr << "error: predictive_search() failed\n";
-          return;
+          return 0.0;
         }
       }
     }
   }
-  print_time_info(keyset.size(), cl.elasped());
+  return cl.elasped();
+}
+
+int read_query_log(const char *filename) {
+  const int ret = read_queries(filename, &queries);
+  if (ret != 0) {
+    return ret;
+  }
+  if (param_format == TEXT_FORMAT) {
+    std::cout << "Number of queries: " << queries.size() << "\n"
+              << std::flush;
+  }
+  return 0;
+}
+
+// WorkloadGenerator draws keys with Zipf's law over a shuffled key order,
+// so that popular keys do not cluster in the trie. The skew of 0.0 means a
+// uniform distribution. A miss is a key with a changed byte or a random
+// string, and so misses fail at various depths. If `longest_only' is true,
+// keys are drawn from the longest 1% of the keyset.
+class WorkloadGenerator {
+ public:
+  WorkloadGenerator(const marisa::Keyset &keyset, double skew,
+                    bool longest_only)
+      : keyset_(keyset), rng_(param_seed), order_(keyset.size()) {
+    for (std::size_t i = 0; i < order_.size(); ++i) {
+      order_[i] = i;
+    }
+    std::shuffle(order_.begin(), order_.end(), rng_);
+    if (longest_only) {
+      const std::size_t num_keys =
+          std::max<std::size_t>(order_.size() / 100, 1);
+      const auto is_longer = [&keyset](std::size_t lhs, std::size_t rhs) {
+        return keyset[lhs].length() > keyset[rhs].length();
+      };
+      std::partial_sort(order_.begin(), order_.begin() + num_keys,
+                        order_.end(), is_longer);
+      order_.resize(num_keys);
+      std::shuffle(order_.begin(), order_.end(), rng_);
+    }
+    if (skew != 0.0) {
+      std::vector<double> weights(order_.size());
+      for (std::size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = 1.0 / std::pow(static_cast<double>(i + 1), skew);
+      }
+      zipf_ = std::discrete_distribution<std::size_t>(weights.begin(),
+                                                      weights.end());
+    }
+  }
+
+  std::string key() {
+    const std::size_t rank =
+        (zipf_.probabilities().size() > 1)
+            ? zipf_(rng_)
+            : uniform(0, order_.size() - 1);
+    const marisa::Key &key = keyset_[order_[rank]];
+    return std::string(key.ptr(), key.length());
+  }
+
+  bool flip(double ratio) {
+    return std::bernoulli_distribution(ratio)(rng_);
+  }
+  std::size_t uniform(std::size_t min, std::size_t max) {
+    return std::uniform_int_distribution<std::size_t>(min, max)(rng_);
+  }
+
+  std::string miss(std::string str) {
+    if (str.empty() || flip(0.5)) {
+      return random_string(uniform(1, 16));
+    }
+    const std::size_t pos = uniform(0, str.length() - 1);
+    return change_byte(std::move(str), pos);
+  }
+
+  // '\n' is avoided to keep queries in the format of -q.
+  std::string change_byte(std::string str, std::size_t pos) {
+    char c;
+    do {
+      c = static_cast<char>(str[pos] ^ uniform(1, 255));
+    } while (c == '\n');
+    str[pos] = c;
+    return str;
+  }
+
+  std::string random_string(std::size_t length) {
+    std::string str(length, '\0');
+    for (char &c : str) {
+      c = static_cast<char>(uniform(0x20, 0x7E));
+    }
+    return str;
+  }
+
+ private:
+  const marisa::Keyset &keyset_;
+  std::mt19937 rng_;
+  std::vector<std::size_t> order_;
+  std::discrete_distribution<std::size_t> zipf_;
+};
+
+void generate_query(WorkloadGenerator &generator, Query *query) {
+  const bool is_miss = generator.flip(param_miss_ratio);
+  std::string key = generator.key();
+  switch (param_workload) {
+    case UNIFORM_WORKLOAD:
+    case ZIPF_WORKLOAD:
+    case MISS_WORKLOAD: {
+      query->type = LOOKUP_QUERY;
+      query->str = is_miss ? generator.miss(std::move(key)) : std::move(key);
+      break;
+    }
+    case PREFIX_WORKLOAD: {
+      // Short prefixes enumerate many keys, and long queries walk deep.
+      if (generator.flip(0.5)) {
+        query->type = PREDICTIVE_SEARCH_QUERY;
+        if (!key.empty()) {
+          key.resize(generator.uniform(1, key.length()));
+        }
+        query->str = is_miss ? generator.miss(std::move(key)) : std::move(key);
+      } else {
+        query->type = COMMON_PREFIX_SEARCH_QUERY;
+        query->str = is_miss ? generator.miss(std::move(key)) : std::move(key);
+        query->str += generator.random_string(generator.uniform(0, 16));
+      }
+      break;
+    }
+    case LONG_KEY_WORKLOAD: {
+      // A long query is one of the longest keys, and a miss changes its last
+      // byte, so that it walks the whole tail before it fails.
+      query->type = (generator.flip(0.5)) ? LOOKUP_QUERY
+                                          : COMMON_PREFIX_SEARCH_QUERY;
+      if (is_miss && !key.empty()) {
+        const std::size_t pos = key.length() - 1;
+        query->str = generator.change_byte(std::move(key), pos);
+      } else {
+        query->str = std::move(key);
+      }
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+int generate_queries(const marisa::Keyset &keyset) {
+  if (keyset.empty()) {
+    std::cerr << "error: no keys to generate queries\n";
+    return 15;
+  }
+  WorkloadGenerator generator(keyset, param_skew,
+                              param_workload == LONG_KEY_WORKLOAD);
+  queries.resize(param_num_queries);
+  for (Query &query : queries) {
+    query.id = 0;
+    generate_query(generator, &query);
+  }
+  if (param_format == TEXT_FORMAT) {
+    std::cout << "Workload: " << WORKLOAD_NAMES[param_workload]
+              << " (skew: " << param_skew
+              << ", miss ratio: " << param_miss_ratio
+              << ", seed: " << param_seed << ")\n";
+    std::cout << "Number of queries: " << queries.size() << "\n"
+              << std::flush;
+  }
+  return 0;
+}
+
+// write_queries() writes queries in the format of -q. Every line has the
+// name of its query type because a key may contain a tab.
+int write_queries(const char *filename) {
+  std::ofstream output_file(filename, std::ios::binary);
+  if (!output_file) {
+    std::cerr << "error: failed to open: " << filename << "\n";
+    return 16;
+  }
+  for (const Query &query : queries) {
+    output_file << QUERY_TYPE_NAMES[query.type] << '\t';
+    if (query.type == REVERSE_LOOKUP_QUERY) {
+      output_file << query.id << '\n';
+    } else {
+      output_file << query.str << '\n';
+    }
+  }
+  if (!output_file.flush()) {
+    std::cerr << "error: failed to write: " << filename << "\n";
+    return 17;
+  }
+  return 0;
+}
+
+void benchmark_queries(const marisa::Trie &trie, Result *result) {
+  marisa::Agent agent;
+  for (const Query &query : queries) {
+    const auto begin = std::chrono::steady_clock::now();
+    bool found;
+    if (param_reuse_on) {
+      found = replay(trie, query, agent);
+    } else {
+      marisa::Agent temp_agent;
+      found = replay(trie, query, temp_agent);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    result->latencies[query.type].push_back(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+            .count()));
+    if (!found) {
+      ++result->num_misses[query.type];
+    }
+  }
+}
+
+// add_sample() adds the time per key, and ignores `elasped' of 0.0, which
+// means that the operation is skipped or failed.
+void add_sample(std::vector<double> *samples, std::size_t num_keys,
+                double elasped) {
+  if ((elasped != 0.0) && (num_keys != 0)) {
+    samples->push_back(1000000000.0 * elasped / static_cast<double>(num_keys));
+  }
+}
+
+double mean(const std::vector<double> &samples) {
+  double total = 0.0;
+  for (const double sample : samples) {
+    total += sample;
+  }
+  return samples.empty() ? 0.0 : (total / static_cast<double>(samples.size()));
+}
+
+double median(std::vector<double> samples) {
+  if (samples.empty()) {
+    return 0.0;
+  }
+  std::sort(samples.begin(), samples.end());
+  const std::size_t mid = samples.size() / 2;
+  return ((samples.size() % 2) == 1)
+             ? samples[mid]
+             : ((samples[mid - 1] + samples[mid]) / 2.0);
+}
+
+double variance(const std::vector<double> &samples) {
+  if (samples.size() < 2) {
+    return 0.0;
+  }
+  const double avg = mean(samples);
+  double total = 0.0;
+  for (const double sample : samples) {
+    total += (sample - avg) * (sample - avg);
+  }
+  return total / static_cast<double>(samples.size() - 1);
+}
+
+// percentile() returns the nearest-rank percentile of sorted latencies,
+// i.e. the ceil(p * n / 100)-th smallest one.
+uint64_t percentile(const std::vector<uint64_t> &latencies, double p) {
+  const double rank =
+      std::ceil(p * static_cast<double>(latencies.size()) / 100.0);
+  if (rank <= 1.0) {
+    return latencies.front();
+  }
+  if (rank >= static_cast<double>(latencies.size())) {
+    return latencies.back();
+  }
+  return latencies[static_cast<std::size_t>(rank) - 1];
+}
+
+struct LatencyStats {
+  std::size_t count;
+  double miss_rate;
+  double mean;
+  uint64_t percentiles[4];
+};
+
+const double PERCENTILES[4] = {50.0, 90.0, 99.0, 99.9};
+const char *const PERCENTILE_NAMES[4] = {"p50", "p90", "p99", "p99.9"};
+
+LatencyStats get_latency_stats(std::vector<uint64_t> latencies,
+                               std::size_t num_misses) {
+  LatencyStats stats = {latencies.size(), 0.0, 0.0, {}};
+  if (latencies.empty()) {
+    return stats;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  uint64_t total = 0;
+  for (const uint64_t latency : latencies) {
+    total += latency;
+  }
+  stats.miss_rate =
+      static_cast<double>(num_misses) / static_cast<double>(latencies.size());
+  stats.mean =
+      static_cast<double>(total) / static_cast<double>(latencies.size());
+  for (int i = 0; i < 4; ++i) {
+    stats.percentiles[i] = percentile(latencies, PERCENTILES[i]);
+  }
+  return stats;
+}
+
+// get_replay_stats() returns the stats of each query type, followed by the
+// stats of all the queries.
+std::vector<LatencyStats> get_replay_stats(const Result &result) {
+  std::vector<LatencyStats> stats;
+  std::vector<uint64_t> all_latencies;
+  std::size_t all_misses = 0;
+  for (int i = 0; i < NUM_QUERY_TYPES; ++i) {
+    all_latencies.insert(all_latencies.end(), result.latencies[i].begin(),
+                         result.latencies[i].end());
+    all_misses += result.num_misses[i];
+    stats.push_back(
+        get_latency_stats(result.latencies[i], result.num_misses[i]));
+  }
+  stats.push_back(get_latency_stats(all_latencies, all_misses));
+  return stats;
+}
+
+const char *get_query_type_name(std::size_t i) {
+  return (i < NUM_QUERY_TYPES) ? QUERY_TYPE_NAMES[i] : "all";
+}
+
+const char *get_tail_mode_name() {
+  return (param_tail_mode == MARISA_BINARY_TAIL) ? "binary" : "text";
+}
+
+const char *get_node_order_name() {
+  return (param_node_order == MARISA_LABEL_ORDER) ? "label" : "weight";
+}
+
+const char *get_cache_level_name() {
+  switch (param_cache_level) {
+    case MARISA_HUGE_CACHE: {
+      return "huge";
+    }
+    case MARISA_LARGE_CACHE: {
+      return "large";
+    }
+    case MARISA_SMALL_CACHE: {
+      return "small";
+    }
+    case MARISA_TINY_CACHE: {
+      return "tiny";
+    }
+    default: {
+      return "normal";
+    }
+  }
+}
+
+// A row shows the median time of each operation over runs.
+void print_result(const Result &result) {
+  std::printf("%6d", result.num_tries);
+  std::printf(" %10lu", static_cast<unsigned long>(result.size));
+  for (int i = 0; i < NUM_OPERATIONS; ++i) {
+    print_time_info(median(result.samples[i]));
+  }
+  std::printf("\n");
+}
+
+void print_replay_results() {
+  std::printf(
+      "------+--------+----------+--------+--------+--------+--------+--------"
+      "+--------\n");
+  std::printf("%6s %-8s %10s %8s %8s %8s %8s %8s %8s\n", "#tries", "query",
+              "count", "miss", "average", "p50", "p90", "p99", "p99.9");
+  std::printf("%6s %-8s %10s %8s %8s %8s %8s %8s %8s\n", "", "", "", "[%]",
+              param_print_speed ? "[K/s]" : "[ns]", "[ns]", "[ns]", "[ns]",
+              "[ns]");
+  std::printf(
+      "------+--------+----------+--------+--------+--------+--------+--------"
+      "+--------\n");
+  for (const Result &result : results) {
+    const std::vector<LatencyStats> stats = get_replay_stats(result);
+    for (std::size_t i = 0; i < stats.size(); ++i) {
+      if (stats[i].count == 0) {
+        continue;
+      }
+      std::printf("%6d %-8s %10lu %8.2f", result.num_tries,
+                  get_query_type_name(i),
+                  static_cast<unsigned long>(stats[i].count),
+                  100.0 * stats[i].miss_rate);
+      print_time_info(stats[i].mean);
+      for (const uint64_t latency : stats[i].percentiles) {
+        std::printf(" %8lu", static_cast<unsigned long>(latency));
+      }
+      std::printf("\n");
+    }
+  }
+  std::printf(
+      "------+--------+----------+--------+--------+--------+--------+--------"
+      "+--------\n");
+}
+
+// Names and strings are printed without escaping because they are all
+// constants of this tool.
+void print_json(const marisa::Keyset &keyset) {
+  std::printf("{\n");
+  std::printf("  \"config\": {\n");
+  std::printf("    \"min_num_tries\": %d,\n", param_min_num_tries);
+  std::printf("    \"max_num_tries\": %d,\n", param_max_num_tries);
+  std::printf("    \"tail_mode\": \"%s\",\n", get_tail_mode_name());
+  std::printf("    \"node_order\": \"%s\",\n", get_node_order_name());
+  std::printf("    \"cache_level\": \"%s\",\n", get_cache_level_name());
+  std::printf("    \"predict\": %s,\n", param_predict_on ? "true" : "false");
+  std::printf("    \"reuse\": %s,\n", param_reuse_on ? "true" : "false");
+  std::printf("    \"num_runs\": %d\n", param_num_runs);
+  std::printf("  },\n");
+  std::printf("  \"num_keys\": %lu,\n",
+              static_cast<unsigned long>(keyset.size()));
+  std::printf("  \"total_length\": %lu,\n",
+              static_cast<unsigned long>(keyset.total_length()));
+  std::printf("  \"num_queries\": %lu,\n",
+              static_cast<unsigned long>(queries.size()));
+  std::printf("  \"results\": [");
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const Result &result = results[i];
+    std::printf("%s\n    {\n", (i == 0) ? "" : ",");
+    std::printf("      \"num_tries\": %d,\n", result.num_tries);
+    std::printf("      \"size\": %lu,\n",
+                static_cast<unsigned long>(result.size));
+    std::printf("      \"operations\": {");
+    for (int j = 0; j < NUM_OPERATIONS; ++j) {
+      const std::vector<double> &samples = result.samples[j];
+      std::printf("%s\n        \"%s\": {\"ns_per_key\": [", (j == 0) ? "" : ",",
+                  OPERATION_NAMES[j]);
+      for (std::size_t k = 0; k < samples.size(); ++k) {
+        std::printf("%s%.3f", (k == 0) ? "" : ", ", samples[k]);
+      }
+      std::printf("], \"mean\": %.3f, \"median\": %.3f, \"stddev\": %.3f}",
+                  mean(samples), median(samples),
+                  std::sqrt(variance(samples)));
+    }
+    std::printf("\n      },\n");
+    std::printf("      \"queries\": {");
+    const std::vector<LatencyStats> stats = get_replay_stats(result);
+    bool is_first = true;
+    for (std::size_t j = 0; j < stats.size(); ++j) {
+      if (stats[j].count == 0) {
+        continue;
+      }
+      std::printf("%s\n        \"%s\": {\"count\": %lu, \"miss_rate\": %.6f, "
+                  "\"mean_ns\": %.3f",
+                  is_first ? "" : ",", get_query_type_name(j),
+                  static_cast<unsigned long>(stats[j].count),
+                  stats[j].miss_rate, stats[j].mean);
+      for (int k = 0; k < 4; ++k) {
+        std::printf(", \"%s_ns\": %lu", PERCENTILE_NAMES[k],
+                    static_cast<unsigned long>(stats[j].percentiles[k]));
+      }
+      std::printf("}");
+      is_first = false;
+    }
+    std::printf("%s}\n    }", is_first ? "" : "\n      ");
+  }
+  std::printf("%s]\n}\n", results.empty() ? "" : "\n  ");
+}
+
+// A CSV row has the configuration, the size and the stats of an operation
+// or a query type. Columns which do not apply to a row are left empty.
+void print_csv() {
+  std::printf(
+      "num_tries,tail_mode,node_order,cache_level,size,operation,num_runs,"
+      "mean_ns,median_ns,stddev_ns,count,miss_rate,p50_ns,p90_ns,p99_ns,"
+      "p99.9_ns\n");
+  for (const Result &result : results) {
+    for (int i = 0; i < NUM_OPERATIONS; ++i) {
+      const std::vector<double> &samples = result.samples[i];
+      std::printf("%d,%s,%s,%s,%lu,%s,%lu,%.3f,%.3f,%.3f,,,,,,\n",
+                  result.num_tries, get_tail_mode_name(),
+                  get_node_order_name(), get_cache_level_name(),
+                  static_cast<unsigned long>(result.size), OPERATION_NAMES[i],
+                  static_cast<unsigned long>(samples.size()), mean(samples),
+                  median(samples), std::sqrt(variance(samples)));
+    }
+    const std::vector<LatencyStats> stats = get_replay_stats(result);
+    for (std::size_t i = 0; i < stats.size(); ++i) {
+      if (stats[i].count == 0) {
+        continue;
+      }
+      std::printf("%d,%s,%s,%s,%lu,query:%s,1,%.3f,,,%lu,%.6f",
+                  result.num_tries, get_tail_mode_name(),
+                  get_node_order_name(), get_cache_level_name(),
+                  static_cast<unsigned long>(result.size),
+                  get_query_type_name(i), stats[i].mean,
+                  static_cast<unsigned long>(stats[i].count),
+                  stats[i].miss_rate);
+      for (const uint64_t latency : stats[i].percentiles) {
+        std::printf(",%lu", static_cast<unsigned long>(latency));
+      }
+      std::printf("\n");
+    }
+  }
+}
+
+// JsonValue is a minimal JSON value to read a baseline written by this tool.
+// Members of an object are kept in `keys' and `elements'.
+struct JsonValue {
+  enum Type {
+    NULL_TYPE,
+    BOOLEAN_TYPE,
+    NUMBER_TYPE,
+    STRING_TYPE,
+    ARRAY_TYPE,
+    OBJECT_TYPE
+  };
+
+  Type type = NULL_TYPE;
+  double number = 0.0;
+  std::string str;
+  std::vector<std::string> keys;
+  std::vector<JsonValue> elements;
+
+  const JsonValue *find(const char *key) const {
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      if (keys[i] == key) {
+        return &elements[i];
+      }
+    }
+    return nullptr;
+  }
+};
+
+class JsonParser {
+ public:
+  explicit JsonParser(const std::string &str)
+      : ptr_(str.c_str()), end_(str.c_str() + str.length()) {}
+
+  bool parse(JsonValue *value) {
+    if (!parse_value(value)) {
+      return false;
+    }
+    skip_spaces();
+    return ptr_ == end_;
+  }
+
+ private:
+  const char *ptr_;
+  const char *end_;
+
+  void skip_spaces() {
+    while ((ptr_ != end_) && std::isspace(static_cast<unsigned char>(*ptr_))) {
+      ++ptr_;
+    }
+  }
+
+  bool parse_literal(const char *literal) {
+    const std::size_t length = std::strlen(literal);
+    if ((static_cast<std::size_t>(end_ - ptr_) < length) ||
+        (std::memcmp(ptr_, literal, length) != 0)) {
+      return false;
+    }
+    ptr_ += length;
+    return true;
+  }
+
+  // \uXXXX is replaced with `?' because this tool writes ASCII only.
+  bool parse_string(std::string *str) {
+    if ((ptr_ == end_) || (*ptr_ != '"')) {
+      return false;
+    }
+    ++ptr_;
+    while ((ptr_ != end_) && (*ptr_ != '"')) {
+      if (*ptr_ == '\\') {
+        if (++ptr_ == end_) {
+          return false;
+        }
+        switch (*ptr_) {
+          case 'n': {
+            str->push_back('\n');
+            break;
+          }
+          case 't': {
+            str->push_back('\t');
+            break;
+          }
+          case 'u': {
+            if ((end_ - ptr_) < 5) {
+              return false;
+            }
+            ptr_ += 4;
+            str->push_back('?');
+            break;
+          }
+          default: {
+            str->push_back(*ptr_);
+            break;
+          }
+        }
+      } else {
+        str->push_back(*ptr_);
+      }
+      ++ptr_;
+    }
+    if (ptr_ == end_) {
+      return false;
+    }
+    ++ptr_;
+    return true;
+  }
+
+  bool parse_value(JsonValue *value) {
+    skip_spaces();
+    if (ptr_ == end_) {
+      return false;
+    }
+    switch (*ptr_) {
+      case '{': {
+        value->type = JsonValue::OBJECT_TYPE;
+        ++ptr_;
+        skip_spaces();
+        if ((ptr_ != end_) && (*ptr_ == '}')) {
+          ++ptr_;
+          return true;
+        }
+        for (;;) {
+          std::string key;
+          skip_spaces();
+          if (!parse_string(&key)) {
+            return false;
+          }
+          skip_spaces();
+          if ((ptr_ == end_) || (*ptr_ != ':')) {
+            return false;
+          }
+          ++ptr_;
+          value->keys.push_back(std::move(key));
+          value->elements.emplace_back();
+          if (!parse_value(&value->elements.back())) {
+            return false;
+          }
+          skip_spaces();
+          if ((ptr_ != end_) && (*ptr_ == ',')) {
+            ++ptr_;
+          } else if ((ptr_ != end_) && (*ptr_ == '}')) {
+            ++ptr_;
+            return true;
+          } else {
+            return false;
+          }
+        }
+      }
+      case '[': {
+        value->type = JsonValue::ARRAY_TYPE;
+        ++ptr_;
+        skip_spaces();
+        if ((ptr_ != end_) && (*ptr_ == ']')) {
+          ++ptr_;
+          return true;
+        }
+        for (;;) {
+          value->elements.emplace_back();
+          if (!parse_value(&value->elements.back())) {
+            return false;
+          }
+          skip_spaces();
+          if ((ptr_ != end_) && (*ptr_ == ',')) {
+            ++ptr_;
+          } else if ((ptr_ != end_) && (*ptr_ == ']')) {
+            ++ptr_;
+            return true;
+          } else {
+            return false;
+          }
+        }
+      }
+      case '"': {
+        value->type = JsonValue::STRING_TYPE;
+        return parse_string(&value->str);
+      }
+      case 't': {
+        value->type = JsonValue::BOOLEAN_TYPE;
+        value->number = 1.0;
+        return parse_literal("true");
+      }
+      case 'f': {
+        value->type = JsonValue::BOOLEAN_TYPE;
+        return parse_literal("false");
+      }
+      case 'n': {
+        return parse_literal("null");
+      }
+      default: {
+        // The input is terminated by '\0', so strtod() stops in it.
+        char *end_of_value;
+        value->type = JsonValue::NUMBER_TYPE;
+        value->number = std::strtod(ptr_, &end_of_value);
+        if (end_of_value == ptr_) {
+          return false;
+        }
+        ptr_ = end_of_value;
+        return true;
+      }
+    }
+  }
+};
+
+// t_critical_value() returns the critical value of one-sided t-test at the
+// 5% significance level for `df' degrees of freedom.
+double t_critical_value(double df) {
+  static const double TABLE[30] = {
+      6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860, 1.833, 1.812,
+      1.796, 1.782, 1.771, 1.761, 1.753, 1.746, 1.740, 1.734, 1.729, 1.725,
+      1.721, 1.717, 1.714, 1.711, 1.708, 1.706, 1.703, 1.701, 1.699, 1.697};
+  if (df < 1.0) {
+    return TABLE[0];
+  }
+  if (df > 30.0) {
+    return 1.645;
+  }
+  return TABLE[static_cast<std::size_t>(df) - 1];
+}
+
+// is_significant() tests whether the mean of `lhs' is greater than that of
+// `rhs' by Welch's t-test.
+bool is_significant(const std::vector<double> &lhs,
+                    const std::vector<double> &rhs) {
+  const double lhs_var = variance(lhs) / static_cast<double>(lhs.size());
+  const double rhs_var = variance(rhs) / static_cast<double>(rhs.size());
+  const double diff = mean(lhs) - mean(rhs);
+  if ((lhs_var + rhs_var) == 0.0) {
+    return diff > 0.0;
+  }
+  const double t = diff / std::sqrt(lhs_var + rhs_var);
+  const double df =
+      ((lhs_var + rhs_var) * (lhs_var + rhs_var)) /
+      ((lhs_var * lhs_var / static_cast<double>(lhs.size() - 1)) +
+       (rhs_var * rhs_var / static_cast<double>(rhs.size() - 1)));
+  return t > t_critical_value(df);
+}
+
+// get_change() returns the change from `base' to `current' in percent. A
+// change from 0 is reported as 0 rather than a division by 0.
+double get_change(double base, double current) {
+  return (base == 0.0) ? 0.0 : (100.0 * (current - base) / base);
+}
+
+// compare() prints the differences from the baseline, and returns the number
+// of regressions. A time is a regression if it is slower by more than the
+// threshold and the difference is significant. Both need two or more runs.
+// A latency percentile is a single value pooled over the runs, so it is a
+// regression if it is slower by more than the threshold.
+int compare(const JsonValue &baseline, std::ostream &out) {
+  const JsonValue *config = baseline.find("config");
+  if (config != nullptr) {
+    const std::pair<const char *, const char *> params[] = {
+        {"tail_mode", get_tail_mode_name()},
+        {"node_order", get_node_order_name()},
+        {"cache_level", get_cache_level_name()}};
+    for (const auto &param : params) {
+      const JsonValue *value = config->find(param.first);
+      if ((value != nullptr) && (value->str != param.second)) {
+        out << "warning: " << param.first << " differs from the baseline: "
+            << value->str << " vs " << param.second << "\n";
+      }
+    }
+  }
+
+  const JsonValue *baseline_results = baseline.find("results");
+  if ((baseline_results == nullptr) ||
+      (baseline_results->type != JsonValue::ARRAY_TYPE)) {
+    throw std::runtime_error("no results in the baseline");
+  }
+
+  const double ratio = 1.0 + (param_threshold / 100.0);
+  int num_regressions = 0;
+  char line[128];
+  std::snprintf(line, sizeof(line), "%6s %-22s %12s %12s %8s  %s\n", "#tries",
+                "operation", "baseline", "current", "change", "verdict");
+  out << line;
+  for (const Result &result : results) {
+    const JsonValue *base = nullptr;
+    for (const JsonValue &element : baseline_results->elements) {
+      const JsonValue *num_tries = element.find("num_tries");
+      if ((num_tries != nullptr) &&
+          (static_cast<int>(num_tries->number) == result.num_tries)) {
+        base = &element;
+      }
+    }
+    if (base == nullptr) {
+      continue;
+    }
+
+    const JsonValue *size = base->find("size");
+    if (size != nullptr) {
+      const double base_size = size->number;
+      const double cur_size = static_cast<double>(result.size);
+      const bool is_regression = cur_size > (base_size * ratio);
+      num_regressions += is_regression ? 1 : 0;
+      std::snprintf(line, sizeof(line),
+                    "%6d %-22s %12.0f %12.0f %+7.2f%%  %s\n", result.num_tries,
+                    "size", base_size, cur_size,
+                    get_change(base_size, cur_size),
+                    is_regression ? "REGRESSION" : "ok");
+      out << line;
+    }
+
+    const JsonValue *operations = base->find("operations");
+    for (int i = 0; i < NUM_OPERATIONS; ++i) {
+      const JsonValue *operation =
+          (operations != nullptr) ? operations->find(OPERATION_NAMES[i])
+                                  : nullptr;
+      const JsonValue *ns_per_key =
+          (operation != nullptr) ? operation->find("ns_per_key") : nullptr;
+      if (ns_per_key == nullptr) {
+        continue;
+      }
+      std::vector<double> base_samples;
+      for (const JsonValue &element : ns_per_key->elements) {
+        base_samples.push_back(element.number);
+      }
+      const std::vector<double> &cur_samples = result.samples[i];
+      if (base_samples.empty() || cur_samples.empty()) {
+        continue;
+      }
+
+      const double base_mean = mean(base_samples);
+      const double cur_mean = mean(cur_samples);
+      const char *verdict = "ok";
+      if ((base_samples.size() < 2) || (cur_samples.size() < 2)) {
+        verdict = "too few runs";
+      } else if ((cur_mean > (base_mean * ratio)) &&
+                 is_significant(cur_samples, base_samples)) {
+        verdict = "REGRESSION";
+        ++num_regressions;
+      } else if ((base_mean > (cur_mean * ratio)) &&
+                 is_significant(base_samples, cur_samples)) {
+        verdict = "improvement";
+      }
+      std::snprintf(line, sizeof(line),
+                    "%6d %-22s %12.1f %12.1f %+7.2f%%  %s\n", result.num_tries,
+                    OPERATION_NAMES[i], base_mean, cur_mean,
+                    get_change(base_mean, cur_mean), verdict);
+      out << line;
+    }
+
+    const JsonValue *base_queries = base->find("queries");
+    const std::vector<LatencyStats> stats = get_replay_stats(result);
+    for (std::size_t i = 0; i < stats.size(); ++i) {
+      const JsonValue *base_query =
+          (base_queries != nullptr) ? base_queries->find(get_query_type_name(i))
+                                    : nullptr;
+      if ((base_query == nullptr) || (stats[i].count == 0)) {
+        continue;
+      }
+      for (int j = 0; j < 4; ++j) {
+        const std::string key = std::string(PERCENTILE_NAMES[j]) + "_ns";
+        const JsonValue *value = base_query->find(key.c_str());
+        if (value == nullptr) {
+          continue;
+        }
+        const double base_latency = value->number;
+        const double cur_latency =
+            static_cast<double>(stats[i].percentiles[j]);
+        const char *verdict = "ok";
+        if (cur_latency > (base_latency * ratio)) {
+          verdict = "REGRESSION";
+          ++num_regressions;
+        } else if (base_latency > (cur_latency * ratio)) {
+          verdict = "improvement";
+        }
+        const std::string name =
+            std::string(get_query_type_name(i)) + " " + PERCENTILE_NAMES[j];
+        std::snprintf(line, sizeof(line),
+                      "%6d %-22s %12.1f %12.1f %+7.2f%%  %s\n",
+                      result.num_tries, name.c_str(), base_latency,
+                      cur_latency, get_change(base_latency, cur_latency),
+                      verdict);
+        out << line;
+      }
+    }
+  }
+  return num_regressions;
+}
+
+int compare(const char *filename) {
+  std::ifstream input_file(filename, std::ios::binary);
+  if (!input_file) {
+    std::cerr << "error: failed to open: " << filename << "\n";
+    return 13;
+  }
+  std::ostringstream stream;
+  stream << input_file.rdbuf();
+  const std::string str = stream.str();
+
+  JsonValue baseline;
+  if (!JsonParser(str).parse(&baseline)) {
+    std::cerr << "error: failed to parse: " << filename << "\n";
+    return 14;
+  }
+
+  // The comparison goes to stderr unless stdout is for humans.
+  std::ostream &out = (param_format == TEXT_FORMAT) ? std::cout : std::cerr;
+  std::fflush(stdout);
+  out << "Baseline: " << filename << " (threshold: " << param_threshold
+      << "%)\n";
+  const int num_regressions = compare(baseline, out);
+  out << "Number of regressions: " << num_regressions << "\n" << std::flush;
+  return (num_regressions != 0) ? 20 : 0;
 }
 
 void benchmark(marisa::Keyset &keyset, const std::vector<float> &weights,
                int num_tries) {
-  std::printf("%6d", num_tries);
-  marisa::Trie trie;
-  benchmark_build(keyset, weights, num_tries, &trie);
-  if (!trie.empty()) {
-    benchmark_lookup(trie, keyset);
-    benchmark_reverse_lookup(trie, keyset);
-    benchmark_common_prefix_search(trie, keyset);
-    benchmark_predictive_search(trie, keyset);
+  Result result = {num_tries, 0, {}, {}, {}};
+  for (int i = 0; i < param_num_runs; ++i) {
+    marisa::Trie trie;
+    add_sample(&result.samples[BUILD_OPERATION], keyset.size(),
+               benchmark_build(keyset, weights, num_tries, &trie));
+    result.size = trie.io_size();
+    if (trie.empty()) {
+      continue;
+    }
+    add_sample(&result.samples[LOOKUP_OPERATION], keyset.size(),
+               benchmark_lookup(trie, keyset));
+    add_sample(&result.samples[REVERSE_LOOKUP_OPERATION], keyset.size(),
+               benchmark_reverse_lookup(trie, keyset));
+    add_sample(&result.samples[COMMON_PREFIX_SEARCH_OPERATION], keyset.size(),
+               benchmark_common_prefix_search(trie, keyset));
+    add_sample(&result.samples[PREDICTIVE_SEARCH_OPERATION], keyset.size(),
+               benchmark_predictive_search(trie, keyset));
+    if (!queries.empty()) {
+      benchmark_queries(trie, &result);
+    }
   }
-  std::printf("\n");
+  if (param_format == TEXT_FORMAT) {
+    print_result(result);
+    std::fflush(stdout);
+  }
+  results.push_back(std::move(result));
 }
 
 int benchmark(const char *const *args, std::size_t num_args) try {
@@ -344,26 +1360,64 @@ int benchmark(const char *const *args, std::size_t num_args) try {
   if (ret != 0) {
     return ret;
   }
-  std::printf(
-      "------+----------+--------+--------+--------+--------+--------\n");
-  std::printf("%6s %10s %8s %8s %8s %8s %8s\n", "#tries", "size", "build",
-              "lookup", "reverse", "prefix", "predict");
-  std::printf("%6s %10s %8s %8s %8s %8s %8s\n", "", "", "", "", "lookup",
-              "search", "search");
-  if (param_print_speed) {
-    std::printf("%6s %10s %8s %8s %8s %8s %8s\n", "", "[bytes]", "[K/s]",
-                "[K/s]", "[K/s]", "[K/s]", "[K/s]");
-  } else {
-    std::printf("%6s %10s %8s %8s %8s %8s %8s\n", "", "[bytes]", "[ns]", "[ns]",
-                "[ns]", "[ns]", "[ns]");
+  if (param_queries != nullptr) {
+    const int query_ret = read_query_log(param_queries);
+    if (query_ret != 0) {
+      return query_ret;
+    }
+  } else if (param_workload != NO_WORKLOAD) {
+    const int query_ret = generate_queries(keyset);
+    if (query_ret != 0) {
+      return query_ret;
+    }
+  }
+  if (param_write_queries != nullptr) {
+    const int query_ret = write_queries(param_write_queries);
+    if (query_ret != 0) {
+      return query_ret;
+    }
+  }
+  if (param_format == TEXT_FORMAT) {
+    std::printf(
+        "------+----------+--------+--------+--------+--------+--------\n");
+    std::printf("%6s %10s %8s %8s %8s %8s %8s\n", "#tries", "size", "build",
+                "lookup", "reverse", "prefix", "predict");
+    std::printf("%6s %10s %8s %8s %8s %8s %8s\n", "", "", "", "", "lookup",
+                "search", "search");
+    if (param_print_speed) {
+      std::printf("%6s %10s %8s %8s %8s %8s %8s\n", "", "[bytes]", "[K/s]",
+                  "[K/s]", "[K/s]", "[K/s]", "[K/s]");
+    } else {
+      std::printf("%6s %10s %8s %8s %8s %8s %8s\n", "", "[bytes]", "[ns]",
+                  "[ns]", "[ns]", "[ns]", "[ns]");
+    }
+    std::printf(
+        "------+----------+--------+--------+--------+--------+--------\n");
   }
-  std::printf(
-      "------+----------+--------+--------+--------+--------+--------\n");
   for (int i = param_min_num_tries; i <= param_max_num_tries; ++i) {
     benchmark(keyset, weights, i);
   }
-  std::printf(
-      "------+----------+--------+--------+--------+--------+--------\n");
+  switch (param_format) {
+    case TEXT_FORMAT: {
+      std::printf(
+          "------+----------+--------+--------+--------+--------+--------\n");
+      if (!queries.empty()) {
+        print_replay_results();
+      }
+      break;
+    }
+    case JSON_FORMAT: {
+      print_json(keyset);
+      break;
+    }
+    case CSV_FORMAT: {
+      print_csv();
+      break;
+    }
+  }
+  if (param_compare != nullptr) {
+    return compare(param_compare);
+  }
   return 0;
 } catch (const std::exception &ex) {
   std::cerr << ex.what() << "\n";
@@ -388,10 +1442,22 @@ int main(int argc, char *argv[]) {
                                     {"reuse-off", 0, nullptr, 'r'},
                                     {"print-speed", 0, nullptr, 'S'},
                                     {"print-time", 0, nullptr, 's'},
+                                    {"queries", 1, nullptr, 'q'},
+                                    {"num-runs", 1, nullptr, 'x'},
+                                    {"format", 1, nullptr, 'f'},
+                                    {"compare", 1, nullptr, 'C'},
+                                    {"threshold", 1, nullptr, 'T'},
+                                    {"generate", 1, nullptr, 'G'},
+                                    {"num-queries", 1, nullptr, 'Q'},
+                                    {"skew", 1, nullptr, 'Z'},
+                                    {"miss-ratio", 1, nullptr, 'M'},
+                                    {"seed", 1, nullptr, 'e'},
+                                    {"write-queries", 1, nullptr, 'W'},
                                     {"help", 0, nullptr, 'h'},
                                     {nullptr, 0, nullptr, 0}};
   ::cmdopt_t cmdopt;
-  ::cmdopt_init(&cmdopt, argc, argv, "N:n:tbwlc:PpRrSsh", long_options);
+  ::cmdopt_init(&cmdopt, argc, argv, "N:n:tbwlc:PpRrSsq:x:f:C:T:G:Q:Z:M:e:W:h",
+                long_options);
   int label;
   while ((label = ::cmdopt_get(&cmdopt)) != -1) {
     switch (label) {
@@ -480,6 +1546,114 @@ int main(int argc, char *argv[]) {
         param_print_speed = false;
         break;
       }
+      case 'q': {
+        param_queries = cmdopt.optarg;
+        break;
+      }
+      case 'x': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value <= 0) || (value > 1000)) {
+          std::cerr << "error: option `-x' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 4;
+        }
+        param_num_runs = static_cast<int>(value);
+        break;
+      }
+      case 'f': {
+        if (std::strcmp(cmdopt.optarg, "text") == 0) {
+          param_format = TEXT_FORMAT;
+        } else if (std::strcmp(cmdopt.optarg, "json") == 0) {
+          param_format = JSON_FORMAT;
+        } else if (std::strcmp(cmdopt.optarg, "csv") == 0) {
+          param_format = CSV_FORMAT;
+        } else {
+          std::cerr << "error: option `-f' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 5;
+        }
+        break;
+      }
+      case 'C': {
+        param_compare = cmdopt.optarg;
+        break;
+      }
+      case 'T': {
+        char *end_of_value;
+        const double value = std::strtod(cmdopt.optarg, &end_of_value);
+        if ((*end_of_value != '\0') || !(value >= 0.0)) {
+          std::cerr << "error: option `-T' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 6;
+        }
+        param_threshold = value;
+        break;
+      }
+      case 'G': {
+        param_workload = NO_WORKLOAD;
+        for (int i = UNIFORM_WORKLOAD; i < NUM_WORKLOADS; ++i) {
+          if (std::strcmp(cmdopt.optarg, WORKLOAD_NAMES[i]) == 0) {
+            param_workload = static_cast<Workload>(i);
+          }
+        }
+        if (param_workload == NO_WORKLOAD) {
+          std::cerr << "error: option `-G' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 7;
+        }
+        break;
+      }
+      case 'Q': {
+        char *end_of_value;
+        const unsigned long long value =
+            std::strtoull(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value == 0) || (value > SIZE_MAX)) {
+          std::cerr << "error: option `-Q' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 8;
+        }
+        param_num_queries = static_cast<std::size_t>(value);
+        break;
+      }
+      case 'Z': {
+        char *end_of_value;
+        const double value = std::strtod(cmdopt.optarg, &end_of_value);
+        if ((*end_of_value != '\0') || !(value >= 0.0) || (value > 10.0)) {
+          std::cerr << "error: option `-Z' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 9;
+        }
+        param_skew = value;
+        break;
+      }
+      case 'M': {
+        char *end_of_value;
+        const double value = std::strtod(cmdopt.optarg, &end_of_value);
+        if ((*end_of_value != '\0') || !(value >= 0.0) || (value > 1.0)) {
+          std::cerr << "error: option `-M' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 10;
+        }
+        param_miss_ratio = value;
+        break;
+      }
+      case 'e': {
+        char *end_of_value;
+        const unsigned long value =
+            std::strtoul(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value > UINT32_MAX)) {
+          std::cerr << "error: option `-e' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 11;
+        }
+        param_seed = static_cast<uint32_t>(value);
+        break;
+      }
+      case 'W': {
+        param_write_queries = cmdopt.optarg;
+        break;
+      }
       case 'h': {
         print_help(argv[0]);
         return 0;
@@ -489,7 +1663,21 @@ int main(int argc, char *argv[]) {
       }
     }
   }
-  print_config();
+  if ((param_queries != nullptr) && (param_workload != NO_WORKLOAD)) {
+    std::cerr << "error: options `-q' and `-G' are exclusive\n";
+    return 12;
+  }
+  if (param_skew < 0.0) {
+    param_skew = (param_workload == ZIPF_WORKLOAD) ? 1.0 : 0.0;
+  }
+  if (param_miss_ratio < 0.0) {
+    param_miss_ratio = (param_workload == MISS_WORKLOAD)        ? 0.9
+                       : (param_workload == LONG_KEY_WORKLOAD) ? 0.5
+                                                                : 0.0;
+  }
+  if (param_format == TEXT_FORMAT) {
+    print_config();
+  }
   return benchmark(cmdopt.argv + cmdopt.optind,
                    static_cast<std::size_t>(cmdopt.argc - cmdopt.optind));
 }
@@ -6,11 +6,23 @@
 
 #include <marisa.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <exception>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <queue>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "cmdopt.h"
 
@@ -21,6 +33,11 @@ marisa::TailMode param_tail_mode = MARISA_DEFAULT_TAIL;
 marisa::NodeOrder param_node_order = MARISA_DEFAULT_ORDER;
 marisa::CacheLevel param_cache_level = MARISA_DEFAULT_CACHE;
 const char *output_filename = nullptr;
+const char *temp_dir = nullptr;
+std::size_t param_run_size = 1 << 20;
+int param_save_flags = 0;
+std::size_t param_filter_bits = 0;
+bool param_verbose = false;
 
 void print_help(const char *cmd) {
   std::cerr
@@ -37,31 +54,271 @@ void print_help(const char *cmd) {
          "  -c, --cache-level=[N]    specify the cache size"
          " [1, 5] (default: 3)\n"
          "  -o, --output=[FILE]  write tries to FILE (default: stdout)\n"
+         "  -F, --format=[N]     write tries in format version N [1, 2]"
+         " (default: 1)\n"
+         "  -T, --temp-dir=[DIR]     merge duplicate keys and sort keys in"
+         " sorted runs\n"
+         "                           spilled to DIR before a build in memory\n"
+         "  -R, --run-size=[N]       spill a sorted run every N KiB of input"
+         " keys\n"
+         "                           (default: 1048576)\n"
+         "  -B, --filter=[N]     add a key filter of N bits per key [1, 64]"
+         " to reject\n"
+         "                       most misses of lookups quickly\n"
+         "  -v, --verbose        print the time and the peak vector size of"
+         " each build phase\n"
          "  -h, --help           print this help\n"
          "\n";
 }
 
+// parse_line() removes a trailing weight from `line' and returns it. `line'
+// must be followed by '\0' so that std::strtod() stops at its end.
+float parse_line(std::string_view &line) {
+  const std::string_view::size_type delim_pos = line.find_last_of('\t');
+  float weight = 1.0F;
+  if (delim_pos != line.npos) {
+    char *end_of_value;
+    weight = static_cast<float>(
+        std::strtod(line.data() + delim_pos + 1, &end_of_value));
+    if (*end_of_value == '\0') {
+      line.remove_suffix(line.length() - delim_pos);
+    }
+  }
+  return weight;
+}
+
+// Keys in a keyset refer to the input buffers instead of their own copies.
+std::vector<std::unique_ptr<std::string>> input_buffers;
+
+// read_keys() reads the whole input into a buffer and adds its lines to
+// `keyset' by reference, so that keys are not copied line by line.
 void read_keys(std::istream &input, marisa::Keyset *keyset) {
+  constexpr std::size_t CHUNK_SIZE = std::size_t{1} << 20;
+
+  input_buffers.emplace_back(new std::string);
+  std::string &buf = *input_buffers.back();
+  // The buffer is reserved up front if the input is seekable, so that it is
+  // not reallocated and copied while it grows.
+  if (input.seekg(0, std::ios::end)) {
+    const std::streamoff input_size = input.tellg();
+    if (input.seekg(0, std::ios::beg) && (input_size > 0)) {
+      buf.reserve(static_cast<std::size_t>(input_size) + CHUNK_SIZE);
+    }
+  }
+  input.clear();
+
+  std::size_t size = 0;
+  do {
+    buf.resize(size + CHUNK_SIZE);
+    input.read(&buf[size], static_cast<std::streamsize>(CHUNK_SIZE));
+    size += static_cast<std::size_t>(input.gcount());
+  } while (input);
+  buf.resize(size);
+
+  std::size_t begin = 0;
+  while (begin < size) {
+    std::size_t end = buf.find('\n', begin);
+    if (end == buf.npos) {
+      end = size;
+    }
+    // The newline is overwritten so that std::strtod() stops there.
+    buf[end] = '\0';
+
+    std::string_view line(&buf[begin], end - begin);
+    const float weight = parse_line(line);
+    keyset->push_back_ref(line.data(), line.length(), weight);
+    begin = end + 1;
+  }
+}
+
+// SortedRunMerger merges duplicate keys and sorts keys before a build. Keys
+// are buffered until the buffer exceeds the run size, and then the buffer is
+// sorted, merged and spilled to a temporary file as a sorted run. finish()
+// merges the runs and passes each unique key to a keyset in lexicographic
+// order, with the sum of the weights of its duplicates.
+//
+// This is not an out-of-core build. The keyset holds every unique key, and
+// Trie::build() copies them again, so the memory needed by a build is not
+// bounded by the run size. Runs help only if the input has many duplicates,
+// e.g. a query log.
+class SortedRunMerger {
+ public:
+  SortedRunMerger(const char *dir, std::size_t run_size)
+      : dir_(dir), run_size_(run_size) {
+    std::random_device seed_gen;
+    prefix_ = dir_ + "/marisa-build." + std::to_string(seed_gen()) + ".";
+  }
+  ~SortedRunMerger() {
+    for (std::size_t i = 0; i < num_runs_; ++i) {
+      std::remove(run_path(i).c_str());
+    }
+  }
+
+  SortedRunMerger(const SortedRunMerger &) = delete;
+  SortedRunMerger &operator=(const SortedRunMerger &) = delete;
+
+  void push_back(std::string_view key, float weight) {
+    buf_.emplace_back(std::string(key), weight);
+    buf_size_ += key.length() + sizeof(WeightedKey);
+    if (buf_size_ >= run_size_) {
+      spill();
+    }
+  }
+
+  void finish(marisa::Keyset *keyset) {
+    if (num_runs_ == 0) {
+      // All the keys fit in memory, so there is no need to touch the disk.
+      sort_buf();
+      for (const WeightedKey &key : buf_) {
+        keyset->push_back(key.first, key.second);
+      }
+      buf_.clear();
+      return;
+    }
+    spill();
+
+    std::vector<std::unique_ptr<RunReader>> readers;
+    using Head = std::pair<std::string_view, std::size_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    for (std::size_t i = 0; i < num_runs_; ++i) {
+      readers.emplace_back(new RunReader(run_path(i)));
+      if (readers[i]->next()) {
+        heads.emplace(readers[i]->key(), i);
+      }
+    }
+
+    std::string key;
+    float weight = 0.0F;
+    bool has_key = false;
+    while (!heads.empty()) {
+      const std::size_t run_id = heads.top().second;
+      heads.pop();
+      RunReader &reader = *readers[run_id];
+      if (has_key && (reader.key() == key)) {
+        weight += reader.weight();
+      } else {
+        if (has_key) {
+          keyset->push_back(key, weight);
+        }
+        key = reader.key();
+        weight = reader.weight();
+        has_key = true;
+      }
+      if (reader.next()) {
+        heads.emplace(reader.key(), run_id);
+      }
+    }
+    if (has_key) {
+      keyset->push_back(key, weight);
+    }
+  }
+
+ private:
+  using WeightedKey = std::pair<std::string, float>;
+
+  // RunReader reads a run written by spill() one key at a time.
+  class RunReader {
+   public:
+    explicit RunReader(const std::string &path)
+        : file_(path, std::ios::binary) {
+      if (!file_) {
+        throw std::runtime_error("failed to open a sorted run: " + path);
+      }
+    }
+
+    bool next() {
+      uint32_t length;
+      if (!file_.read(reinterpret_cast<char *>(&length), sizeof(length))) {
+        return false;
+      }
+      key_.resize(length);
+      if (!file_.read(reinterpret_cast<char *>(&weight_), sizeof(weight_)) ||
+          !file_.read(key_.data(), static_cast<std::streamsize>(length))) {
+        throw std::runtime_error("failed to read a sorted run");
+      }
+      return true;
+    }
+
+    std::string_view key() const {
+      return key_;
+    }
+    float weight() const {
+      return weight_;
+    }
+
+   private:
+    std::ifstream file_;
+    std::string key_;
+    float weight_ = 0.0F;
+  };
+
+  std::string dir_;
+  std::string prefix_;
+  std::size_t run_size_;
+  std::vector<WeightedKey> buf_;
+  std::size_t buf_size_ = 0;
+  std::size_t num_runs_ = 0;
+
+  std::string run_path(std::size_t run_id) const {
+    return prefix_ + std::to_string(run_id);
+  }
+
+  // sort_buf() sorts the buffered keys and merges duplicates.
+  void sort_buf() {
+    std::sort(buf_.begin(), buf_.end(),
+              [](const WeightedKey &lhs, const WeightedKey &rhs) {
+                return lhs.first < rhs.first;
+              });
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < buf_.size(); ++i) {
+      if ((size != 0) && (buf_[size - 1].first == buf_[i].first)) {
+        buf_[size - 1].second += buf_[i].second;
+      } else {
+        buf_[size++].swap(buf_[i]);
+      }
+    }
+    buf_.resize(size);
+  }
+
+  void spill() {
+    sort_buf();
+    const std::string path = run_path(num_runs_);
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+      throw std::runtime_error("failed to create a sorted run: " + path);
+    }
+    ++num_runs_;
+    for (const WeightedKey &key : buf_) {
+      const uint32_t length = static_cast<uint32_t>(key.first.length());
+      file.write(reinterpret_cast<const char *>(&length), sizeof(length));
+      file.write(reinterpret_cast<const char *>(&key.second),
+                 sizeof(key.second));
+      file.write(key.first.data(), static_cast<std::streamsize>(length));
+    }
+    if (!file.flush()) {
+      throw std::runtime_error("failed to write a sorted run: " + path);
+    }
+    std::vector<WeightedKey>().swap(buf_);
+    buf_size_ = 0;
+  }
+};
+
+void read_keys(std::istream &input, SortedRunMerger *merger) {
   std::string line;
   while (std::getline(input, line)) {
-    const std::string::size_type delim_pos = line.find_last_of('\t');
-    float weight = 1.0F;
-    if (delim_pos != line.npos) {
-      char *end_of_value;
-      weight =
-          static_cast<float>(std::strtod(&line[delim_pos + 1], &end_of_value));
-      if (*end_of_value == '\0') {
-        line.resize(delim_pos);
-      }
+    std::string_view key(line);
+    const float weight = parse_line(key);
+    if (key.length() > UINT32_MAX) {
+      throw std::length_error("too long key");
     }
-    keyset->push_back(line.c_str(), line.length(), weight);
+    merger->push_back(key, weight);
   }
 }
 
-int build(const char *const *args, std::size_t num_args) {
-  marisa::Keyset keyset;
+template <typename T>
+int read_keys(const char *const *args, std::size_t num_args, T *keys) {
   if (num_args == 0) try {
-      read_keys(std::cin, &keyset);
+      read_keys(std::cin, keys);
     } catch (const std::exception &ex) {
       std::cerr << ex.what() << ": failed to read keys\n";
       return 10;
@@ -73,28 +330,121 @@ int build(const char *const *args, std::size_t num_args) {
         std::cerr << "error: failed to open: " << args[i] << "\n";
         return 11;
       }
-      read_keys(input_file, &keyset);
+      read_keys(input_file, keys);
     } catch (const std::exception &ex) {
       std::cerr << ex.what() << ": failed to read keys\n";
       return 12;
     }
+  return 0;
+}
+
+int read_keys(const char *const *args, std::size_t num_args,
+              marisa::Keyset *keyset) {
+  if (temp_dir == nullptr) {
+    return read_keys<marisa::Keyset>(args, num_args, keyset);
+  }
+
+  try {
+    SortedRunMerger merger(temp_dir, param_run_size << 10);
+    const int result = read_keys<SortedRunMerger>(args, num_args, &merger);
+    if (result != 0) {
+      return result;
+    }
+    merger.finish(keyset);
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << ": failed to merge sorted runs of keys\n";
+    return 13;
+  }
+  return 0;
+}
+
+// BuildPhase sums up the events of a phase at a level.
+struct BuildPhase {
+  std::string name;
+  std::size_t level;
+  double elapsed;
+  std::size_t peak_vector_size;
+};
+
+void add_build_event(const marisa::BuildEvent &event,
+                     std::vector<BuildPhase> *phases) {
+  for (BuildPhase &phase : *phases) {
+    if ((phase.level == event.level) && (phase.name == event.phase)) {
+      phase.elapsed += event.elapsed;
+      phase.peak_vector_size =
+          std::max(phase.peak_vector_size, event.peak_vector_size);
+      return;
+    }
+  }
+  phases->push_back(
+      {event.phase, event.level, event.elapsed, event.peak_vector_size});
+}
+
+void print_build_phases(const std::vector<BuildPhase> &phases) {
+  double total_elapsed = 0.0;
+  std::size_t total_peak_vector_size = 0;
+  std::cerr << std::setw(5) << "level" << ' ' << std::left << std::setw(12)
+            << "phase" << std::right << std::setw(12) << "time [ms]"
+            << std::setw(20) << "peak vectors [KiB]" << "\n";
+  for (const BuildPhase &phase : phases) {
+    std::cerr << std::setw(5) << phase.level << ' ' << std::left
+              << std::setw(12) << phase.name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(12)
+              << (phase.elapsed * 1000.0) << std::setw(20)
+              << (phase.peak_vector_size / 1024) << "\n";
+    total_elapsed += phase.elapsed;
+    total_peak_vector_size =
+        std::max(total_peak_vector_size, phase.peak_vector_size);
+  }
+  std::cerr << std::setw(5) << "" << ' ' << std::left << std::setw(12)
+            << "total" << std::right << std::setw(12)
+            << (total_elapsed * 1000.0) << std::setw(20)
+            << (total_peak_vector_size / 1024) << "\n";
+}
+
+int build(const char *const *args, std::size_t num_args) {
+  marisa::Keyset keyset;
+  const int result = read_keys(args, num_args, &keyset);
+  if (result != 0) {
+    return result;
+  }
 
   marisa::Trie trie;
+  std::vector<BuildPhase> phases;
   try {
-    trie.build(keyset, param_num_tries | param_tail_mode | param_node_order |
-                           param_cache_level);
+    const int config_flags = param_num_tries | param_tail_mode |
+                             param_node_order | param_cache_level;
+    if (param_verbose) {
+      trie.build(keyset, config_flags,
+                 [&phases](const marisa::BuildEvent &event) {
+                   add_build_event(event, &phases);
+                 });
+    } else {
+      trie.build(keyset, config_flags);
+    }
   } catch (const std::exception &ex) {
     std::cerr << ex.what() << ": failed to build a dictionary\n";
     return 20;
   }
+  if (param_verbose) {
+    print_build_phases(phases);
+  }
+  if (param_filter_bits != 0) {
+    try {
+      trie.set_filter(param_filter_bits);
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what() << ": failed to build a key filter\n";
+      return 21;
+    }
+  }
 
   std::cerr << "#keys: " << trie.num_keys() << "\n";
   std::cerr << "#nodes: " << trie.num_nodes() << "\n";
-  std::cerr << "size: " << trie.io_size() << "\n";
+  std::cerr << "size: " << trie.io_size(param_save_flags) << "\n";
 
   if (output_filename != nullptr) {
     try {
-      trie.save(output_filename);
+      trie.save(output_filename, param_save_flags);
     } catch (const std::exception &ex) {
       std::cerr << ex.what()
                 << ": failed to write a dictionary to file: " << output_filename
@@ -115,7 +465,7 @@ int build(const char *const *args, std::size_t num_args) {
     }
 #endif  // _WIN32
     try {
-      std::cout << trie;
+      marisa::write(std::cout, trie, param_save_flags);
     } catch (const std::exception &ex) {
       std::cerr << ex.what()
                 << ": failed to write a dictionary to standard output\n";
@@ -139,10 +489,15 @@ int main(int argc, char *argv[]) {
       {"label-order", 0, nullptr, 'l'},
       {"cache-level", 1, nullptr, 'c'},
       {"output", 1, nullptr, 'o'},
+      {"format", 1, nullptr, 'F'},
+      {"temp-dir", 1, nullptr, 'T'},
+      {"run-size", 1, nullptr, 'R'},
+      {"filter", 1, nullptr, 'B'},
+      {"verbose", 0, nullptr, 'v'},
       {"help", 0, nullptr, 'h'},
       {nullptr, 0, nullptr, 0}};
   ::cmdopt_t cmdopt;
-  ::cmdopt_init(&cmdopt, argc, argv, "n:tbwlc:o:h", long_options);
+  ::cmdopt_init(&cmdopt, argc, argv, "n:tbwlc:o:F:T:R:B:vh", long_options);
   int label;
   while ((label = ::cmdopt_get(&cmdopt)) != -1) {
     switch (label) {
@@ -199,6 +554,48 @@ int main(int argc, char *argv[]) {
         output_filename = cmdopt.optarg;
         break;
       }
+      case 'F': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value < 1) || (value > 2)) {
+          std::cerr << "error: option `-F' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 4;
+        }
+        param_save_flags = (value == 2) ? MARISA_SAVE_V2 : 0;
+        break;
+      }
+      case 'T': {
+        temp_dir = cmdopt.optarg;
+        break;
+      }
+      case 'R': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value <= 0) ||
+            (static_cast<unsigned long>(value) > (SIZE_MAX >> 10))) {
+          std::cerr << "error: option `-R' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 3;
+        }
+        param_run_size = static_cast<std::size_t>(value);
+        break;
+      }
+      case 'B': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value < 1) || (value > 64)) {
+          std::cerr << "error: option `-B' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 5;
+        }
+        param_filter_bits = static_cast<std::size_t>(value);
+        break;
+      }
+      case 'v': {
+        param_verbose = true;
+        break;
+      }
       case 'h': {
         print_help(argv[0]);
         return 0;
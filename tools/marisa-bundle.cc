@@ -0,0 +1,205 @@
+#ifdef _WIN32
+ #include <fcntl.h>
+ #include <io.h>
+ #include <stdio.h>
+#endif  // _WIN32
+
+#include <marisa.h>
+#include <marisa/trie-bundle.h>
+
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <string_view>
+
+#include "cmdopt.h"
+
+namespace {
+
+int param_save_flags = MARISA_SAVE_V2;
+const char *output_filename = nullptr;
+bool list_flag = false;
+bool mmap_flag = true;
+
+void print_help(const char *cmd) {
+  std::cerr
+      << "Usage: " << cmd
+      << " [OPTION]... [NAME=]DIC...\n"
+         "       "
+      << cmd
+      << " -L BUNDLE\n\n"
+         "Options:\n"
+         "  -F, --format=[N]     write tries in format version N [1, 2]"
+         " (default: 2)\n"
+         "  -o, --output=[FILE]  write a bundle to FILE (default: stdout)\n"
+         "  -L, --list           list tries in a bundle\n"
+         "  -m, --mmap-dictionary  use memory-mapped I/O to load a dictionary"
+         " (default)\n"
+         "  -r, --read-dictionary  read an entire dictionary into memory\n"
+         "  -h, --help           print this help\n"
+         "\n"
+         "Each DIC is stored under NAME, or under DIC if NAME is omitted.\n"
+         "\n";
+}
+
+int list(const char *const *args, std::size_t num_args) {
+  if (num_args != 1) {
+    std::cerr << "error: one bundle must be specified\n";
+    return 10;
+  }
+
+  marisa::TrieBundle bundle;
+  try {
+    bundle.mmap(args[0]);
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << ": failed to mmap a bundle file: " << args[0]
+              << "\n";
+    return 20;
+  }
+
+  for (std::size_t i = 0; i < bundle.size(); ++i) {
+    try {
+      std::cout << bundle.name(i) << '\t' << bundle.offset(i) << '\t'
+                << bundle.io_size(i) << '\t' << bundle.trie(i).num_keys()
+                << '\n';
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what() << ": failed to map a trie: " << bundle.name(i)
+                << "\n";
+      return 21;
+    }
+  }
+  return 0;
+}
+
+int bundle(const char *const *args, std::size_t num_args) {
+  if (num_args == 0) {
+    std::cerr << "error: dictionaries are not specified\n";
+    return 10;
+  }
+
+  // std::deque keeps the addresses of tries given to the builder.
+  std::deque<marisa::Trie> tries;
+  marisa::TrieBundleBuilder builder;
+  for (std::size_t i = 0; i < num_args; ++i) {
+    const std::string_view arg = args[i];
+    const std::size_t delim_pos = arg.find('=');
+    const std::string_view name =
+        (delim_pos != std::string_view::npos) ? arg.substr(0, delim_pos) : arg;
+    const char *filename =
+        (delim_pos != std::string_view::npos) ? (args[i] + delim_pos + 1)
+                                              : args[i];
+
+    tries.emplace_back();
+    if (mmap_flag) {
+      try {
+        tries.back().mmap(filename);
+      } catch (const std::exception &ex) {
+        std::cerr << ex.what() << ": failed to mmap a dictionary file: "
+                  << filename << "\n";
+        return 20;
+      }
+    } else {
+      try {
+        tries.back().load(filename);
+      } catch (const std::exception &ex) {
+        std::cerr << ex.what() << ": failed to load a dictionary file: "
+                  << filename << "\n";
+        return 21;
+      }
+    }
+    builder.add(name, tries.back());
+  }
+
+  if (output_filename != nullptr) {
+    try {
+      builder.save(output_filename, param_save_flags);
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what()
+                << ": failed to write a bundle to file: " << output_filename
+                << "\n";
+      return 30;
+    }
+  } else {
+#ifdef _WIN32
+    const int stdout_fileno = ::_fileno(stdout);
+    if (stdout_fileno < 0) {
+      std::cerr << "error: failed to get the file descriptor of "
+                   "standard output\n";
+      return 31;
+    }
+    if (::_setmode(stdout_fileno, _O_BINARY) == -1) {
+      std::cerr << "error: failed to set binary mode\n";
+      return 32;
+    }
+#endif  // _WIN32
+    try {
+      builder.write(std::cout, param_save_flags);
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what()
+                << ": failed to write a bundle to standard output\n";
+      return 33;
+    }
+  }
+  std::cerr << "#tries: " << builder.size() << "\n";
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::ios::sync_with_stdio(false);
+
+  ::cmdopt_option long_options[] = {{"format", 1, nullptr, 'F'},
+                                    {"output", 1, nullptr, 'o'},
+                                    {"list", 0, nullptr, 'L'},
+                                    {"mmap-dictionary", 0, nullptr, 'm'},
+                                    {"read-dictionary", 0, nullptr, 'r'},
+                                    {"help", 0, nullptr, 'h'},
+                                    {nullptr, 0, nullptr, 0}};
+  ::cmdopt_t cmdopt;
+  ::cmdopt_init(&cmdopt, argc, argv, "F:o:Lmrh", long_options);
+  int label;
+  while ((label = ::cmdopt_get(&cmdopt)) != -1) {
+    switch (label) {
+      case 'F': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value < 1) || (value > 2)) {
+          std::cerr << "error: option `-F' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 1;
+        }
+        param_save_flags = (value == 2) ? MARISA_SAVE_V2 : 0;
+        break;
+      }
+      case 'o': {
+        output_filename = cmdopt.optarg;
+        break;
+      }
+      case 'L': {
+        list_flag = true;
+        break;
+      }
+      case 'm': {
+        mmap_flag = true;
+        break;
+      }
+      case 'r': {
+        mmap_flag = false;
+        break;
+      }
+      case 'h': {
+        print_help(argv[0]);
+        return 0;
+      }
+      default: {
+        return 1;
+      }
+    }
+  }
+  const char *const *args = cmdopt.argv + cmdopt.optind;
+  const std::size_t num_args =
+      static_cast<std::size_t>(cmdopt.argc - cmdopt.optind);
+  return list_flag ? list(args, num_args) : bundle(args, num_args);
+}
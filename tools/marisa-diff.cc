@@ -0,0 +1,130 @@
+#include <marisa.h>
+#include <marisa/set-operations.h>
+
+#include <exception>
+#include <iostream>
+#include <string_view>
+
+#include "cmdopt.h"
+
+namespace {
+
+bool mmap_flag = true;
+
+void print_help(const char *cmd) {
+  std::cerr
+      << "Usage: " << cmd
+      << " [OPTION]... DIC1 DIC2\n\n"
+         "Prints keys only in DIC1 with '-' and keys only in DIC2 with '+'.\n\n"
+         "Options:\n"
+         "  -m, --mmap-dictionary  use memory-mapped I/O to load a dictionary"
+         " (default)\n"
+         "  -r, --read-dictionary  read an entire dictionary into memory\n"
+         "  -h, --help             print this help\n"
+         "\n"
+         "A dictionary in weight order, the default of marisa-build,"
+         " has its keys\n"
+         "copied into memory and sorted before it is compared. Build it"
+         " with -l to\n"
+         "stream its keys instead.\n"
+         "\n";
+}
+
+int open(const char *filename, marisa::Trie *trie) {
+  if (mmap_flag) {
+    try {
+      trie->mmap(filename);
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what()
+                << ": failed to mmap a dictionary file: " << filename << "\n";
+      return 20;
+    }
+  } else {
+    try {
+      trie->load(filename);
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what()
+                << ": failed to load a dictionary file: " << filename << "\n";
+      return 21;
+    }
+  }
+  if (trie->node_order() != MARISA_LABEL_ORDER) {
+    std::cerr << "warning: keys of a dictionary in weight order are copied"
+                 " into memory and sorted: "
+              << filename << "\n";
+  }
+  return 0;
+}
+
+int diff(const char *const *args, std::size_t num_args) {
+  if (num_args != 2) {
+    std::cerr << "error: two dictionaries must be specified\n";
+    return 10;
+  }
+
+  marisa::Trie lhs, rhs;
+  int result = open(args[0], &lhs);
+  if (result == 0) {
+    result = open(args[1], &rhs);
+  }
+  if (result != 0) {
+    return result;
+  }
+
+  std::size_t num_removed = 0;
+  std::size_t num_added = 0;
+  try {
+    marisa::diff(lhs, rhs, [&](std::string_view key, bool is_added) {
+      std::cout << (is_added ? '+' : '-') << '\t';
+      std::cout.write(key.data(), static_cast<std::streamsize>(key.length()))
+          << '\n';
+      ++(is_added ? num_added : num_removed);
+      return static_cast<bool>(std::cout);
+    });
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << ": diff() failed\n";
+    return 22;
+  }
+  if (!std::cout) {
+    std::cerr << "error: failed to write results to standard output\n";
+    return 30;
+  }
+  std::cerr << "#removed: " << num_removed << "\n";
+  std::cerr << "#added: " << num_added << "\n";
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::ios::sync_with_stdio(false);
+
+  ::cmdopt_option long_options[] = {{"mmap-dictionary", 0, nullptr, 'm'},
+                                    {"read-dictionary", 0, nullptr, 'r'},
+                                    {"help", 0, nullptr, 'h'},
+                                    {nullptr, 0, nullptr, 0}};
+  ::cmdopt_t cmdopt;
+  ::cmdopt_init(&cmdopt, argc, argv, "mrh", long_options);
+  int label;
+  while ((label = ::cmdopt_get(&cmdopt)) != -1) {
+    switch (label) {
+      case 'm': {
+        mmap_flag = true;
+        break;
+      }
+      case 'r': {
+        mmap_flag = false;
+        break;
+      }
+      case 'h': {
+        print_help(argv[0]);
+        return 0;
+      }
+      default: {
+        return 1;
+      }
+    }
+  }
+  return diff(cmdopt.argv + cmdopt.optind,
+              static_cast<std::size_t>(cmdopt.argc - cmdopt.optind));
+}
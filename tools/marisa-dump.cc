@@ -8,6 +8,7 @@
 
 #include <cstdlib>
 #include <exception>
+#include <iomanip>
 #include <iostream>
 #include <string>
 
@@ -17,6 +18,7 @@ namespace {
 
 const char *delimiter = "\n";
 bool mmap_flag = true;
+bool stats_flag = false;
 
 void print_help(const char *cmd) {
   std::cerr
@@ -27,6 +29,8 @@ void print_help(const char *cmd) {
          "  -m, --mmap-dictionary  use memory-mapped I/O to load a dictionary"
          " (default)\n"
          "  -r, --read-dictionary  read an entire dictionary into memory\n"
+         "  -s, --stats            print the sizes of components instead of"
+         " keys\n"
          "  -h, --help             print this help\n"
          "\n";
 }
@@ -54,6 +58,57 @@ int dump(const marisa::Trie &trie) {
   return 0;
 }
 
+void print_component(const char *name, const marisa::ComponentSize &size) {
+  std::cout << "  " << std::left << std::setw(16) << name << std::right
+            << std::setw(12) << size.size << " bytes";
+  if (size.index_size != 0) {
+    std::cout << " (rank/select: " << size.index_size << ")";
+  }
+  std::cout << "\n";
+}
+
+int print_stats(const marisa::Trie &trie) {
+  const marisa::SizeReport report = trie.size_report();
+  std::cout << "#keys: " << trie.num_keys() << "\n";
+  std::cout << "#tries: " << trie.num_tries() << "\n";
+  std::cout << "#nodes: " << trie.num_nodes() << "\n";
+  for (std::size_t i = 0; i < report.levels.size(); ++i) {
+    const marisa::LevelSizeReport &level = report.levels[i];
+    std::cout << "level " << i << ": " << level.num_nodes << " nodes, "
+              << level.num_terminals << " terminals, " << level.num_links
+              << " links, " << level.num_cache_entries << " cache entries\n";
+    print_component("louds", level.louds);
+    print_component("terminal_flags", level.terminal_flags);
+    print_component("link_flags", level.link_flags);
+    print_component("bases", level.bases);
+    print_component("extras", level.extras);
+    print_component("cache", level.cache);
+    print_component("total", {level.total_size(), 0});
+  }
+
+  const marisa::TailSizeReport &tail = report.tail;
+  std::cout << "tail: "
+            << ((tail.mode == MARISA_BINARY_TAIL) ? "binary" : "text")
+            << " mode, " << tail.num_suffixes << " suffixes, "
+            << tail.unshared_size << " bytes before sharing, " << std::fixed
+            << std::setprecision(1) << (100.0 * tail.sharing_ratio())
+            << "% shared\n";
+  print_component("buf", tail.buf);
+  print_component("end_flags", tail.end_flags);
+  print_component("total", {tail.total_size(), 0});
+
+  std::cout << "values: " << report.values_size << " bytes\n";
+  std::cout << "postings: " << report.postings_size << " bytes\n";
+  std::cout << "filter: " << report.filter_size << " bytes\n";
+  std::cout << "total size: " << report.total_size << " bytes\n";
+  std::cout << "io size: " << report.io_size << " bytes\n";
+  if (!std::cout) {
+    std::cerr << "error: failed to write results to standard output\n";
+    return 20;
+  }
+  return 0;
+}
+
 int dump(const char *filename) {
   marisa::Trie trie;
   if (filename != nullptr) {
@@ -97,7 +152,7 @@ int dump(const char *filename) {
       return 22;
     }
   }
-  return dump(trie);
+  return stats_flag ? print_stats(trie) : dump(trie);
 }
 
 int dump(const char *const *args, std::size_t num_args) {
@@ -121,10 +176,11 @@ int main(int argc, char *argv[]) {
   ::cmdopt_option long_options[] = {{"delimiter", 1, nullptr, 'd'},
                                     {"mmap-dictionary", 0, nullptr, 'm'},
                                     {"read-dictionary", 0, nullptr, 'r'},
+                                    {"stats", 0, nullptr, 's'},
                                     {"help", 0, nullptr, 'h'},
                                     {nullptr, 0, nullptr, 0}};
   ::cmdopt_t cmdopt;
-  ::cmdopt_init(&cmdopt, argc, argv, "d:mrh", long_options);
+  ::cmdopt_init(&cmdopt, argc, argv, "d:mrsh", long_options);
   int label;
   while ((label = ::cmdopt_get(&cmdopt)) != -1) {
     switch (label) {
@@ -140,6 +196,10 @@ int main(int argc, char *argv[]) {
         mmap_flag = false;
         break;
       }
+      case 's': {
+        stats_flag = true;
+        break;
+      }
       case 'h': {
         print_help(argv[0]);
         return 0;
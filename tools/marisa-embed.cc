@@ -0,0 +1,286 @@
+#include <marisa.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "cmdopt.h"
+
+namespace {
+
+const char *param_name = "dictionary";
+const char *output_filename = nullptr;
+const char *header_filename = nullptr;
+int param_save_flags = 0;
+
+void print_help(const char *cmd) {
+  std::cerr
+      << "Usage: " << cmd
+      << " [OPTION]... DIC\n\n"
+         "Options:\n"
+         "  -n, --name=[NAME]    name the accessor NAME, which may be"
+         " qualified with\n"
+         "                       namespaces, e.g. `text::stop_words'"
+         " (default: dictionary)\n"
+         "  -o, --output=[FILE]  write a C++ source to FILE (default:"
+         " stdout)\n"
+         "  -H, --header=[FILE]  write a C++ header declaring the accessor"
+         " to FILE\n"
+         "  -F, --format=[N]     embed tries in format version N [1, 2]"
+         " (default: 1)\n"
+         "  -h, --help           print this help\n"
+         "\n"
+         "The source defines `const marisa::Trie &NAME()', which maps the"
+         " trie on its\n"
+         "first call. The serialized trie is a constexpr array, so it is"
+         " placed in the\n"
+         "read-only segment of the binary and its pages are shared across"
+         " processes.\n"
+         "\n";
+}
+
+bool is_identifier(const std::string &str) {
+  if (str.empty() || ((str[0] >= '0') && (str[0] <= '9'))) {
+    return false;
+  }
+  for (const char c : str) {
+    if (!(((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) ||
+          ((c >= '0') && (c <= '9')) || (c == '_'))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// split_name() splits a qualified name into the namespace and the
+// unqualified name, and returns false if `name' is not valid.
+bool split_name(const std::string &name, std::string *name_space,
+                std::string *base_name) {
+  std::string::size_type begin = 0;
+  for (;;) {
+    const std::string::size_type end = name.find("::", begin);
+    if (!is_identifier(name.substr(begin, end - begin))) {
+      return false;
+    }
+    if (end == name.npos) {
+      break;
+    }
+    begin = end + 2;
+  }
+  *base_name = name.substr(begin);
+  *name_space = (begin == 0) ? "" : name.substr(0, begin - 2);
+  return true;
+}
+
+std::string get_include_guard(const char *filename) {
+  std::string guard;
+  for (const char *p = filename; *p != '\0'; ++p) {
+    const char c = *p;
+    if (((c >= 'a') && (c <= 'z'))) {
+      guard += static_cast<char>(c - 'a' + 'A');
+    } else if (((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9'))) {
+      guard += c;
+    } else {
+      guard += '_';
+    }
+  }
+  return "MARISA_EMBED_" + guard + "_";
+}
+
+void write_declaration(std::ostream &output, const std::string &name_space,
+                       const std::string &base_name) {
+  if (!name_space.empty()) {
+    output << "namespace " << name_space << " {\n\n";
+  }
+  output << "const marisa::Trie &" << base_name << "();\n";
+  if (!name_space.empty()) {
+    output << "\n}  // namespace " << name_space << "\n";
+  }
+}
+
+void write_header(std::ostream &output, const char *dic_filename,
+                  const std::string &name_space,
+                  const std::string &base_name) {
+  const std::string guard = get_include_guard(header_filename);
+  output << "// Generated by marisa-embed from " << dic_filename
+         << ". Do not edit.\n\n"
+         << "#ifndef " << guard << "\n"
+         << "#define " << guard << "\n\n"
+         << "#include <marisa.h>\n\n";
+  write_declaration(output, name_space, base_name);
+  output << "\n#endif  // " << guard << "\n";
+}
+
+// The array is aligned to 64 bytes, which is what the version 2 format
+// expects for vectors mapped in place.
+void write_source(std::ostream &output, const char *dic_filename,
+                  const std::string &name_space, const std::string &base_name,
+                  const std::string &bytes) {
+  output << "// Generated by marisa-embed from " << dic_filename
+         << ". Do not edit.\n\n"
+         << "#include <marisa.h>\n\n"
+         << "namespace {\n\n"
+         << "alignas(64) constexpr unsigned char kTrieData[" << bytes.size()
+         << "] = {";
+  char buf[8];
+  for (std::size_t i = 0; i < bytes.size(); ++i) {
+    output << (((i % 12) == 0) ? "\n   " : "");
+    std::snprintf(buf, sizeof(buf), " 0x%02X,",
+                  static_cast<unsigned char>(bytes[i]));
+    output << buf;
+  }
+  output << "\n};\n\n"
+         << "}  // namespace\n\n";
+  if (!name_space.empty()) {
+    output << "namespace " << name_space << " {\n\n";
+  }
+  output << "const marisa::Trie &" << base_name << "() {\n"
+         << "  static const marisa::Trie trie = [] {\n"
+         << "    marisa::Trie temp;\n"
+         << "    temp.map(kTrieData, sizeof(kTrieData));\n"
+         << "    return temp;\n"
+         << "  }();\n"
+         << "  return trie;\n"
+         << "}\n";
+  if (!name_space.empty()) {
+    output << "\n}  // namespace " << name_space << "\n";
+  }
+}
+
+int embed(const char *const *args, std::size_t num_args) {
+  if (num_args == 0) {
+    std::cerr << "error: dictionary is not specified\n";
+    return 10;
+  }
+  if (num_args > 1) {
+    std::cerr << "error: more than one dictionaries are specified\n";
+    return 11;
+  }
+
+  std::string name_space;
+  std::string base_name;
+  if (!split_name(param_name, &name_space, &base_name)) {
+    std::cerr << "error: invalid name: " << param_name << "\n";
+    return 12;
+  }
+
+  marisa::Trie trie;
+  try {
+    trie.load(args[0]);
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << ": failed to load a dictionary file: "
+              << args[0] << "\n";
+    return 20;
+  }
+
+  std::ostringstream stream;
+  try {
+    marisa::write(stream, trie, param_save_flags);
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << ": failed to serialize a dictionary\n";
+    return 21;
+  }
+  const std::string bytes = stream.str();
+
+  // The embedded bytes must be mappable as they are.
+  try {
+    marisa::Trie mapped;
+    mapped.map(bytes.data(), bytes.size());
+    if (mapped.num_keys() != trie.num_keys()) {
+      std::cerr << "error: failed to map a serialized dictionary\n";
+      return 22;
+    }
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << ": failed to map a serialized dictionary\n";
+    return 22;
+  }
+
+  if (header_filename != nullptr) {
+    std::ofstream header_file(header_filename, std::ios::binary);
+    if (!header_file) {
+      std::cerr << "error: failed to open: " << header_filename << "\n";
+      return 30;
+    }
+    write_header(header_file, args[0], name_space, base_name);
+    if (!header_file.flush()) {
+      std::cerr << "error: failed to write: " << header_filename << "\n";
+      return 31;
+    }
+  }
+
+  if (output_filename != nullptr) {
+    std::ofstream output_file(output_filename, std::ios::binary);
+    if (!output_file) {
+      std::cerr << "error: failed to open: " << output_filename << "\n";
+      return 32;
+    }
+    write_source(output_file, args[0], name_space, base_name, bytes);
+    if (!output_file.flush()) {
+      std::cerr << "error: failed to write: " << output_filename << "\n";
+      return 33;
+    }
+  } else {
+    write_source(std::cout, args[0], name_space, base_name, bytes);
+    if (!std::cout.flush()) {
+      std::cerr << "error: failed to write a source to standard output\n";
+      return 33;
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::ios::sync_with_stdio(false);
+
+  ::cmdopt_option long_options[] = {{"name", 1, nullptr, 'n'},
+                                    {"output", 1, nullptr, 'o'},
+                                    {"header", 1, nullptr, 'H'},
+                                    {"format", 1, nullptr, 'F'},
+                                    {"help", 0, nullptr, 'h'},
+                                    {nullptr, 0, nullptr, 0}};
+  ::cmdopt_t cmdopt;
+  ::cmdopt_init(&cmdopt, argc, argv, "n:o:H:F:h", long_options);
+  int label;
+  while ((label = ::cmdopt_get(&cmdopt)) != -1) {
+    switch (label) {
+      case 'n': {
+        param_name = cmdopt.optarg;
+        break;
+      }
+      case 'o': {
+        output_filename = cmdopt.optarg;
+        break;
+      }
+      case 'H': {
+        header_filename = cmdopt.optarg;
+        break;
+      }
+      case 'F': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value < 1) || (value > 2)) {
+          std::cerr << "error: option `-F' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 2;
+        }
+        param_save_flags = (value == 2) ? MARISA_SAVE_V2 : 0;
+        break;
+      }
+      case 'h': {
+        print_help(argv[0]);
+        return 0;
+      }
+      default: {
+        return 1;
+      }
+    }
+  }
+  return embed(cmdopt.argv + cmdopt.optind,
+               static_cast<std::size_t>(cmdopt.argc - cmdopt.optind));
+}
@@ -0,0 +1,272 @@
+#ifdef _WIN32
+ #include <fcntl.h>
+ #include <io.h>
+ #include <stdio.h>
+#endif  // _WIN32
+
+#include <marisa.h>
+#include <marisa/set-operations.h>
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+#include "cmdopt.h"
+
+namespace {
+
+enum Operation {
+  UNION,
+  INTERSECTION,
+  DIFFERENCE
+};
+
+Operation operation = UNION;
+int param_num_tries = MARISA_DEFAULT_NUM_TRIES;
+marisa::TailMode param_tail_mode = MARISA_DEFAULT_TAIL;
+marisa::NodeOrder param_node_order = MARISA_DEFAULT_ORDER;
+marisa::CacheLevel param_cache_level = MARISA_DEFAULT_CACHE;
+const char *output_filename = nullptr;
+bool mmap_flag = true;
+
+void print_help(const char *cmd) {
+  std::cerr
+      << "Usage: " << cmd
+      << " [OPTION]... DIC1 DIC2\n\n"
+         "Options:\n"
+         "  -u, --union          keep keys in DIC1 or DIC2 (default)\n"
+         "  -i, --intersection   keep keys in both DIC1 and DIC2\n"
+         "  -d, --difference     keep keys in DIC1 but not in DIC2\n"
+         "  -n, --num-tries=[N]  limit the number of tries ["
+      << MARISA_MIN_NUM_TRIES << ", " << MARISA_MAX_NUM_TRIES
+      << "] (default: 3)\n"
+         "  -t, --text-tail      build a dictionary with text TAIL (default)\n"
+         "  -b, --binary-tail    build a dictionary with binary TAIL\n"
+         "  -w, --weight-order   arrange siblings in weight order (default)\n"
+         "  -l, --label-order    arrange siblings in label order\n"
+         "  -c, --cache-level=[N]    specify the cache size"
+         " [1, 5] (default: 3)\n"
+         "  -o, --output=[FILE]  write tries to FILE (default: stdout)\n"
+         "  -m, --mmap-dictionary  use memory-mapped I/O to load a dictionary"
+         " (default)\n"
+         "  -r, --read-dictionary  read an entire dictionary into memory\n"
+         "  -h, --help           print this help\n"
+         "\n"
+         "A dictionary in weight order, the default of marisa-build,"
+         " has its keys\n"
+         "copied into memory and sorted before it is merged. Build it"
+         " with -l to\n"
+         "stream its keys instead.\n"
+         "\n";
+}
+
+int open(const char *filename, marisa::Trie *trie) {
+  if (mmap_flag) {
+    try {
+      trie->mmap(filename);
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what()
+                << ": failed to mmap a dictionary file: " << filename << "\n";
+      return 20;
+    }
+  } else {
+    try {
+      trie->load(filename);
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what()
+                << ": failed to load a dictionary file: " << filename << "\n";
+      return 21;
+    }
+  }
+  if (trie->node_order() != MARISA_LABEL_ORDER) {
+    std::cerr << "warning: keys of a dictionary in weight order are copied"
+                 " into memory and sorted: "
+              << filename << "\n";
+  }
+  return 0;
+}
+
+int merge(const char *const *args, std::size_t num_args) {
+  if (num_args != 2) {
+    std::cerr << "error: two dictionaries must be specified\n";
+    return 10;
+  }
+
+  marisa::Trie lhs, rhs;
+  int result = open(args[0], &lhs);
+  if (result == 0) {
+    result = open(args[1], &rhs);
+  }
+  if (result != 0) {
+    return result;
+  }
+
+  const int config_flags =
+      param_num_tries | param_tail_mode | param_node_order | param_cache_level;
+  marisa::Trie trie;
+  try {
+    switch (operation) {
+      case UNION: {
+        marisa::set_union(lhs, rhs, &trie, config_flags);
+        break;
+      }
+      case INTERSECTION: {
+        marisa::set_intersection(lhs, rhs, &trie, config_flags);
+        break;
+      }
+      case DIFFERENCE: {
+        marisa::set_difference(lhs, rhs, &trie, config_flags);
+        break;
+      }
+    }
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << ": failed to build a dictionary\n";
+    return 22;
+  }
+
+  std::cerr << "#keys: " << trie.num_keys() << "\n";
+  std::cerr << "#nodes: " << trie.num_nodes() << "\n";
+  std::cerr << "size: " << trie.io_size() << "\n";
+
+  if (output_filename != nullptr) {
+    try {
+      trie.save(output_filename);
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what()
+                << ": failed to write a dictionary to file: " << output_filename
+                << "\n";
+      return 30;
+    }
+  } else {
+#ifdef _WIN32
+    const int stdout_fileno = ::_fileno(stdout);
+    if (stdout_fileno < 0) {
+      std::cerr << "error: failed to get the file descriptor of "
+                   "standard output\n";
+      return 31;
+    }
+    if (::_setmode(stdout_fileno, _O_BINARY) == -1) {
+      std::cerr << "error: failed to set binary mode\n";
+      return 32;
+    }
+#endif  // _WIN32
+    try {
+      std::cout << trie;
+    } catch (const std::exception &ex) {
+      std::cerr << ex.what()
+                << ": failed to write a dictionary to standard output\n";
+      return 33;
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::ios::sync_with_stdio(false);
+
+  ::cmdopt_option long_options[] = {{"union", 0, nullptr, 'u'},
+                                    {"intersection", 0, nullptr, 'i'},
+                                    {"difference", 0, nullptr, 'd'},
+                                    {"num-tries", 1, nullptr, 'n'},
+                                    {"text-tail", 0, nullptr, 't'},
+                                    {"binary-tail", 0, nullptr, 'b'},
+                                    {"weight-order", 0, nullptr, 'w'},
+                                    {"label-order", 0, nullptr, 'l'},
+                                    {"cache-level", 1, nullptr, 'c'},
+                                    {"output", 1, nullptr, 'o'},
+                                    {"mmap-dictionary", 0, nullptr, 'm'},
+                                    {"read-dictionary", 0, nullptr, 'r'},
+                                    {"help", 0, nullptr, 'h'},
+                                    {nullptr, 0, nullptr, 0}};
+  ::cmdopt_t cmdopt;
+  ::cmdopt_init(&cmdopt, argc, argv, "uidn:tbwlc:o:mrh", long_options);
+  int label;
+  while ((label = ::cmdopt_get(&cmdopt)) != -1) {
+    switch (label) {
+      case 'u': {
+        operation = UNION;
+        break;
+      }
+      case 'i': {
+        operation = INTERSECTION;
+        break;
+      }
+      case 'd': {
+        operation = DIFFERENCE;
+        break;
+      }
+      case 'n': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value <= 0) ||
+            (value > MARISA_MAX_NUM_TRIES)) {
+          std::cerr << "error: option `-n' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 1;
+        }
+        param_num_tries = static_cast<int>(value);
+        break;
+      }
+      case 't': {
+        param_tail_mode = MARISA_TEXT_TAIL;
+        break;
+      }
+      case 'b': {
+        param_tail_mode = MARISA_BINARY_TAIL;
+        break;
+      }
+      case 'w': {
+        param_node_order = MARISA_WEIGHT_ORDER;
+        break;
+      }
+      case 'l': {
+        param_node_order = MARISA_LABEL_ORDER;
+        break;
+      }
+      case 'c': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value < 1) || (value > 5)) {
+          std::cerr << "error: option `-c' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 2;
+        }
+        if (value == 1) {
+          param_cache_level = MARISA_TINY_CACHE;
+        } else if (value == 2) {
+          param_cache_level = MARISA_SMALL_CACHE;
+        } else if (value == 3) {
+          param_cache_level = MARISA_NORMAL_CACHE;
+        } else if (value == 4) {
+          param_cache_level = MARISA_LARGE_CACHE;
+        } else if (value == 5) {
+          param_cache_level = MARISA_HUGE_CACHE;
+        }
+        break;
+      }
+      case 'o': {
+        output_filename = cmdopt.optarg;
+        break;
+      }
+      case 'm': {
+        mmap_flag = true;
+        break;
+      }
+      case 'r': {
+        mmap_flag = false;
+        break;
+      }
+      case 'h': {
+        print_help(argv[0]);
+        return 0;
+      }
+      default: {
+        return 1;
+      }
+    }
+  }
+  return merge(cmdopt.argv + cmdopt.optind,
+               static_cast<std::size_t>(cmdopt.argc - cmdopt.optind));
+}
@@ -0,0 +1,525 @@
+// marisa-microbench measures the primitives of grimoire one by one. It uses
+// internal headers, so it is built with `lib' in its include path and is not
+// installed.
+
+#ifdef __linux__
+ #include <linux/perf_event.h>
+ #include <sys/ioctl.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif  // __linux__
+
+#include <marisa.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cmdopt.h"
+#include "marisa/grimoire/algorithm/sort.h"
+#include "marisa/grimoire/trie.h"
+#include "marisa/grimoire/trie/tail.h"
+#include "marisa/grimoire/vector.h"
+
+namespace {
+
+using marisa::grimoire::BitVector;
+using marisa::grimoire::FlatVector;
+using marisa::grimoire::LoudsTrie;
+using marisa::grimoire::Vector;
+using marisa::grimoire::trie::Entry;
+using marisa::grimoire::trie::Key;
+using marisa::grimoire::trie::Tail;
+
+std::size_t param_size = 1000000;
+std::size_t param_num_ops = 1000000;
+std::size_t param_num_runs = 3;
+uint32_t param_seed = 1;
+const char *param_filter = nullptr;
+
+void print_help(const char *cmd) {
+  std::cerr
+      << "Usage: " << cmd
+      << " [OPTION]... [FILE]...\n\n"
+         "Options:\n"
+         "  -n, --size=[N]      use N bits, values or synthetic keys"
+         " (default: 1000000)\n"
+         "  -o, --num-ops=[N]   measure N operations per run"
+         " (default: 1000000)\n"
+         "  -r, --num-runs=[N]  report the fastest of N runs (default: 3)\n"
+         "  -s, --seed=[N]      seed the random number generator"
+         " (default: 1)\n"
+         "  -f, --filter=[STR]  run benchmarks whose names contain STR\n"
+         "  -h, --help          print this help\n"
+         "\n"
+         "Keys are read from FILEs if given, and generated otherwise.\n"
+         "\n";
+}
+
+// PerfCounters counts cycles, instructions and last-level cache misses of
+// the calling thread with perf_event_open(). Counters which cannot be opened,
+// e.g. in a container, are reported as unavailable.
+class PerfCounters {
+ public:
+  enum {
+    CYCLES,
+    INSTRUCTIONS,
+    LLC_MISSES,
+    NUM_COUNTERS
+  };
+
+  PerfCounters() {
+#ifdef __linux__
+    const uint64_t configs[NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES,
+                                            PERF_COUNT_HW_INSTRUCTIONS,
+                                            PERF_COUNT_HW_CACHE_MISSES};
+    for (int i = 0; i < NUM_COUNTERS; ++i) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs[i];
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fds_[i] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1,
+                                           -1, 0));
+    }
+#endif  // __linux__
+  }
+  ~PerfCounters() {
+#ifdef __linux__
+    for (int fd : fds_) {
+      if (fd != -1) {
+        ::close(fd);
+      }
+    }
+#endif  // __linux__
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  bool available(int i) const {
+    return fds_[i] != -1;
+  }
+
+  void start() {
+#ifdef __linux__
+    for (int fd : fds_) {
+      if (fd != -1) {
+        ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+#endif  // __linux__
+  }
+  void stop(uint64_t *counts) {
+    for (int i = 0; i < NUM_COUNTERS; ++i) {
+      counts[i] = 0;
+#ifdef __linux__
+      if (fds_[i] != -1) {
+        ::ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (::read(fds_[i], &counts[i], sizeof(counts[i])) !=
+            sizeof(counts[i])) {
+          counts[i] = 0;
+        }
+      }
+#endif  // __linux__
+    }
+  }
+
+ private:
+  int fds_[NUM_COUNTERS] = {-1, -1, -1};
+};
+
+// A benchmark runs `num_ops' operations per call, and returns a value which
+// depends on the results so that the compiler cannot remove them.
+using Benchmark = std::function<std::size_t()>;
+
+volatile std::size_t sink = 0;
+
+void run(PerfCounters &counters, const std::string &name, std::size_t num_ops,
+         const Benchmark &benchmark) {
+  if ((param_filter != nullptr) &&
+      (name.find(param_filter) == std::string::npos)) {
+    return;
+  }
+
+  double best_ns = 0.0;
+  uint64_t best_counts[PerfCounters::NUM_COUNTERS] = {};
+  sink = sink + benchmark();  // Warm up caches.
+  for (std::size_t i = 0; i < param_num_runs; ++i) {
+    uint64_t counts[PerfCounters::NUM_COUNTERS];
+    const auto begin = std::chrono::steady_clock::now();
+    counters.start();
+    sink = sink + benchmark();
+    counters.stop(counts);
+    const auto end = std::chrono::steady_clock::now();
+    const double ns =
+        std::chrono::duration<double, std::nano>(end - begin).count();
+    if ((i == 0) || (ns < best_ns)) {
+      best_ns = ns;
+      std::memcpy(best_counts, counts, sizeof(counts));
+    }
+  }
+
+  const double ops = static_cast<double>(num_ops);
+  std::cout << std::left << std::setw(32) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(10) << (best_ns / ops);
+  if (counters.available(PerfCounters::CYCLES) &&
+      counters.available(PerfCounters::INSTRUCTIONS) &&
+      (best_counts[PerfCounters::CYCLES] != 0)) {
+    std::cout << std::setw(8)
+              << (static_cast<double>(best_counts[PerfCounters::INSTRUCTIONS]) /
+                  static_cast<double>(best_counts[PerfCounters::CYCLES]));
+  } else {
+    std::cout << std::setw(8) << "-";
+  }
+  if (counters.available(PerfCounters::LLC_MISSES)) {
+    std::cout << std::setw(12) << std::setprecision(4)
+              << (static_cast<double>(best_counts[PerfCounters::LLC_MISSES]) /
+                  ops);
+  } else {
+    std::cout << std::setw(12) << "-";
+  }
+  std::cout << std::endl;
+}
+
+std::vector<std::size_t> make_positions(std::size_t limit, std::mt19937 &rng) {
+  std::uniform_int_distribution<std::size_t> dist(0, limit - 1);
+  std::vector<std::size_t> positions(param_num_ops);
+  for (std::size_t &pos : positions) {
+    pos = dist(rng);
+  }
+  return positions;
+}
+
+void bench_bit_vector(PerfCounters &counters, const std::string &label,
+                      double density, std::mt19937 &rng) {
+  BitVector bv;
+  std::bernoulli_distribution dist(density);
+  for (std::size_t i = 0; i < param_size; ++i) {
+    bv.push_back(dist(rng));
+  }
+  bv.build(true, true);
+
+  const std::vector<std::size_t> rank_positions =
+      make_positions(bv.size(), rng);
+  run(counters, "bit_vector/rank1/" + label, param_num_ops, [&] {
+    std::size_t sum = 0;
+    for (const std::size_t pos : rank_positions) {
+      sum += bv.rank1(pos);
+    }
+    return sum;
+  });
+  if (bv.num_0s() != 0) {
+    const std::vector<std::size_t> positions = make_positions(bv.num_0s(), rng);
+    run(counters, "bit_vector/select0/" + label, param_num_ops, [&] {
+      std::size_t sum = 0;
+      for (const std::size_t pos : positions) {
+        sum += bv.select0(pos);
+      }
+      return sum;
+    });
+  }
+  if (bv.num_1s() != 0) {
+    const std::vector<std::size_t> positions = make_positions(bv.num_1s(), rng);
+    run(counters, "bit_vector/select1/" + label, param_num_ops, [&] {
+      std::size_t sum = 0;
+      for (const std::size_t pos : positions) {
+        sum += bv.select1(pos);
+      }
+      return sum;
+    });
+  }
+}
+
+void bench_flat_vector(PerfCounters &counters, std::mt19937 &rng) {
+  for (const uint32_t max_value : {uint32_t{255}, uint32_t{1} << 20}) {
+    Vector<uint32_t> values;
+    std::uniform_int_distribution<uint32_t> dist(0, max_value);
+    for (std::size_t i = 0; i < param_size; ++i) {
+      values.push_back(dist(rng));
+    }
+    FlatVector fv;
+    fv.build(values);
+
+    const std::vector<std::size_t> positions = make_positions(fv.size(), rng);
+    run(counters,
+        "flat_vector/access/" + std::to_string(fv.value_size()) + "bits",
+        param_num_ops, [&] {
+          std::size_t sum = 0;
+          for (const std::size_t pos : positions) {
+            sum += fv[pos];
+          }
+          return sum;
+        });
+  }
+}
+
+void bench_tail(PerfCounters &counters, const std::vector<std::string> &keys,
+                std::mt19937 &rng) {
+  for (const marisa::TailMode mode : {MARISA_TEXT_TAIL, MARISA_BINARY_TAIL}) {
+    const std::string label =
+        (mode == MARISA_TEXT_TAIL) ? "/text" : "/binary";
+    // Entry indexes a string backward for suffix sorting, but Tail stores
+    // it forward, so keys are given as they are.
+    Vector<Entry> entries;
+    for (const std::string &key : keys) {
+      Entry entry;
+      entry.set_str(key.data(), key.length());
+      entries.push_back(entry);
+    }
+    Tail tail;
+    Vector<uint32_t> offsets;
+    tail.build(entries, &offsets, mode);
+
+    const std::vector<std::size_t> positions = make_positions(keys.size(), rng);
+    marisa::Agent agent;
+    agent.init_state();
+    // A benchmark of failing matches would measure the wrong path.
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      agent.set_query(keys[i]);
+      agent.state().set_query_pos(0);
+      if (!tail.match(agent, offsets[i])) {
+        throw std::runtime_error("tail/match" + label + ": mismatch");
+      }
+    }
+    run(counters, "tail/match" + label, param_num_ops, [&] {
+      std::size_t count = 0;
+      for (const std::size_t pos : positions) {
+        agent.set_query(keys[pos]);
+        agent.state().set_query_pos(0);
+        count += tail.match(agent, offsets[pos]) ? 1 : 0;
+      }
+      return count;
+    });
+    run(counters, "tail/restore" + label, param_num_ops, [&] {
+      std::size_t length = 0;
+      for (const std::size_t pos : positions) {
+        agent.state().key_buf().clear();
+        tail.restore(agent, offsets[pos]);
+        length += agent.state().key_buf().size();
+      }
+      return length;
+    });
+  }
+}
+
+// find_child() is reached through lookup(). With a huge cache, most child
+// lookups near the root hit the cache, and with a tiny cache, most of them
+// scan the LOUDS.
+void bench_louds_trie(PerfCounters &counters,
+                      const std::vector<std::string> &keys,
+                      std::mt19937 &rng) {
+  marisa::Keyset keyset;
+  for (const std::string &key : keys) {
+    keyset.push_back(key);
+  }
+  const std::vector<std::size_t> positions = make_positions(keys.size(), rng);
+  for (const marisa::CacheLevel level : {MARISA_HUGE_CACHE, MARISA_TINY_CACHE}) {
+    LoudsTrie trie;
+    trie.build(keyset, level);
+
+    marisa::Agent agent;
+    agent.init_state();
+    run(counters,
+        std::string("louds_trie/lookup/") +
+            ((level == MARISA_HUGE_CACHE) ? "huge_cache" : "tiny_cache"),
+        param_num_ops, [&] {
+          std::size_t count = 0;
+          for (const std::size_t pos : positions) {
+            agent.set_query(keys[pos]);
+            count += trie.lookup(agent) ? 1 : 0;
+          }
+          return count;
+        });
+  }
+}
+
+// Each run sorts a fresh copy of the keys, and ns/op is per key.
+void bench_sort(PerfCounters &counters, const std::vector<std::string> &keys,
+                std::mt19937 &rng) {
+  std::vector<std::size_t> order(keys.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), rng);
+  Vector<Key> unsorted;
+  for (const std::size_t i : order) {
+    Key key;
+    key.set_str(keys[i].data(), keys[i].length());
+    unsorted.push_back(key);
+  }
+
+  Vector<Key> work;
+  run(counters, "algorithm/sort", keys.size(), [&] {
+    work.resize(unsorted.size());
+    std::copy(unsorted.begin(), unsorted.end(), work.begin());
+    return marisa::grimoire::algorithm::sort(work.begin(), work.end());
+  });
+}
+
+// generate_keys() generates keys over a small alphabet, which share
+// prefixes like natural words.
+std::vector<std::string> generate_keys(std::mt19937 &rng) {
+  std::uniform_int_distribution<std::size_t> length_dist(1, 16);
+  std::uniform_int_distribution<int> char_dist('a', 'h');
+  std::vector<std::string> keys(param_size);
+  for (std::string &key : keys) {
+    key.resize(length_dist(rng));
+    for (char &c : key) {
+      c = static_cast<char>(char_dist(rng));
+    }
+  }
+  return keys;
+}
+
+int read_keys(const char *const *args, std::size_t num_args,
+              std::vector<std::string> *keys) {
+  for (std::size_t i = 0; i < num_args; ++i) {
+    std::ifstream file(args[i], std::ios::binary);
+    if (!file) {
+      std::cerr << "error: failed to open: " << args[i] << "\n";
+      return 10;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+      const std::size_t delim_pos = line.find_last_of('\t');
+      if (delim_pos != std::string::npos) {
+        line.resize(delim_pos);
+      }
+      if (!line.empty()) {
+        keys->push_back(line);
+      }
+    }
+  }
+  return 0;
+}
+
+int microbench(const char *const *args, std::size_t num_args) {
+  std::mt19937 rng(param_seed);
+
+  std::vector<std::string> keys;
+  if (num_args != 0) {
+    const int result = read_keys(args, num_args, &keys);
+    if (result != 0) {
+      return result;
+    }
+    if (keys.empty()) {
+      std::cerr << "error: no keys\n";
+      return 11;
+    }
+  } else {
+    keys = generate_keys(rng);
+  }
+
+  PerfCounters counters;
+  std::cout << std::left << std::setw(32) << "benchmark" << std::right
+            << std::setw(10) << "ns/op" << std::setw(8) << "IPC"
+            << std::setw(12) << "LLC-miss/op" << std::endl;
+  try {
+    bench_bit_vector(counters, "dense", 0.5, rng);
+    bench_bit_vector(counters, "sparse", 0.01, rng);
+    bench_flat_vector(counters, rng);
+    bench_tail(counters, keys, rng);
+    bench_louds_trie(counters, keys, rng);
+    bench_sort(counters, keys, rng);
+  } catch (const std::exception &ex) {
+    std::cerr << ex.what() << ": benchmark failed\n";
+    return 20;
+  }
+  return 0;
+}
+
+bool parse_size(const char *str, std::size_t *value) {
+  char *end_of_value;
+  const unsigned long long temp = std::strtoull(str, &end_of_value, 10);
+  if ((*end_of_value != '\0') || (temp == 0) || (temp > SIZE_MAX)) {
+    return false;
+  }
+  *value = static_cast<std::size_t>(temp);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::ios::sync_with_stdio(false);
+
+  ::cmdopt_option long_options[] = {{"size", 1, nullptr, 'n'},
+                                    {"num-ops", 1, nullptr, 'o'},
+                                    {"num-runs", 1, nullptr, 'r'},
+                                    {"seed", 1, nullptr, 's'},
+                                    {"filter", 1, nullptr, 'f'},
+                                    {"help", 0, nullptr, 'h'},
+                                    {nullptr, 0, nullptr, 0}};
+  ::cmdopt_t cmdopt;
+  ::cmdopt_init(&cmdopt, argc, argv, "n:o:r:s:f:h", long_options);
+  int label;
+  while ((label = ::cmdopt_get(&cmdopt)) != -1) {
+    switch (label) {
+      case 'n': {
+        if (!parse_size(cmdopt.optarg, &param_size)) {
+          std::cerr << "error: option `-n' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 1;
+        }
+        break;
+      }
+      case 'o': {
+        if (!parse_size(cmdopt.optarg, &param_num_ops)) {
+          std::cerr << "error: option `-o' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 2;
+        }
+        break;
+      }
+      case 'r': {
+        if (!parse_size(cmdopt.optarg, &param_num_runs)) {
+          std::cerr << "error: option `-r' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 3;
+        }
+        break;
+      }
+      case 's': {
+        char *end_of_value;
+        const unsigned long value =
+            std::strtoul(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value > UINT32_MAX)) {
+          std::cerr << "error: option `-s' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 4;
+        }
+        param_seed = static_cast<uint32_t>(value);
+        break;
+      }
+      case 'f': {
+        param_filter = cmdopt.optarg;
+        break;
+      }
+      case 'h': {
+        print_help(argv[0]);
+        return 0;
+      }
+      default: {
+        return 1;
+      }
+    }
+  }
+  return microbench(cmdopt.argv + cmdopt.optind,
+                    static_cast<std::size_t>(cmdopt.argc - cmdopt.optind));
+}
@@ -0,0 +1,501 @@
+#include <marisa.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cmdopt.h"
+#include "query-log.h"
+
+namespace {
+
+int param_min_num_tries = 1;
+int param_max_num_tries = 5;
+// A parameter of 0 means that all the settings are tried.
+int param_tail_mode = 0;
+int param_node_order = 0;
+int param_cache_level = 0;
+const char *param_queries = nullptr;
+int param_num_runs = 3;
+std::size_t param_num_jobs = 0;
+double param_size_slack = 10.0;
+bool param_print_all = false;
+
+const marisa::TailMode TAIL_MODES[] = {MARISA_TEXT_TAIL, MARISA_BINARY_TAIL};
+const marisa::NodeOrder NODE_ORDERS[] = {MARISA_WEIGHT_ORDER,
+                                         MARISA_LABEL_ORDER};
+const marisa::CacheLevel CACHE_LEVELS[] = {
+    MARISA_TINY_CACHE, MARISA_SMALL_CACHE, MARISA_NORMAL_CACHE,
+    MARISA_LARGE_CACHE, MARISA_HUGE_CACHE};
+
+// Candidate is a point of the grid. `size' is the size of the trie built
+// with its flags, and `ns_per_query' is the median over runs of the mean
+// time per query.
+struct Candidate {
+  int num_tries;
+  marisa::TailMode tail_mode;
+  marisa::NodeOrder node_order;
+  marisa::CacheLevel cache_level;
+  std::size_t size;
+  double ns_per_query;
+
+  int flags() const {
+    return num_tries | tail_mode | node_order | cache_level;
+  }
+};
+
+std::vector<Query> queries;
+
+void print_help(const char *cmd) {
+  std::cerr
+      << "Usage: " << cmd
+      << " [OPTION]... [FILE]...\n\n"
+         "Options:\n"
+         "  -N, --min-num-tries=[N]  limit the number of tries ["
+      << MARISA_MIN_NUM_TRIES << ", " << MARISA_MAX_NUM_TRIES
+      << "] (default: 1)\n"
+         "  -n, --max-num-tries=[N]  limit the number of tries ["
+      << MARISA_MIN_NUM_TRIES << ", " << MARISA_MAX_NUM_TRIES
+      << "] (default: 5)\n"
+         "  -t, --text-tail     try only text TAIL\n"
+         "  -b, --binary-tail   try only binary TAIL\n"
+         "  -w, --weight-order  try only weight order\n"
+         "  -l, --label-order   try only label order\n"
+         "  -c, --cache-level=[N]    try only the cache size N [1, 5]\n"
+         "  -q, --queries=[FILE]     benchmark queries in FILE (default:"
+         " look up all the\n"
+         "                           keys)\n"
+         "  -x, --num-runs=[N]  repeat each benchmark N times (default: 3)\n"
+         "  -j, --jobs=[N]      build N tries in parallel (default: the"
+         " number of CPUs)\n"
+         "  -s, --size-slack=[N]     recommend the fastest settings within"
+         " N% of the\n"
+         "                           smallest size (default: 10)\n"
+         "  -a, --all           print all the settings, not only the Pareto"
+         " frontier\n"
+         "  -h, --help          print this help\n"
+         "\n"
+         "Each line of a query file is a key to look up, or OP<tab>QUERY where"
+         " OP is\n"
+         "one of `lookup', `reverse', `prefix' and `predict', as with"
+         " marisa-benchmark.\n"
+         "\n"
+         "Tries are built in parallel and benchmarked one by one, so that"
+         " benchmarks do\n"
+         "not compete for CPUs and caches. At most N tries are kept in memory"
+         " at once.\n"
+         "\n";
+}
+
+void read_keys(std::istream &input, marisa::Keyset *keyset,
+               std::vector<float> *weights) {
+  std::string line;
+  while (std::getline(input, line)) {
+    const std::string::size_type delim_pos = line.find_last_of('\t');
+    float weight = 1.0F;
+    if (delim_pos != line.npos) {
+      char *end_of_value;
+      weight =
+          static_cast<float>(std::strtod(&line[delim_pos + 1], &end_of_value));
+      if (*end_of_value == '\0') {
+        line.resize(delim_pos);
+      }
+    }
+    keyset->push_back(line.c_str(), line.length());
+    weights->push_back(weight);
+  }
+}
+
+int read_keys(const char *const *args, std::size_t num_args,
+              marisa::Keyset *keyset, std::vector<float> *weights) {
+  if (num_args == 0) {
+    read_keys(std::cin, keyset, weights);
+  }
+  for (std::size_t i = 0; i < num_args; ++i) {
+    std::ifstream input_file(args[i], std::ios::binary);
+    if (!input_file) {
+      std::cerr << "error: failed to open: " << args[i] << "\n";
+      return 10;
+    }
+    read_keys(input_file, keyset, weights);
+  }
+  std::cout << "Number of keys: " << keyset->size() << "\n";
+  std::cout << "Total length: " << keyset->total_length() << "\n"
+            << std::flush;
+  return 0;
+}
+
+void make_queries(const marisa::Keyset &keyset) {
+  queries.resize(keyset.size());
+  for (std::size_t i = 0; i < keyset.size(); ++i) {
+    queries[i].type = LOOKUP_QUERY;
+    queries[i].str.assign(keyset[i].ptr(), keyset[i].length());
+    queries[i].id = 0;
+  }
+}
+
+std::vector<Candidate> make_grid() {
+  std::vector<Candidate> grid;
+  for (int num_tries = param_min_num_tries; num_tries <= param_max_num_tries;
+       ++num_tries) {
+    for (const marisa::TailMode tail_mode : TAIL_MODES) {
+      if ((param_tail_mode != 0) && (tail_mode != param_tail_mode)) {
+        continue;
+      }
+      for (const marisa::NodeOrder node_order : NODE_ORDERS) {
+        if ((param_node_order != 0) && (node_order != param_node_order)) {
+          continue;
+        }
+        for (const marisa::CacheLevel cache_level : CACHE_LEVELS) {
+          if ((param_cache_level != 0) &&
+              (cache_level != param_cache_level)) {
+            continue;
+          }
+          grid.push_back(
+              {num_tries, tail_mode, node_order, cache_level, 0, 0.0});
+        }
+      }
+    }
+  }
+  return grid;
+}
+
+// benchmark() returns the median over runs of the mean time per query.
+double benchmark(const marisa::Trie &trie) {
+  if (queries.empty()) {
+    return 0.0;
+  }
+  std::vector<double> samples;
+  for (int i = 0; i < param_num_runs; ++i) {
+    marisa::Agent agent;
+    const auto begin = std::chrono::steady_clock::now();
+    for (const Query &query : queries) {
+      replay(trie, query, agent);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    samples.push_back(
+        std::chrono::duration<double, std::nano>(end - begin).count() /
+        static_cast<double>(queries.size()));
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+// tune() builds tries in batches of `num_jobs'. Each job has its own copy of
+// the keyset because build() overwrites weights with key IDs.
+int tune(const marisa::Keyset &keyset, const std::vector<float> &weights,
+         std::vector<Candidate> *grid) {
+  const std::size_t num_jobs = std::min(param_num_jobs, grid->size());
+  std::vector<marisa::Keyset> keysets(num_jobs);
+  for (marisa::Keyset &job_keyset : keysets) {
+    for (std::size_t i = 0; i < keyset.size(); ++i) {
+      job_keyset.push_back(keyset[i].ptr(), keyset[i].length());
+    }
+  }
+
+  for (std::size_t begin = 0; begin < grid->size(); begin += num_jobs) {
+    const std::size_t end = std::min(begin + num_jobs, grid->size());
+    std::vector<marisa::Trie> tries(end - begin);
+    std::vector<std::exception_ptr> errors(end - begin);
+    std::vector<std::thread> threads;
+    for (std::size_t i = begin; i < end; ++i) {
+      threads.emplace_back([&, i] {
+        const std::size_t job = i - begin;
+        marisa::Keyset &job_keyset = keysets[job];
+        for (std::size_t j = 0; j < job_keyset.size(); ++j) {
+          job_keyset[j].set_weight(weights[j]);
+        }
+        try {
+          tries[job].build(job_keyset, (*grid)[i].flags());
+        } catch (...) {
+          errors[job] = std::current_exception();
+        }
+      });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+
+    for (std::size_t i = begin; i < end; ++i) {
+      const std::size_t job = i - begin;
+      if (errors[job] != nullptr) {
+        try {
+          std::rethrow_exception(errors[job]);
+        } catch (const std::exception &ex) {
+          std::cerr << "error: failed to build a dictionary: " << ex.what()
+                    << "\n";
+        }
+        return 13;
+      }
+      (*grid)[i].size = tries[job].io_size();
+      (*grid)[i].ns_per_query = benchmark(tries[job]);
+    }
+  }
+  return 0;
+}
+
+// pareto_frontier() returns the candidates that no other candidate beats in
+// both size and time, in ascending order of size.
+std::vector<Candidate> pareto_frontier(std::vector<Candidate> grid) {
+  std::sort(grid.begin(), grid.end(),
+            [](const Candidate &lhs, const Candidate &rhs) {
+              if (lhs.size != rhs.size) {
+                return lhs.size < rhs.size;
+              }
+              return lhs.ns_per_query < rhs.ns_per_query;
+            });
+  std::vector<Candidate> frontier;
+  for (const Candidate &candidate : grid) {
+    if (frontier.empty() ||
+        (candidate.ns_per_query < frontier.back().ns_per_query)) {
+      frontier.push_back(candidate);
+    }
+  }
+  return frontier;
+}
+
+// recommend() returns the fastest candidate of `frontier' whose size is
+// within `param_size_slack' percent of the smallest.
+const Candidate &recommend(const std::vector<Candidate> &frontier) {
+  const double max_size = static_cast<double>(frontier.front().size) *
+                          (1.0 + (param_size_slack / 100.0));
+  std::size_t best = 0;
+  for (std::size_t i = 1; i < frontier.size(); ++i) {
+    if (static_cast<double>(frontier[i].size) <= max_size) {
+      best = i;
+    }
+  }
+  return frontier[best];
+}
+
+int get_cache_level_number(marisa::CacheLevel cache_level) {
+  for (int i = 0; i < 5; ++i) {
+    if (CACHE_LEVELS[i] == cache_level) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+std::string get_build_options(const Candidate &candidate) {
+  std::string options = "-n " + std::to_string(candidate.num_tries);
+  options += (candidate.tail_mode == MARISA_BINARY_TAIL) ? " -b" : " -t";
+  options += (candidate.node_order == MARISA_LABEL_ORDER) ? " -l" : " -w";
+  options +=
+      " -c " + std::to_string(get_cache_level_number(candidate.cache_level));
+  return options;
+}
+
+void print_candidates(const std::vector<Candidate> &candidates,
+                      const Candidate &recommended) {
+  std::printf("  %6s %6s %6s %6s %12s %10s\n", "#tries", "tail", "order",
+              "cache", "size [KiB]", "[ns/query]");
+  for (const Candidate &candidate : candidates) {
+    std::printf(
+        "%c %6d %6s %6s %6d %12.1f %10.1f\n",
+        (candidate.flags() == recommended.flags()) ? '*' : ' ',
+        candidate.num_tries,
+        (candidate.tail_mode == MARISA_BINARY_TAIL) ? "binary" : "text",
+        (candidate.node_order == MARISA_LABEL_ORDER) ? "label" : "weight",
+        get_cache_level_number(candidate.cache_level),
+        static_cast<double>(candidate.size) / 1024.0,
+        candidate.ns_per_query);
+  }
+}
+
+int tune(const char *const *args, std::size_t num_args) try {
+  marisa::Keyset keyset;
+  std::vector<float> weights;
+  const int ret = read_keys(args, num_args, &keyset, &weights);
+  if (ret != 0) {
+    return ret;
+  }
+  if (param_queries != nullptr) {
+    const int query_ret = read_queries(param_queries, &queries);
+    if (query_ret != 0) {
+      return query_ret;
+    }
+  } else {
+    make_queries(keyset);
+  }
+  std::cout << "Number of queries: " << queries.size() << "\n";
+
+  std::vector<Candidate> grid = make_grid();
+  if (param_num_jobs == 0) {
+    param_num_jobs = std::max(1U, std::thread::hardware_concurrency());
+  }
+  std::cout << "Number of settings: " << grid.size() << "\n";
+  std::cout << "Number of jobs: " << std::min(param_num_jobs, grid.size())
+            << "\n"
+            << std::flush;
+  if (grid.empty()) {
+    return 0;
+  }
+
+  const int tune_ret = tune(keyset, weights, &grid);
+  if (tune_ret != 0) {
+    return tune_ret;
+  }
+
+  const std::vector<Candidate> frontier = pareto_frontier(grid);
+  const Candidate &recommended = recommend(frontier);
+  if (param_print_all) {
+    std::sort(grid.begin(), grid.end(),
+              [](const Candidate &lhs, const Candidate &rhs) {
+                return lhs.size < rhs.size;
+              });
+    std::printf("\nAll settings:\n");
+    print_candidates(grid, recommended);
+  }
+  std::printf("\nPareto frontier:\n");
+  print_candidates(frontier, recommended);
+  std::printf("\nRecommended: marisa-build %s\n",
+              get_build_options(recommended).c_str());
+  return 0;
+} catch (const std::exception &ex) {
+  std::cerr << "error: " << ex.what() << "\n";
+  return -1;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::ios::sync_with_stdio(false);
+
+  ::cmdopt_option long_options[] = {{"min-num-tries", 1, nullptr, 'N'},
+                                    {"max-num-tries", 1, nullptr, 'n'},
+                                    {"text-tail", 0, nullptr, 't'},
+                                    {"binary-tail", 0, nullptr, 'b'},
+                                    {"weight-order", 0, nullptr, 'w'},
+                                    {"label-order", 0, nullptr, 'l'},
+                                    {"cache-level", 1, nullptr, 'c'},
+                                    {"queries", 1, nullptr, 'q'},
+                                    {"num-runs", 1, nullptr, 'x'},
+                                    {"jobs", 1, nullptr, 'j'},
+                                    {"size-slack", 1, nullptr, 's'},
+                                    {"all", 0, nullptr, 'a'},
+                                    {"help", 0, nullptr, 'h'},
+                                    {nullptr, 0, nullptr, 0}};
+  ::cmdopt_t cmdopt;
+  ::cmdopt_init(&cmdopt, argc, argv, "N:n:tbwlc:q:x:j:s:ah", long_options);
+  int label;
+  while ((label = ::cmdopt_get(&cmdopt)) != -1) {
+    switch (label) {
+      case 'N': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value < MARISA_MIN_NUM_TRIES) ||
+            (value > MARISA_MAX_NUM_TRIES)) {
+          std::cerr << "error: option `-N' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 1;
+        }
+        param_min_num_tries = static_cast<int>(value);
+        break;
+      }
+      case 'n': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value < MARISA_MIN_NUM_TRIES) ||
+            (value > MARISA_MAX_NUM_TRIES)) {
+          std::cerr << "error: option `-n' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 2;
+        }
+        param_max_num_tries = static_cast<int>(value);
+        break;
+      }
+      case 't': {
+        param_tail_mode = MARISA_TEXT_TAIL;
+        break;
+      }
+      case 'b': {
+        param_tail_mode = MARISA_BINARY_TAIL;
+        break;
+      }
+      case 'w': {
+        param_node_order = MARISA_WEIGHT_ORDER;
+        break;
+      }
+      case 'l': {
+        param_node_order = MARISA_LABEL_ORDER;
+        break;
+      }
+      case 'c': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value < 1) || (value > 5)) {
+          std::cerr << "error: option `-c' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 3;
+        }
+        param_cache_level = CACHE_LEVELS[value - 1];
+        break;
+      }
+      case 'q': {
+        param_queries = cmdopt.optarg;
+        break;
+      }
+      case 'x': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value <= 0) || (value > 1000)) {
+          std::cerr << "error: option `-x' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 4;
+        }
+        param_num_runs = static_cast<int>(value);
+        break;
+      }
+      case 'j': {
+        char *end_of_value;
+        const long value = std::strtol(cmdopt.optarg, &end_of_value, 10);
+        if ((*end_of_value != '\0') || (value <= 0) || (value > 1024)) {
+          std::cerr << "error: option `-j' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 5;
+        }
+        param_num_jobs = static_cast<std::size_t>(value);
+        break;
+      }
+      case 's': {
+        char *end_of_value;
+        const double value = std::strtod(cmdopt.optarg, &end_of_value);
+        if ((*end_of_value != '\0') || !(value >= 0.0)) {
+          std::cerr << "error: option `-s' with an invalid argument: "
+                    << cmdopt.optarg << "\n";
+          return 6;
+        }
+        param_size_slack = value;
+        break;
+      }
+      case 'a': {
+        param_print_all = true;
+        break;
+      }
+      case 'h': {
+        print_help(argv[0]);
+        return 0;
+      }
+      default: {
+        return 1;
+      }
+    }
+  }
+  if (param_min_num_tries > param_max_num_tries) {
+    std::cerr << "error: option `-N' is greater than option `-n'\n";
+    return 7;
+  }
+  return tune(cmdopt.argv + cmdopt.optind,
+              static_cast<std::size_t>(cmdopt.argc - cmdopt.optind));
+}
@@ -0,0 +1,80 @@
+#include "query-log.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+const char *const QUERY_TYPE_NAMES[NUM_QUERY_TYPES] = {"lookup", "reverse",
+                                                       "prefix", "predict"};
+
+int read_queries(const char *filename, std::vector<Query> *queries) {
+  std::ifstream input_file(filename, std::ios::binary);
+  if (!input_file) {
+    std::cerr << "error: failed to open: " << filename << "\n";
+    return 11;
+  }
+  std::string line;
+  while (std::getline(input_file, line)) {
+    Query query = {LOOKUP_QUERY, line, 0};
+    const std::string::size_type delim_pos = line.find('\t');
+    if (delim_pos != line.npos) {
+      for (int i = 0; i < NUM_QUERY_TYPES; ++i) {
+        if (line.compare(0, delim_pos, QUERY_TYPE_NAMES[i]) == 0) {
+          query.type = static_cast<QueryType>(i);
+          query.str = line.substr(delim_pos + 1);
+          break;
+        }
+      }
+    }
+    if (query.type == REVERSE_LOOKUP_QUERY) {
+      char *end_of_value;
+      const unsigned long long value =
+          std::strtoull(query.str.c_str(), &end_of_value, 10);
+      if (query.str.empty() || (*end_of_value != '\0')) {
+        std::cerr << "error: invalid key ID: " << query.str << "\n";
+        return 12;
+      }
+      query.id = static_cast<std::size_t>(value);
+    }
+    queries->push_back(std::move(query));
+  }
+  return 0;
+}
+
+bool replay(const marisa::Trie &trie, const Query &query,
+            marisa::Agent &agent) {
+  switch (query.type) {
+    case LOOKUP_QUERY: {
+      agent.set_query(query.str);
+      return trie.lookup(agent);
+    }
+    case REVERSE_LOOKUP_QUERY: {
+      if (query.id >= trie.num_keys()) {
+        return false;
+      }
+      agent.set_query(query.id);
+      trie.reverse_lookup(agent);
+      return true;
+    }
+    case COMMON_PREFIX_SEARCH_QUERY: {
+      agent.set_query(query.str);
+      bool found = false;
+      while (trie.common_prefix_search(agent)) {
+        found = true;
+      }
+      return found;
+    }
+    case PREDICTIVE_SEARCH_QUERY: {
+      agent.set_query(query.str);
+      bool found = false;
+      while (trie.predictive_search(agent)) {
+        found = true;
+      }
+      return found;
+    }
+    default: {
+      return false;
+    }
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef MARISA_QUERY_LOG_H_
+#define MARISA_QUERY_LOG_H_
+
+#include <marisa.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A query log has a query per line, which is a key to look up or a line of
+// the form "OP\tQUERY", where OP is the name of a query type. The query of
+// `reverse' is a key ID. marisa-benchmark and marisa-tune replay query logs.
+enum QueryType {
+  LOOKUP_QUERY,
+  REVERSE_LOOKUP_QUERY,
+  COMMON_PREFIX_SEARCH_QUERY,
+  PREDICTIVE_SEARCH_QUERY,
+  NUM_QUERY_TYPES
+};
+
+extern const char *const QUERY_TYPE_NAMES[NUM_QUERY_TYPES];
+
+struct Query {
+  QueryType type;
+  std::string str;
+  std::size_t id;
+};
+
+// read_queries() appends the queries in `filename' to `queries'. It prints
+// an error and returns 11 if the file is not opened, or 12 if a key ID is
+// invalid. Otherwise, it returns 0.
+int read_queries(const char *filename, std::vector<Query> *queries);
+
+// replay() returns false if a query has no result.
+bool replay(const marisa::Trie &trie, const Query &query,
+            marisa::Agent &agent);
+
+#endif  // MARISA_QUERY_LOG_H_